@@ -0,0 +1,416 @@
+// End to end throughput of the asset pipeline on a synthetic asset tree: packing
+// (cold and incremental), metadata load, bundle load, reading every payload and
+// address lookups. Runs headless, results are written as JSON so runs of different
+// versions can be compared.
+//
+//  tlc_asset_bench [options]
+//    --assets N          number of generated assets (default 2000)
+//    --bundles N         bundles the assets are spread over (default 4)
+//    --min-size BYTES    smallest asset (default 256)
+//    --max-size BYTES    largest asset (default 1048576)
+//    --distribution D    "log" (many small, few large assets) or "uniform" (default log)
+//    --lookups N         timed lookups, by address and by AssetId (default 200000)
+//    --verify MODE       "none", "toc" or "full" bundle verification (default toc)
+//    --seed N            seed of the generated tree (default 1)
+//    --dir PATH          scratch directory, removed afterwards (default ./tlc_asset_bench)
+//    --output FILE       write the JSON report to a file instead of stdout
+//    --verbose           keep the engine log on the console
+
+#include <numeric>
+
+#include "core/Core.hpp"
+#include "services/assetmanager/AssetBundler.hpp"
+#include "services/assetmanager/AssetManager.hpp"
+
+#if defined(PLATFORM_WINDOWS)
+#include <psapi.h>
+#endif
+
+using namespace tlc;
+
+struct BenchmarkSettings
+{
+	Size NumAssets = 2000;
+	Size NumBundles = 4;
+	Size MinSize = 256;
+	Size MaxSize = 1024 * 1024;
+	Bool LogDistribution = true;
+	Size NumLookups = 200000;
+	AssetVerificationMode VerificationMode = AssetVerificationMode::TableOfContents;
+	U64 Seed = 1;
+	String Directory = "./tlc_asset_bench";
+	String OutputPath = "";
+	Bool Verbose = false;
+};
+
+struct StageResult
+{
+	String Name = "";
+	F64 Seconds = 0.0;
+	Size Bytes = 0;
+	Size Assets = 0;
+};
+
+struct LookupResult
+{
+	String Name = "";
+	List<F64> Nanoseconds = {};
+};
+
+struct SyntheticTree
+{
+	List<String> Addresses;
+	List<String> BundleNames;
+	Size TotalBytes = 0;
+};
+
+// xorshift64*, the generated tree only depends on the seed
+class Random
+{
+public:
+	Random(U64 seed) : m_State(seed != 0 ? seed : 0x9E3779B97F4A7C15ull) {}
+
+	inline U64 Next()
+	{
+		m_State ^= m_State >> 12; m_State ^= m_State << 25; m_State ^= m_State >> 27;
+		return m_State * 0x2545F4914F6CDD1Dull;
+	}
+
+	inline F64 NextUnit() { return static_cast<F64>(Next() >> 11) / static_cast<F64>(1ull << 53); }
+
+private:
+	U64 m_State = 0;
+};
+
+static F64 GetSeconds(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<F64>(std::chrono::steady_clock::now() - start).count();
+}
+
+static Size GetPeakResidentBytes()
+{
+#if defined(PLATFORM_WINDOWS)
+	auto counters = PROCESS_MEMORY_COUNTERS();
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return static_cast<Size>(counters.PeakWorkingSetSize);
+	}
+	return 0;
+#else
+	auto usage = rusage();
+	getrusage(RUSAGE_SELF, &usage);
+	return static_cast<Size>(usage.ru_maxrss) * 1024; // kilobytes on linux
+#endif
+}
+
+static Bool ParseArguments(int argc, char** argv, BenchmarkSettings& settings)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		auto argument = String(argv[i]);
+		if (argument == "--verbose")
+		{
+			settings.Verbose = true;
+			continue;
+		}
+
+		if (i + 1 >= argc)
+		{
+			std::fprintf(stderr, "missing value for %s\n", argument.c_str());
+			return false;
+		}
+
+		auto value = String(argv[++i]);
+		if (argument == "--assets") settings.NumAssets = std::stoull(value);
+		else if (argument == "--bundles") settings.NumBundles = std::max<Size>(1, std::stoull(value));
+		else if (argument == "--min-size") settings.MinSize = std::stoull(value);
+		else if (argument == "--max-size") settings.MaxSize = std::stoull(value);
+		else if (argument == "--distribution") settings.LogDistribution = value != "uniform";
+		else if (argument == "--lookups") settings.NumLookups = std::stoull(value);
+		else if (argument == "--seed") settings.Seed = std::stoull(value);
+		else if (argument == "--dir") settings.Directory = value;
+		else if (argument == "--output") settings.OutputPath = value;
+		else if (argument == "--verify")
+		{
+			if (value == "none") settings.VerificationMode = AssetVerificationMode::None;
+			else if (value == "toc") settings.VerificationMode = AssetVerificationMode::TableOfContents;
+			else if (value == "full") settings.VerificationMode = AssetVerificationMode::Full;
+			else
+			{
+				std::fprintf(stderr, "unknown verification mode: %s\n", value.c_str());
+				return false;
+			}
+		}
+		else
+		{
+			std::fprintf(stderr, "unknown option: %s\n", argument.c_str());
+			return false;
+		}
+	}
+
+	settings.MinSize = std::max<Size>(1, settings.MinSize);
+	settings.MaxSize = std::max(settings.MinSize, settings.MaxSize);
+	return true;
+}
+
+// Writes the raw asset directories, one per bundle. Most assets are opaque binary
+// files, every eighth one is a text shader so the tag index has something to do.
+static SyntheticTree GenerateTree(const BenchmarkSettings& settings, const String& rawPath)
+{
+	auto tree = SyntheticTree();
+	auto random = Random(settings.Seed);
+	for (Size i = 0; i < settings.NumBundles; i++)
+	{
+		tree.BundleNames.push_back("bundle" + std::to_string(i));
+		utils::EnsureDirectory(rawPath + "/" + tree.BundleNames.back());
+	}
+
+	auto minSize = static_cast<F64>(settings.MinSize);
+	auto maxSize = static_cast<F64>(settings.MaxSize);
+	auto buffer = List<U8>();
+	for (Size i = 0; i < settings.NumAssets; i++)
+	{
+		auto size = settings.LogDistribution
+			? static_cast<Size>(minSize * std::pow(maxSize / minSize, random.NextUnit()))
+			: static_cast<Size>(minSize + (maxSize - minSize) * random.NextUnit());
+		size = std::clamp(size, settings.MinSize, settings.MaxSize);
+
+		auto shader = i % 8 == 7;
+		auto address = "group" + std::to_string(i % 16) + "/asset" + std::to_string(i) + (shader ? ".vert.glsl" : ".bin");
+
+		buffer.resize(size);
+		for (Size offset = 0; offset < size; offset += sizeof(U64))
+		{
+			auto value = random.Next();
+			std::memcpy(buffer.data() + offset, &value, std::min(sizeof(U64), size - offset));
+		}
+		if (shader)
+		{
+			// printable, so the content looks like source text
+			for (auto& byte : buffer)
+			{
+				byte = static_cast<U8>('a' + byte % 26);
+			}
+		}
+
+		auto path = std::filesystem::path(rawPath) / tree.BundleNames[i % settings.NumBundles] / address;
+		std::filesystem::create_directories(path.parent_path());
+		std::ofstream file(path, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+
+		tree.Addresses.push_back(address);
+		tree.TotalBytes += size;
+	}
+	return tree;
+}
+
+static F64 GetPercentile(List<F64>& samples, F64 percentile)
+{
+	if (samples.empty())
+	{
+		return 0.0;
+	}
+
+	auto index = static_cast<Size>(percentile * static_cast<F64>(samples.size() - 1));
+	std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+	return samples[index];
+}
+
+static String FormatNumber(F64 value)
+{
+	char buffer[64];
+	std::snprintf(buffer, sizeof(buffer), "%.3f", std::isfinite(value) ? value : 0.0);
+	return String(buffer);
+}
+
+static String WriteReport(const BenchmarkSettings& settings, const SyntheticTree& tree, const List<StageResult>& stages, List<LookupResult>& lookups, Size bundleBytes)
+{
+	static const char* k_VerificationModes[] = { "none", "toc", "full" };
+
+	auto json = std::ostringstream();
+	json << "{\n";
+	json << "  \"bundle_version\": " << k_AssetBundleVersion << ",\n";
+	json << "  \"config\": {\n";
+	json << "    \"assets\": " << settings.NumAssets << ",\n";
+	json << "    \"bundles\": " << settings.NumBundles << ",\n";
+	json << "    \"min_size\": " << settings.MinSize << ",\n";
+	json << "    \"max_size\": " << settings.MaxSize << ",\n";
+	json << "    \"distribution\": \"" << (settings.LogDistribution ? "log" : "uniform") << "\",\n";
+	json << "    \"verification\": \"" << k_VerificationModes[static_cast<U8>(settings.VerificationMode)] << "\",\n";
+	json << "    \"seed\": " << settings.Seed << ",\n";
+	json << "    \"threads\": " << std::thread::hardware_concurrency() << "\n";
+	json << "  },\n";
+	json << "  \"source_bytes\": " << tree.TotalBytes << ",\n";
+	json << "  \"bundle_bytes\": " << bundleBytes << ",\n";
+
+	json << "  \"stages\": {\n";
+	for (Size i = 0; i < stages.size(); i++)
+	{
+		const auto& stage = stages[i];
+		json << "    \"" << stage.Name << "\": { ";
+		json << "\"seconds\": " << FormatNumber(stage.Seconds) << ", ";
+		json << "\"mb_per_second\": " << FormatNumber(static_cast<F64>(stage.Bytes) / (1024.0 * 1024.0) / stage.Seconds) << ", ";
+		json << "\"assets_per_second\": " << FormatNumber(static_cast<F64>(stage.Assets) / stage.Seconds) << " }";
+		json << (i + 1 < stages.size() ? ",\n" : "\n");
+	}
+	json << "  },\n";
+
+	for (auto& lookup : lookups)
+	{
+		auto totalNanoseconds = std::accumulate(lookup.Nanoseconds.begin(), lookup.Nanoseconds.end(), 0.0);
+		auto numLookups = lookup.Nanoseconds.size();
+		auto mean = numLookups > 0 ? totalNanoseconds / static_cast<F64>(numLookups) : 0.0;
+		json << "  \"" << lookup.Name << "\": {\n";
+		json << "    \"count\": " << numLookups << ",\n";
+		json << "    \"lookups_per_second\": " << FormatNumber(static_cast<F64>(numLookups) / (totalNanoseconds * 1e-9)) << ",\n";
+		json << "    \"mean_ns\": " << FormatNumber(mean) << ",\n";
+		json << "    \"p50_ns\": " << FormatNumber(GetPercentile(lookup.Nanoseconds, 0.50)) << ",\n";
+		json << "    \"p99_ns\": " << FormatNumber(GetPercentile(lookup.Nanoseconds, 0.99)) << "\n";
+		json << "  },\n";
+	}
+	json << "  \"peak_rss_bytes\": " << GetPeakResidentBytes() << "\n";
+	json << "}\n";
+	return json.str();
+}
+
+int main(int argc, char** argv)
+{
+	auto settings = BenchmarkSettings();
+	if (!ParseArguments(argc, argv, settings))
+	{
+		return 1;
+	}
+
+	// stdout is reserved for the report
+	Logger::Get()->EnableConsole(settings.Verbose);
+
+	auto rootPath = std::filesystem::absolute(settings.Directory).string();
+	auto rawPath = rootPath + "/raw";
+	auto bundlesPath = rootPath + "/bundles";
+	utils::RemoveDirectory(rootPath);
+	utils::EnsureDirectory(rawPath);
+
+	std::fprintf(stderr, "generating %zu assets in %s\n", settings.NumAssets, rawPath.c_str());
+	auto tree = GenerateTree(settings, rawPath);
+
+	Services::RegisterService<AssetBundler>(bundlesPath);
+	Services::RegisterService<AssetManager>(bundlesPath, settings.VerificationMode);
+	auto bundler = Services::Get<AssetBundler>();
+	auto assetManager = Services::Get<AssetManager>();
+
+	auto stages = List<StageResult>();
+	auto runStage = [&](const String& name, Size bytes, Size assets, const std::function<void()>& func) {
+		std::fprintf(stderr, "running %s\n", name.c_str());
+		auto start = std::chrono::steady_clock::now();
+		func();
+		stages.push_back({ name, GetSeconds(start), bytes, assets });
+	};
+
+	auto registerTree = [&](AssetBundler& target) {
+		for (const auto& bundleName : tree.BundleNames)
+		{
+			target.RegisterFromDirectory(rawPath + "/" + bundleName, bundleName);
+		}
+	};
+
+	runStage("pack_cold", tree.TotalBytes, tree.Addresses.size(), [&]() {
+		registerTree(*bundler);
+		bundler->Pack();
+	});
+
+	// a restart with nothing changed, every bundle is skipped after its manifest is checked.
+	// Only the pack is timed, the registration is the same as in the cold run.
+	auto restartedBundler = CreateScope<AssetBundler>();
+	restartedBundler->Setup(bundlesPath);
+	restartedBundler->OnStart();
+	registerTree(*restartedBundler);
+	runStage("pack_incremental", tree.TotalBytes, tree.Addresses.size(), [&]() {
+		restartedBundler->Pack();
+	});
+	restartedBundler->OnEnd();
+
+	auto bundleBytes = Size(0);
+	for (const auto& bundleName : tree.BundleNames)
+	{
+		bundleBytes += utils::GetFileSize(bundlesPath + "/" + bundleName + ".bundle");
+	}
+
+	assetManager->UnloadAllBundles();
+	runStage("metadata_load", bundleBytes, tree.Addresses.size(), [&]() {
+		assetManager->ReloadAssetMetadata();
+	});
+
+	runStage("bundle_load", bundleBytes, tree.Addresses.size(), [&]() {
+		assetManager->LoadAllBundles();
+	});
+
+	if (settings.VerificationMode == AssetVerificationMode::Full)
+	{
+		// the payloads are hashed in the background as soon as the bundles are loaded
+		runStage("verify_wait", tree.TotalBytes, tree.Addresses.size(), [&]() {
+			assetManager->WaitForVerification();
+		});
+	}
+
+	// every payload read once, pages come in from the mapping here unless the verification already touched them
+	runStage("read_all", tree.TotalBytes, tree.Addresses.size(), [&]() {
+		static volatile U64 s_Sink = 0;
+		auto sink = U64(0);
+		for (const auto& address : tree.Addresses)
+		{
+			auto data = assetManager->PinAssetData(address);
+			sink += utils::HashBuffer(data.GetData(), data.GetSize());
+		}
+		s_Sink = s_Sink + sink;
+	});
+
+	// timed one by one, the order is random so the address cache sees no pattern.
+	// Both runs visit the same assets in the same order, once by address and once by id.
+	auto ids = List<AssetId>();
+	for (const auto& address : tree.Addresses)
+	{
+		ids.emplace_back(address);
+	}
+
+	auto misses = Size(0);
+	auto timeLookups = [&](const String& name, const auto& lookup) {
+		auto result = LookupResult{ .Name = name, .Nanoseconds = {} };
+		result.Nanoseconds.reserve(settings.NumLookups);
+		auto random = Random(settings.Seed ^ 0xA5A5A5A5A5A5A5A5ull);
+		for (Size i = 0; i < settings.NumLookups && !tree.Addresses.empty(); i++)
+		{
+			auto index = random.Next() % tree.Addresses.size();
+			auto size = Size(0);
+			auto start = std::chrono::steady_clock::now();
+			auto data = lookup(index, size);
+			result.Nanoseconds.push_back(std::chrono::duration<F64, std::nano>(std::chrono::steady_clock::now() - start).count());
+			misses += data == nullptr ? 1 : 0;
+		}
+		return result;
+	};
+
+	auto lookups = List<LookupResult>();
+	lookups.push_back(timeLookups("lookup", [&](Size index, Size& size) { return assetManager->GetAssetDataRaw(tree.Addresses[index], size); }));
+	lookups.push_back(timeLookups("lookup_by_id", [&](Size index, Size& size) { return assetManager->GetAssetDataRaw(ids[index], size); }));
+
+	if (misses > 0)
+	{
+		std::fprintf(stderr, "%zu lookups failed, the benchmark results are not valid\n", misses);
+	}
+
+	auto report = WriteReport(settings, tree, stages, lookups, bundleBytes);
+	if (settings.OutputPath.empty())
+	{
+		std::fputs(report.c_str(), stdout);
+	}
+	else
+	{
+		std::ofstream(settings.OutputPath) << report;
+		std::fprintf(stderr, "report written to %s\n", settings.OutputPath.c_str());
+	}
+
+	assetManager->OnEnd();
+	bundler->OnEnd();
+	utils::RemoveDirectory(rootPath);
+	return misses > 0 ? 1 : 0;
+}
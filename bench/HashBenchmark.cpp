@@ -0,0 +1,112 @@
+// Throughput of the content hash (XXH64, one shot and streaming) against the
+// 32-bit SuperFastHash that utils::HashBuffer used before it.
+//
+//  tlc_hash_bench [total megabytes per case, default 512]
+
+#include "core/Hash.hpp"
+
+using namespace tlc;
+
+#define M_get16bits(d) ((((uint32_t)(((const uint8_t *)(d))[1])) << 8)\
+                       +(uint32_t)(((const uint8_t *)(d))[0]) )
+
+// The previous utils::HashBuffer, kept here only as the baseline
+static U32 SuperFastHash(const void* dat, Size len)
+{
+	const U8* data = static_cast<const U8*>(dat);
+	U32 hash = static_cast<U32>(len);
+	U32 tmp = 0;
+	I32 rem = 0;
+	if (len <= 0 || data == NULL) return 0;
+
+	rem = len & 3;
+	len >>= 2;
+
+	for (; len > 0; len--) {
+		hash += M_get16bits(data);
+		tmp = (M_get16bits(data + 2) << 11) ^ hash;
+		hash = (hash << 16) ^ tmp;
+		data += 2 * sizeof(U16);
+		hash += hash >> 11;
+	}
+
+	switch (rem) {
+	case 3: hash += M_get16bits(data);
+		hash ^= hash << 16;
+		hash ^= ((signed char)data[sizeof(U16)]) << 18;
+		hash += hash >> 11;
+		break;
+	case 2: hash += M_get16bits(data);
+		hash ^= hash << 11;
+		hash += hash >> 17;
+		break;
+	case 1: hash += (signed char)*data;
+		hash ^= hash << 10;
+		hash += hash >> 1;
+	}
+
+	hash ^= hash << 3;
+	hash += hash >> 5;
+	hash ^= hash << 4;
+	hash += hash >> 17;
+	hash ^= hash << 25;
+	hash += hash >> 6;
+
+	return hash;
+}
+
+static U64 HashStreaming(const void* data, Size size)
+{
+	static constexpr Size k_ChunkSize = 64 * 1024;
+	auto hasher = Hasher();
+	auto input = static_cast<const U8*>(data);
+	for (Size offset = 0; offset < size; offset += k_ChunkSize)
+	{
+		hasher.Update(input + offset, std::min(k_ChunkSize, size - offset));
+	}
+	return hasher.Digest();
+}
+
+// Hashes buffers of the given size until totalSize bytes went through, returns GB/s
+template<typename Func>
+static F64 Measure(const List<U8>& data, Size size, Size totalSize, Func&& func)
+{
+	auto iterations = std::max<Size>(1, totalSize / size);
+	auto sink = U64(0);
+	auto start = std::chrono::steady_clock::now();
+	for (Size i = 0; i < iterations; i++)
+	{
+		// vary the start so every call sees different data
+		sink += func(data.data() + (i * 64) % (data.size() - size + 1), size);
+	}
+	auto seconds = std::chrono::duration<F64>(std::chrono::steady_clock::now() - start).count();
+
+	// keep the results alive
+	static volatile U64 s_Sink = 0;
+	s_Sink = s_Sink + sink;
+	return static_cast<F64>(iterations * size) / seconds / 1e9;
+}
+
+int main(int argc, char** argv)
+{
+	auto totalSize = static_cast<Size>(argc > 1 ? std::atoll(argv[1]) : 512) * 1024 * 1024;
+
+	static constexpr Array<Size, 7> k_Sizes = { 16, 64, 256, 4 * 1024, 64 * 1024, 1024 * 1024, 64 * 1024 * 1024 };
+	auto data = List<U8>(k_Sizes.back() + 64 * 1024);
+	auto state = U64(0x9E3779B97F4A7C15ull);
+	for (auto& byte : data)
+	{
+		state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+		byte = static_cast<U8>(state);
+	}
+
+	std::printf("%12s %16s %16s %16s\n", "size", "superfast GB/s", "xxh64 GB/s", "streaming GB/s");
+	for (auto size : k_Sizes)
+	{
+		auto legacy = Measure(data, size, totalSize, SuperFastHash);
+		auto oneShot = Measure(data, size, totalSize, [](const void* input, Size length) { return Hash64(input, length); });
+		auto streaming = Measure(data, size, totalSize, HashStreaming);
+		std::printf("%12zu %16.2f %16.2f %16.2f\n", size, legacy, oneShot, streaming);
+	}
+	return 0;
+}
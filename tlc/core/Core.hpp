@@ -30,6 +30,7 @@
 #include <sys/resource.h>
 #include <sys/wait.h>
 #include <sys/ioctl.h>
+#include <csignal>
 #endif
 
 // define TLC_DEBUG
@@ -56,6 +57,7 @@
 #include <chrono>
 #include <thread>
 #include <mutex>
+#include <shared_mutex>
 #include <atomic>
 #include <condition_variable>
 #include <future>
@@ -75,11 +77,13 @@
 #include <limits>
 #include <filesystem>
 #include <ranges>
+#include <span>
+#include <string_view>
 #include <stack>
 #include <queue>
 
 // core includes
-#include "core/UUID.hpp"
+#include "core/Uuid.hpp"
 #include "core/Types.hpp"
 #include "core/Logger.hpp"
 #include "core/Utils.hpp"
@@ -94,10 +98,16 @@
 // assert
 
 #ifdef TLC_DEBUG
+#if defined(PLATFORM_WINDOWS)
+#define TLC_DEBUG_BREAK() __debugbreak()
+#else
+#define TLC_DEBUG_BREAK() raise(SIGTRAP)
+#endif
+
 #define TLC_ASSERT(condition, message) { \
 	if (!(condition)) { \
 		log::Error("Assertion failed: {0} in {1} at {2}:{3}", message, __FUNCTION__, __FILE__, __LINE__); \
-		__debugbreak(); \
+		TLC_DEBUG_BREAK(); \
 	} \
 }
 #else
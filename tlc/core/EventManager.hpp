@@ -17,7 +17,8 @@ namespace tlc
 		None = 0,
 		WindowClose, WindowSize, WindowPos, WindowCursorPos, WindowMouseButton,
 		WindowKey, WindowChar, WindowScroll, WindowFocus, WindowFramebufferSize,
-		SwapchainRecreate
+		SwapchainRecreate,
+		AssetChanged
 	};
 
 
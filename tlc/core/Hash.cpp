@@ -0,0 +1,174 @@
+#include "core/Hash.hpp"
+
+#include <bit>
+
+namespace tlc
+{
+	static constexpr U64 k_Prime1 = 0x9E3779B185EBCA87ull;
+	static constexpr U64 k_Prime2 = 0xC2B2AE3D27D4EB4Full;
+	static constexpr U64 k_Prime3 = 0x165667B19E3779F9ull;
+	static constexpr U64 k_Prime4 = 0x85EBCA77C2B2AE63ull;
+	static constexpr U64 k_Prime5 = 0x27D4EB2F165667C5ull;
+
+	static inline U64 Read64(const U8* data)
+	{
+		U64 value = 0;
+		std::memcpy(&value, data, sizeof(U64));
+		return value;
+	}
+
+	static inline U32 Read32(const U8* data)
+	{
+		U32 value = 0;
+		std::memcpy(&value, data, sizeof(U32));
+		return value;
+	}
+
+	static inline U64 Round(U64 lane, U64 input)
+	{
+		lane += input * k_Prime2;
+		lane = std::rotl(lane, 31);
+		return lane * k_Prime1;
+	}
+
+	static inline U64 MergeRound(U64 hash, U64 lane)
+	{
+		hash ^= Round(0, lane);
+		return hash * k_Prime1 + k_Prime4;
+	}
+
+	static inline void InitLanes(U64 lanes[4], U64 seed)
+	{
+		lanes[0] = seed + k_Prime1 + k_Prime2;
+		lanes[1] = seed + k_Prime2;
+		lanes[2] = seed;
+		lanes[3] = seed - k_Prime1;
+	}
+
+	// Consumes whole 32 byte stripes, the four lanes are independent so the
+	// multiplies of a stripe can run in parallel
+	static inline const U8* ConsumeStripes(U64 lanes[4], const U8* data, const U8* end)
+	{
+		auto lane0 = lanes[0], lane1 = lanes[1], lane2 = lanes[2], lane3 = lanes[3];
+		for (; data + 32 <= end; data += 32)
+		{
+			lane0 = Round(lane0, Read64(data));
+			lane1 = Round(lane1, Read64(data + 8));
+			lane2 = Round(lane2, Read64(data + 16));
+			lane3 = Round(lane3, Read64(data + 24));
+		}
+		lanes[0] = lane0; lanes[1] = lane1; lanes[2] = lane2; lanes[3] = lane3;
+		return data;
+	}
+
+	static inline U64 Finalize(U64 hash, const U8* data, Size size)
+	{
+		for (; size >= 8; size -= 8, data += 8)
+		{
+			hash ^= Round(0, Read64(data));
+			hash = std::rotl(hash, 27) * k_Prime1 + k_Prime4;
+		}
+
+		if (size >= 4)
+		{
+			hash ^= static_cast<U64>(Read32(data)) * k_Prime1;
+			hash = std::rotl(hash, 23) * k_Prime2 + k_Prime3;
+			size -= 4;
+			data += 4;
+		}
+
+		for (; size > 0; size--, data++)
+		{
+			hash ^= static_cast<U64>(*data) * k_Prime5;
+			hash = std::rotl(hash, 11) * k_Prime1;
+		}
+
+		// avalanche
+		hash ^= hash >> 33;
+		hash *= k_Prime2;
+		hash ^= hash >> 29;
+		hash *= k_Prime3;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+	static inline U64 MergeLanes(const U64 lanes[4])
+	{
+		auto hash = std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) + std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18);
+		for (Size i = 0; i < 4; i++)
+		{
+			hash = MergeRound(hash, lanes[i]);
+		}
+		return hash;
+	}
+
+	U64 Hash64(const void* data, Size size, U64 seed)
+	{
+		auto input = static_cast<const U8*>(data);
+		auto end = input + size;
+
+		auto hash = seed + k_Prime5;
+		if (size >= 32)
+		{
+			U64 lanes[4];
+			InitLanes(lanes, seed);
+			input = ConsumeStripes(lanes, input, end);
+			hash = MergeLanes(lanes);
+		}
+
+		hash += static_cast<U64>(size);
+		return Finalize(hash, input, static_cast<Size>(end - input));
+	}
+
+	Hasher::Hasher(U64 seed)
+	{
+		Reset(seed);
+	}
+
+	void Hasher::Reset(U64 seed)
+	{
+		m_Seed = seed;
+		InitLanes(m_Lanes, seed);
+		m_BufferSize = 0;
+		m_TotalSize = 0;
+	}
+
+	void Hasher::Update(const void* data, Size size)
+	{
+		if (size == 0)
+		{
+			return;
+		}
+
+		auto input = static_cast<const U8*>(data);
+		auto end = input + size;
+		m_TotalSize += size;
+
+		// top up a partial stripe left over from the previous update
+		if (m_BufferSize > 0)
+		{
+			auto count = std::min(size, sizeof(m_Buffer) - m_BufferSize);
+			std::memcpy(m_Buffer + m_BufferSize, input, count);
+			m_BufferSize += count;
+			input += count;
+			if (m_BufferSize < sizeof(m_Buffer))
+			{
+				return;
+			}
+
+			ConsumeStripes(m_Lanes, m_Buffer, m_Buffer + sizeof(m_Buffer));
+			m_BufferSize = 0;
+		}
+
+		input = ConsumeStripes(m_Lanes, input, end);
+		m_BufferSize = static_cast<Size>(end - input);
+		std::memcpy(m_Buffer, input, m_BufferSize);
+	}
+
+	U64 Hasher::Digest() const
+	{
+		auto hash = m_TotalSize >= 32 ? MergeLanes(m_Lanes) : m_Seed + k_Prime5;
+		hash += m_TotalSize;
+		return Finalize(hash, m_Buffer, m_BufferSize);
+	}
+}
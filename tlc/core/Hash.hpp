@@ -0,0 +1,36 @@
+#pragma once
+
+#include "core/Core.hpp"
+
+namespace tlc
+{
+	// XXH64 (xxHash, 64-bit variant). Used for asset payloads, cache versions and anything
+	// else that needs a content hash; the output matches the reference implementation.
+	U64 Hash64(const void* data, Size size, U64 seed = 0);
+
+	// Streaming XXH64, feeding data in any number of pieces gives the same
+	// digest as hashing it in one go with Hash64
+	class Hasher
+	{
+	public:
+		Hasher(U64 seed = 0);
+
+		void Reset(U64 seed = 0);
+		void Update(const void* data, Size size);
+		U64 Digest() const;
+
+		template<typename T>
+		inline void UpdateValue(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "Only plain values can be hashed directly");
+			Update(&value, sizeof(T));
+		}
+
+	private:
+		U64 m_Seed = 0;
+		U64 m_Lanes[4] = {};
+		U8 m_Buffer[32] = {};
+		Size m_BufferSize = 0;
+		U64 m_TotalSize = 0;
+	};
+}
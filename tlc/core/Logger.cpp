@@ -12,7 +12,9 @@
 #include <iomanip>
 #include <sstream>
 
+#if defined(_WIN32)
 #include <Windows.h>
+#endif
 
 namespace tlc
 {
@@ -0,0 +1,124 @@
+#include "core/MappedFile.hpp"
+
+#if defined(PLATFORM_LINUX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+namespace tlc
+{
+	MappedFile::MappedFile(const String& filepath)
+	{
+		m_Path = filepath;
+
+#if defined(PLATFORM_WINDOWS)
+		// files may be appended to, replaced or deleted while mapped (eg. the cache data file)
+		m_FileHandle = ::CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (m_FileHandle == INVALID_HANDLE_VALUE)
+		{
+			log::Error("Failed to open file '{}' for mapping", filepath);
+			return;
+		}
+
+		LARGE_INTEGER fileSize = {};
+		if (!::GetFileSizeEx(m_FileHandle, &fileSize))
+		{
+			log::Error("Failed to query size of file '{}'", filepath);
+			Cleanup();
+			return;
+		}
+		m_Size = static_cast<Size>(fileSize.QuadPart);
+
+		// empty files cannot be mapped, but are still valid
+		if (m_Size > 0)
+		{
+			m_MappingHandle = ::CreateFileMappingA(m_FileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (m_MappingHandle == NULL)
+			{
+				log::Error("Failed to create file mapping for '{}'", filepath);
+				Cleanup();
+				return;
+			}
+
+			m_Data = static_cast<Raw<U8>>(::MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+			if (m_Data == nullptr)
+			{
+				log::Error("Failed to map view of file '{}'", filepath);
+				Cleanup();
+				return;
+			}
+		}
+#else
+		auto fileDescriptor = ::open(filepath.c_str(), O_RDONLY);
+		if (fileDescriptor < 0)
+		{
+			log::Error("Failed to open file '{}' for mapping", filepath);
+			return;
+		}
+
+		struct stat fileStat = {};
+		if (::fstat(fileDescriptor, &fileStat) != 0)
+		{
+			log::Error("Failed to query size of file '{}'", filepath);
+			::close(fileDescriptor);
+			return;
+		}
+		m_Size = static_cast<Size>(fileStat.st_size);
+
+		// empty files cannot be mapped, but are still valid
+		if (m_Size > 0)
+		{
+			auto data = ::mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+			if (data == MAP_FAILED)
+			{
+				log::Error("Failed to map file '{}'", filepath);
+				::close(fileDescriptor);
+				m_Size = 0;
+				return;
+			}
+			m_Data = static_cast<Raw<U8>>(data);
+		}
+
+		// the mapping stays valid after the descriptor is closed
+		::close(fileDescriptor);
+#endif
+
+		m_IsReady = true;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		Cleanup();
+	}
+
+	void MappedFile::Cleanup()
+	{
+#if defined(PLATFORM_WINDOWS)
+		if (m_Data != nullptr)
+		{
+			::UnmapViewOfFile(m_Data);
+		}
+
+		if (m_MappingHandle != NULL)
+		{
+			::CloseHandle(m_MappingHandle);
+			m_MappingHandle = NULL;
+		}
+
+		if (m_FileHandle != INVALID_HANDLE_VALUE)
+		{
+			::CloseHandle(m_FileHandle);
+			m_FileHandle = INVALID_HANDLE_VALUE;
+		}
+#else
+		if (m_Data != nullptr)
+		{
+			::munmap(m_Data, m_Size);
+		}
+#endif
+
+		m_Data = nullptr;
+		m_Size = 0;
+		m_IsReady = false;
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "core/Core.hpp"
+
+namespace tlc
+{
+	// Read-only memory mapping of a whole file, the mapping base is always page aligned
+	class MappedFile
+	{
+	public:
+		MappedFile(const String& filepath);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		inline Bool IsReady() const { return m_IsReady; }
+		inline const U8* GetData() const { return m_Data; }
+		inline Size GetSize() const { return m_Size; }
+		inline const String& GetPath() const { return m_Path; }
+
+	private:
+		void Cleanup();
+
+	private:
+		String m_Path = "";
+		Raw<U8> m_Data = nullptr;
+		Size m_Size = 0;
+		Bool m_IsReady = false;
+
+#if defined(PLATFORM_WINDOWS)
+		HANDLE m_FileHandle = INVALID_HANDLE_VALUE;
+		HANDLE m_MappingHandle = NULL;
+#endif
+	};
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "core/Core.hpp"
+
+namespace tlc
+{
+	// Read-only view of memory owned elsewhere (a mapped bundle, a cache entry, ...).
+	// The handle shares ownership of that memory, so the view stays valid for as long
+	// as the handle lives even if its owner unloads or replaces the data meanwhile.
+	class PinnedData
+	{
+	public:
+		PinnedData() = default;
+		PinnedData(Ref<const void> owner, Raw<const U8> data, Size size)
+			: m_Owner(std::move(owner)), m_Data(data), m_Size(size)
+		{
+		}
+
+		inline Bool IsValid() const { return m_Data != nullptr; }
+		inline Raw<const U8> GetData() const { return m_Data; }
+		inline Size GetSize() const { return m_Size; }
+
+		inline StringView AsString() const
+		{
+			return StringView(reinterpret_cast<const char*>(m_Data), m_Size);
+		}
+
+		// View of a part of the data, sharing the ownership of the whole
+		inline PinnedData Slice(Size offset, Size size) const
+		{
+			TLC_ASSERT(offset <= m_Size && size <= m_Size - offset, "PinnedData slice is out of bounds");
+			return PinnedData(m_Owner, m_Data + offset, size);
+		}
+
+		// The data has to be aligned for T, trailing bytes that do not fill a whole T are left out
+		template<typename T>
+		inline std::span<const T> As() const
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "Only plain values can be viewed directly");
+			TLC_ASSERT(reinterpret_cast<uintptr_t>(m_Data) % alignof(T) == 0, "PinnedData is not aligned for the requested type");
+			return std::span<const T>(reinterpret_cast<const T*>(m_Data), m_Size / sizeof(T));
+		}
+
+	private:
+		Ref<const void> m_Owner = nullptr;
+		Raw<const U8> m_Data = nullptr;
+		Size m_Size = 0;
+	};
+}
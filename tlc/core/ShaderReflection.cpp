@@ -0,0 +1,604 @@
+#include "core/ShaderReflection.hpp"
+
+namespace tlc
+{
+	// Just the parts of the SPIR-V specification needed to find the interface of a module
+	namespace spirv
+	{
+		static constexpr U32 k_Magic = 0x07230203;
+		static constexpr Size k_HeaderWords = 5;
+
+		enum Op : U32
+		{
+			OpEntryPoint = 15,
+			OpExecutionMode = 16,
+			OpTypeBool = 20,
+			OpTypeInt = 21,
+			OpTypeFloat = 22,
+			OpTypeVector = 23,
+			OpTypeMatrix = 24,
+			OpTypeImage = 25,
+			OpTypeSampler = 26,
+			OpTypeSampledImage = 27,
+			OpTypeArray = 28,
+			OpTypeRuntimeArray = 29,
+			OpTypeStruct = 30,
+			OpTypePointer = 32,
+			OpConstant = 43,
+			OpSpecConstant = 50,
+			OpVariable = 59,
+			OpDecorate = 71,
+			OpMemberDecorate = 72,
+			OpExecutionModeId = 331,
+			OpTypeAccelerationStructure = 5341,
+		};
+
+		enum Decoration : U32
+		{
+			DecorationBlock = 2,
+			DecorationBufferBlock = 3,
+			DecorationArrayStride = 6,
+			DecorationMatrixStride = 7,
+			DecorationBuiltIn = 11,
+			DecorationLocation = 30,
+			DecorationBinding = 33,
+			DecorationDescriptorSet = 34,
+			DecorationOffset = 35,
+		};
+
+		enum StorageClass : U32
+		{
+			StorageClassUniformConstant = 0,
+			StorageClassInput = 1,
+			StorageClassUniform = 2,
+			StorageClassPushConstant = 9,
+			StorageClassStorageBuffer = 12,
+		};
+
+		static constexpr U32 k_ExecutionModelVertex = 0;
+		static constexpr U32 k_ExecutionModelFragment = 4;
+		static constexpr U32 k_ExecutionModelGLCompute = 5;
+		static constexpr U32 k_ExecutionModeLocalSize = 17;
+		static constexpr U32 k_ExecutionModeLocalSizeId = 38;
+		static constexpr U32 k_DimBuffer = 5;
+		static constexpr U32 k_DimSubpassData = 6;
+	}
+
+	// Indexes the module by result id, every query afterwards is a lookup
+	class SpirvModule
+	{
+	public:
+		struct Decorations
+		{
+			std::optional<U32> Location;
+			std::optional<U32> Binding;
+			std::optional<U32> DescriptorSet;
+			U32 ArrayStride = 0;
+			Bool BuiltIn = false;
+			Bool Block = false;
+			Bool BufferBlock = false;
+		};
+
+		struct MemberDecorations
+		{
+			U32 Offset = 0;
+			U32 MatrixStride = 0;
+			Bool BuiltIn = false;
+		};
+
+		Bool Parse(std::span<const U32> words)
+		{
+			if (words.size() < spirv::k_HeaderWords || words[0] != spirv::k_Magic)
+			{
+				log::Error("ShaderReflection: not a SPIR-V module");
+				return false;
+			}
+
+			m_Words = words;
+			auto bound = words[3];
+			m_Definitions.assign(bound, 0);
+			m_Decorations.resize(bound);
+
+			for (Size offset = spirv::k_HeaderWords; offset < words.size();)
+			{
+				auto wordCount = words[offset] >> 16;
+				auto op = words[offset] & 0xffff;
+				if (wordCount == 0 || offset + wordCount > words.size())
+				{
+					log::Error("ShaderReflection: truncated instruction at word {}", offset);
+					return false;
+				}
+
+				auto operands = words.subspan(offset + 1, wordCount - 1);
+				switch (op)
+				{
+				case spirv::OpEntryPoint:
+					if (operands.size() >= 2)
+					{
+						m_ExecutionModel = operands[0];
+					}
+					break;
+				case spirv::OpExecutionMode:
+				case spirv::OpExecutionModeId:
+					if (operands.size() >= 5 && (operands[1] == spirv::k_ExecutionModeLocalSize || operands[1] == spirv::k_ExecutionModeLocalSizeId))
+					{
+						m_LocalSize = { operands[2], operands[3], operands[4] };
+						m_LocalSizeIsId = operands[1] == spirv::k_ExecutionModeLocalSizeId;
+					}
+					break;
+				case spirv::OpDecorate:
+					if (operands.size() >= 2 && operands[0] < bound)
+					{
+						Decorate(m_Decorations[operands[0]], operands[1], operands.size() >= 3 ? operands[2] : 0);
+					}
+					break;
+				case spirv::OpMemberDecorate:
+					if (operands.size() >= 3)
+					{
+						DecorateMember(m_MemberDecorations[MemberKey(operands[0], operands[1])], operands[2], operands.size() >= 4 ? operands[3] : 0);
+					}
+					break;
+				case spirv::OpConstant:
+				case spirv::OpSpecConstant:
+					// result type, result id, value
+					if (operands.size() >= 3 && operands[1] < bound)
+					{
+						m_Definitions[operands[1]] = offset;
+					}
+					break;
+				case spirv::OpVariable:
+					if (operands.size() >= 3)
+					{
+						m_Variables.push_back(offset);
+					}
+					break;
+				default:
+					// type declarations have their result id first
+					if (IsType(op) && wordCount >= GetMinimumTypeWordCount(op) && operands[0] < bound)
+					{
+						m_Definitions[operands[0]] = offset;
+					}
+					break;
+				}
+				offset += wordCount;
+			}
+			return true;
+		}
+
+		inline U32 GetExecutionModel() const { return m_ExecutionModel; }
+		inline const List<Size>& GetVariables() const { return m_Variables; }
+
+		Array<U32, 3> GetLocalSize() const
+		{
+			if (!m_LocalSizeIsId)
+			{
+				return m_LocalSize;
+			}
+			return { GetConstant(m_LocalSize[0], 1), GetConstant(m_LocalSize[1], 1), GetConstant(m_LocalSize[2], 1) };
+		}
+
+		// The instruction defining a type, constant or variable, empty if there is none
+		std::span<const U32> GetInstruction(U32 id) const
+		{
+			if (id >= m_Definitions.size() || m_Definitions[id] == 0)
+			{
+				return {};
+			}
+			auto offset = m_Definitions[id];
+			return m_Words.subspan(offset, m_Words[offset] >> 16);
+		}
+
+		std::span<const U32> GetInstructionAt(Size offset) const
+		{
+			return m_Words.subspan(offset, m_Words[offset] >> 16);
+		}
+
+		inline U32 GetOp(std::span<const U32> instruction) const
+		{
+			return instruction.empty() ? 0 : instruction[0] & 0xffff;
+		}
+
+		U32 GetConstant(U32 id, U32 fallback) const
+		{
+			auto instruction = GetInstruction(id);
+			auto op = GetOp(instruction);
+			if ((op != spirv::OpConstant && op != spirv::OpSpecConstant) || instruction.size() < 4)
+			{
+				return fallback;
+			}
+			return instruction[3];
+		}
+
+		const Decorations& GetDecorations(U32 id) const
+		{
+			static const Decorations k_None = {};
+			return id < m_Decorations.size() ? m_Decorations[id] : k_None;
+		}
+
+		const MemberDecorations& GetMemberDecorations(U32 structId, U32 member) const
+		{
+			static const MemberDecorations k_None = {};
+			auto it = m_MemberDecorations.find(MemberKey(structId, member));
+			return it != m_MemberDecorations.end() ? it->second : k_None;
+		}
+
+		// Size in bytes of a type laid out with its explicit offsets and strides
+		U32 GetTypeSize(U32 typeId, U32 matrixStride = 0) const
+		{
+			auto instruction = GetInstruction(typeId);
+			switch (GetOp(instruction))
+			{
+			case spirv::OpTypeBool:
+				return 4;
+			case spirv::OpTypeInt:
+			case spirv::OpTypeFloat:
+				return instruction[2] / 8;
+			case spirv::OpTypeVector:
+				return GetTypeSize(instruction[2]) * instruction[3];
+			case spirv::OpTypeMatrix:
+			{
+				auto columnSize = matrixStride != 0 ? matrixStride : GetTypeSize(instruction[2]);
+				return columnSize * instruction[3];
+			}
+			case spirv::OpTypeArray:
+			{
+				auto stride = GetDecorations(typeId).ArrayStride;
+				if (stride == 0)
+				{
+					stride = GetTypeSize(instruction[2], matrixStride);
+				}
+				return stride * GetConstant(instruction[3], 1);
+			}
+			case spirv::OpTypeStruct:
+			{
+				auto size = U32(0);
+				for (U32 member = 0; member + 2 < instruction.size(); member++)
+				{
+					const auto& decorations = GetMemberDecorations(typeId, member);
+					size = std::max(size, decorations.Offset + GetTypeSize(instruction[member + 2], decorations.MatrixStride));
+				}
+				return size;
+			}
+			default:
+				// runtime arrays and opaque types have no size
+				return 0;
+			}
+		}
+
+	private:
+		static inline U64 MemberKey(U32 structId, U32 member)
+		{
+			return (static_cast<U64>(structId) << 32) | member;
+		}
+
+		static inline Bool IsType(U32 op)
+		{
+			return (op >= spirv::OpTypeBool && op <= spirv::OpTypePointer) || op == spirv::OpTypeAccelerationStructure;
+		}
+
+		// so the operands read by the queries always exist
+		static inline U32 GetMinimumTypeWordCount(U32 op)
+		{
+			switch (op)
+			{
+			case spirv::OpTypeInt: return 4;
+			case spirv::OpTypeFloat: return 3;
+			case spirv::OpTypeVector: return 4;
+			case spirv::OpTypeMatrix: return 4;
+			case spirv::OpTypeImage: return 9;
+			case spirv::OpTypeSampledImage: return 3;
+			case spirv::OpTypeArray: return 4;
+			case spirv::OpTypeRuntimeArray: return 3;
+			case spirv::OpTypePointer: return 4;
+			default: return 2;
+			}
+		}
+
+		static void Decorate(Decorations& decorations, U32 decoration, U32 value)
+		{
+			switch (decoration)
+			{
+			case spirv::DecorationBlock: decorations.Block = true; break;
+			case spirv::DecorationBufferBlock: decorations.BufferBlock = true; break;
+			case spirv::DecorationArrayStride: decorations.ArrayStride = value; break;
+			case spirv::DecorationBuiltIn: decorations.BuiltIn = true; break;
+			case spirv::DecorationLocation: decorations.Location = value; break;
+			case spirv::DecorationBinding: decorations.Binding = value; break;
+			case spirv::DecorationDescriptorSet: decorations.DescriptorSet = value; break;
+			default: break;
+			}
+		}
+
+		static void DecorateMember(MemberDecorations& decorations, U32 decoration, U32 value)
+		{
+			switch (decoration)
+			{
+			case spirv::DecorationOffset: decorations.Offset = value; break;
+			case spirv::DecorationMatrixStride: decorations.MatrixStride = value; break;
+			case spirv::DecorationBuiltIn: decorations.BuiltIn = true; break;
+			default: break;
+			}
+		}
+
+	private:
+		std::span<const U32> m_Words;
+		List<Size> m_Definitions; // result id -> word offset of its instruction
+		List<Decorations> m_Decorations;
+		UnorderedMap<U64, MemberDecorations> m_MemberDecorations;
+		List<Size> m_Variables;
+		U32 m_ExecutionModel = ~0u;
+		Array<U32, 3> m_LocalSize = { 0, 0, 0 };
+		Bool m_LocalSizeIsId = false;
+	};
+
+	static std::optional<ShaderDescriptorType> GetDescriptorType(const SpirvModule& module, U32 storageClass, U32 typeId)
+	{
+		auto type = module.GetInstruction(typeId);
+		switch (storageClass)
+		{
+		case spirv::StorageClassUniformConstant:
+			switch (module.GetOp(type))
+			{
+			case spirv::OpTypeSampler:
+				return ShaderDescriptorType::Sampler;
+			case spirv::OpTypeSampledImage:
+				return ShaderDescriptorType::CombinedImageSampler;
+			case spirv::OpTypeAccelerationStructure:
+				return ShaderDescriptorType::AccelerationStructure;
+			case spirv::OpTypeImage:
+			{
+				// result, sampled type, dim, depth, arrayed, ms, sampled, format
+				if (type.size() < 8)
+				{
+					return std::nullopt;
+				}
+				auto dim = type[3];
+				auto sampled = type[7];
+				if (dim == spirv::k_DimSubpassData)
+				{
+					return ShaderDescriptorType::InputAttachment;
+				}
+				if (dim == spirv::k_DimBuffer)
+				{
+					return sampled == 1 ? ShaderDescriptorType::UniformTexelBuffer : ShaderDescriptorType::StorageTexelBuffer;
+				}
+				return sampled == 1 ? ShaderDescriptorType::SampledImage : ShaderDescriptorType::StorageImage;
+			}
+			default:
+				return std::nullopt;
+			}
+		case spirv::StorageClassUniform:
+			// storage buffers were uniform blocks decorated BufferBlock before SPIR-V 1.3
+			return module.GetDecorations(typeId).BufferBlock ? ShaderDescriptorType::StorageBuffer : ShaderDescriptorType::UniformBuffer;
+		case spirv::StorageClassStorageBuffer:
+			return ShaderDescriptorType::StorageBuffer;
+		default:
+			return std::nullopt;
+		}
+	}
+
+	// One input per location, matrices and arrays take several
+	static void AddVertexInputs(const SpirvModule& module, U32 typeId, U32 location, List<ShaderVertexInput>& inputs)
+	{
+		auto type = module.GetInstruction(typeId);
+		switch (module.GetOp(type))
+		{
+		case spirv::OpTypeInt:
+		case spirv::OpTypeFloat:
+		{
+			auto input = ShaderVertexInput();
+			input.Location = location;
+			input.ScalarType = module.GetOp(type) == spirv::OpTypeFloat ? ShaderScalarType::Float : (type[3] != 0 ? ShaderScalarType::Int : ShaderScalarType::UInt);
+			input.ScalarSize = type[2] / 8;
+			input.ComponentCount = 1;
+			inputs.push_back(input);
+			break;
+		}
+		case spirv::OpTypeVector:
+			AddVertexInputs(module, type[2], location, inputs);
+			if (!inputs.empty() && inputs.back().Location == location)
+			{
+				inputs.back().ComponentCount = type[3];
+			}
+			break;
+		case spirv::OpTypeMatrix:
+			for (U32 column = 0; column < type[3]; column++)
+			{
+				AddVertexInputs(module, type[2], location + column, inputs);
+			}
+			break;
+		case spirv::OpTypeArray:
+		{
+			auto length = module.GetConstant(type[3], 1);
+			auto elementType = module.GetInstruction(type[2]);
+			auto elementLocations = module.GetOp(elementType) == spirv::OpTypeMatrix ? elementType[3] : 1;
+			for (U32 i = 0; i < length; i++)
+			{
+				AddVertexInputs(module, type[2], location + i * elementLocations, inputs);
+			}
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	Bool ShaderReflection::Reflect(std::span<const U32> spirv, ShaderReflection& reflection)
+	{
+		auto module = SpirvModule();
+		if (!module.Parse(spirv))
+		{
+			return false;
+		}
+
+		reflection = ShaderReflection();
+		switch (module.GetExecutionModel())
+		{
+		case spirv::k_ExecutionModelVertex: reflection.Stage = ShaderStage::Vertex; break;
+		case spirv::k_ExecutionModelFragment: reflection.Stage = ShaderStage::Fragment; break;
+		case spirv::k_ExecutionModelGLCompute: reflection.Stage = ShaderStage::Compute; break;
+		default:
+			log::Error("ShaderReflection: unsupported execution model: {}", module.GetExecutionModel());
+			return false;
+		}
+
+		if (reflection.Stage == ShaderStage::Compute)
+		{
+			reflection.WorkgroupSize = module.GetLocalSize();
+		}
+
+		for (auto offset : module.GetVariables())
+		{
+			// result type, result id, storage class
+			auto variable = module.GetInstructionAt(offset);
+			auto variableId = variable[2];
+			auto storageClass = variable[3];
+			auto pointer = module.GetInstruction(variable[1]);
+			if (module.GetOp(pointer) != spirv::OpTypePointer || pointer.size() < 4)
+			{
+				continue;
+			}
+			auto typeId = pointer[3];
+			const auto& decorations = module.GetDecorations(variableId);
+
+			if (storageClass == spirv::StorageClassPushConstant)
+			{
+				auto type = module.GetInstruction(typeId);
+				if (module.GetOp(type) != spirv::OpTypeStruct || type.size() <= 2)
+				{
+					continue;
+				}
+
+				auto begin = ~0u;
+				for (U32 member = 0; member + 2 < type.size(); member++)
+				{
+					begin = std::min(begin, module.GetMemberDecorations(typeId, member).Offset);
+				}
+				reflection.PushConstants.push_back({ begin, module.GetTypeSize(typeId) - begin });
+				continue;
+			}
+
+			if (storageClass == spirv::StorageClassInput)
+			{
+				if (reflection.Stage == ShaderStage::Vertex && decorations.Location && !decorations.BuiltIn)
+				{
+					AddVertexInputs(module, typeId, *decorations.Location, reflection.VertexInputs);
+				}
+				continue;
+			}
+
+			// arrays of descriptors, down to the element type
+			auto count = U32(1);
+			auto type = module.GetInstruction(typeId);
+			while (module.GetOp(type) == spirv::OpTypeArray || module.GetOp(type) == spirv::OpTypeRuntimeArray)
+			{
+				count = module.GetOp(type) == spirv::OpTypeArray ? count * module.GetConstant(type[3], 1) : 0;
+				typeId = type[2];
+				type = module.GetInstruction(typeId);
+			}
+
+			auto descriptorType = GetDescriptorType(module, storageClass, typeId);
+			if (!descriptorType)
+			{
+				continue;
+			}
+
+			auto binding = ShaderDescriptorBinding();
+			binding.Set = decorations.DescriptorSet.value_or(0);
+			binding.Binding = decorations.Binding.value_or(0);
+			binding.Type = *descriptorType;
+			binding.Count = count;
+			reflection.Bindings.push_back(binding);
+		}
+
+		std::sort(reflection.Bindings.begin(), reflection.Bindings.end(), [](const auto& a, const auto& b) {
+			return std::tie(a.Set, a.Binding) < std::tie(b.Set, b.Binding);
+		});
+		std::sort(reflection.VertexInputs.begin(), reflection.VertexInputs.end(), [](const auto& a, const auto& b) {
+			return a.Location < b.Location;
+		});
+		return true;
+	}
+
+	static constexpr U32 k_ShaderReflectionMagic = 0x52534C54; // "TLSR"
+	static constexpr U32 k_ShaderReflectionVersion = 1;
+
+	struct ShaderReflectionHeader
+	{
+		U32 Magic = k_ShaderReflectionMagic;
+		U32 Version = k_ShaderReflectionVersion;
+		U32 Stage = 0;
+		U32 BindingCount = 0;
+		U32 PushConstantCount = 0;
+		U32 VertexInputCount = 0;
+		U32 WorkgroupSize[3] = {};
+	};
+
+	static_assert(sizeof(ShaderReflectionHeader) == 36, "ShaderReflectionHeader must be tightly packed");
+	static_assert(std::is_trivially_copyable_v<ShaderDescriptorBinding> && sizeof(ShaderDescriptorBinding) == 16, "ShaderDescriptorBinding is stored as is");
+	static_assert(std::is_trivially_copyable_v<ShaderPushConstantBlock> && sizeof(ShaderPushConstantBlock) == 8, "ShaderPushConstantBlock is stored as is");
+	static_assert(std::is_trivially_copyable_v<ShaderVertexInput> && sizeof(ShaderVertexInput) == 16, "ShaderVertexInput is stored as is");
+
+	template<typename T>
+	static void AppendItems(List<U8>& data, const List<T>& items)
+	{
+		auto bytes = reinterpret_cast<const U8*>(items.data());
+		data.insert(data.end(), bytes, bytes + items.size() * sizeof(T));
+	}
+
+	template<typename T>
+	static Bool ReadItems(const U8*& data, const U8* end, U32 count, List<T>& items)
+	{
+		if (static_cast<Size>(end - data) < count * sizeof(T))
+		{
+			return false;
+		}
+		items.resize(count);
+		if (count > 0)
+		{
+			std::memcpy(items.data(), data, count * sizeof(T));
+		}
+		data += count * sizeof(T);
+		return true;
+	}
+
+	List<U8> ShaderReflection::Serialize() const
+	{
+		auto header = ShaderReflectionHeader();
+		header.Stage = static_cast<U32>(Stage);
+		header.BindingCount = static_cast<U32>(Bindings.size());
+		header.PushConstantCount = static_cast<U32>(PushConstants.size());
+		header.VertexInputCount = static_cast<U32>(VertexInputs.size());
+		std::copy(WorkgroupSize.begin(), WorkgroupSize.end(), header.WorkgroupSize);
+
+		auto data = List<U8>(sizeof(ShaderReflectionHeader));
+		std::memcpy(data.data(), &header, sizeof(ShaderReflectionHeader));
+		AppendItems(data, Bindings);
+		AppendItems(data, PushConstants);
+		AppendItems(data, VertexInputs);
+		return data;
+	}
+
+	Bool ShaderReflection::Deserialize(const U8* data, Size size, ShaderReflection& reflection)
+	{
+		auto header = ShaderReflectionHeader();
+		if (data == nullptr || size < sizeof(ShaderReflectionHeader))
+		{
+			return false;
+		}
+		std::memcpy(&header, data, sizeof(ShaderReflectionHeader));
+		if (header.Magic != k_ShaderReflectionMagic || header.Version != k_ShaderReflectionVersion)
+		{
+			return false;
+		}
+
+		auto end = data + size;
+		data += sizeof(ShaderReflectionHeader);
+		reflection = ShaderReflection();
+		reflection.Stage = static_cast<ShaderStage>(header.Stage);
+		std::copy(std::begin(header.WorkgroupSize), std::end(header.WorkgroupSize), reflection.WorkgroupSize.begin());
+		return ReadItems(data, end, header.BindingCount, reflection.Bindings)
+			&& ReadItems(data, end, header.PushConstantCount, reflection.PushConstants)
+			&& ReadItems(data, end, header.VertexInputCount, reflection.VertexInputs);
+	}
+}
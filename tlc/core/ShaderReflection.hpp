@@ -0,0 +1,76 @@
+#pragma once
+
+#include "core/Core.hpp"
+
+namespace tlc
+{
+	// Same values as VkShaderStageFlagBits
+	enum class ShaderStage : U32
+	{
+		None = 0,
+		Vertex = 0x01,
+		Fragment = 0x10,
+		Compute = 0x20,
+	};
+
+	// Same values as VkDescriptorType
+	enum class ShaderDescriptorType : U32
+	{
+		Sampler = 0,
+		CombinedImageSampler = 1,
+		SampledImage = 2,
+		StorageImage = 3,
+		UniformTexelBuffer = 4,
+		StorageTexelBuffer = 5,
+		UniformBuffer = 6,
+		StorageBuffer = 7,
+		InputAttachment = 10,
+		AccelerationStructure = 1000150000,
+	};
+
+	enum class ShaderScalarType : U32
+	{
+		Float = 0,
+		Int = 1,
+		UInt = 2,
+	};
+
+	struct ShaderDescriptorBinding
+	{
+		U32 Set = 0;
+		U32 Binding = 0;
+		ShaderDescriptorType Type = ShaderDescriptorType::UniformBuffer;
+		U32 Count = 1; // 0 for runtime sized arrays
+	};
+
+	struct ShaderPushConstantBlock
+	{
+		U32 Offset = 0; // of the first member
+		U32 Size = 0;
+	};
+
+	struct ShaderVertexInput
+	{
+		U32 Location = 0;
+		ShaderScalarType ScalarType = ShaderScalarType::Float;
+		U32 ScalarSize = 4; // in bytes
+		U32 ComponentCount = 1;
+	};
+
+	// The interface of a compiled shader, read from the decorations of the SPIR-V module
+	// (so it does not need debug names and works on stripped modules). Stored in the
+	// cache next to the SPIR-V so pipelines never have to parse the module themselves.
+	struct ShaderReflection
+	{
+		ShaderStage Stage = ShaderStage::None;
+		List<ShaderDescriptorBinding> Bindings; // sorted by set and binding
+		List<ShaderPushConstantBlock> PushConstants;
+		List<ShaderVertexInput> VertexInputs; // vertex shaders only, sorted by location
+		Array<U32, 3> WorkgroupSize = { 0, 0, 0 }; // compute shaders only
+
+		static Bool Reflect(std::span<const U32> spirv, ShaderReflection& reflection);
+
+		List<U8> Serialize() const;
+		static Bool Deserialize(const U8* data, Size size, ShaderReflection& reflection);
+	};
+}
@@ -0,0 +1,121 @@
+#include "core/SpirvStrip.hpp"
+
+namespace tlc
+{
+	namespace spirv
+	{
+		static constexpr U32 k_Magic = 0x07230203;
+		static constexpr Size k_HeaderWords = 5;
+
+		enum Op : U32
+		{
+			OpSourceContinued = 2,
+			OpSource = 3,
+			OpSourceExtension = 4,
+			OpName = 5,
+			OpMemberName = 6,
+			OpString = 7,
+			OpLine = 8,
+			OpExtension = 10,
+			OpExtInstImport = 11,
+			OpExtInst = 12,
+			OpNoLine = 317,
+			OpModuleProcessed = 330,
+		};
+
+		static constexpr StringView k_NonSemanticPrefix = "NonSemantic.";
+		static constexpr StringView k_NonSemanticExtension = "SPV_KHR_non_semantic_info";
+	}
+
+	// Literal strings are packed four characters to a word, little endian, null terminated
+	static String ReadLiteralString(std::span<const U32> words)
+	{
+		auto result = String();
+		for (auto word : words)
+		{
+			for (U32 i = 0; i < 4; i++)
+			{
+				auto c = static_cast<char>((word >> (i * 8)) & 0xff);
+				if (c == '\0')
+				{
+					return result;
+				}
+				result.push_back(c);
+			}
+		}
+		return result;
+	}
+
+	Bool StripSpirvDebugInfo(List<U32>& spirv)
+	{
+		if (spirv.size() < spirv::k_HeaderWords || spirv[0] != spirv::k_Magic)
+		{
+			log::Error("StripSpirvDebugInfo: not a SPIR-V module");
+			return false;
+		}
+
+		// instructions of non-semantic sets are only ever used by other non-semantic instructions
+		auto nonSemanticSets = Set<U32>();
+		for (Size offset = spirv::k_HeaderWords; offset < spirv.size();)
+		{
+			auto wordCount = spirv[offset] >> 16;
+			if (wordCount == 0 || offset + wordCount > spirv.size())
+			{
+				log::Error("StripSpirvDebugInfo: truncated instruction at word {}", offset);
+				return false;
+			}
+
+			auto operands = std::span<const U32>(spirv).subspan(offset + 1, wordCount - 1);
+			if ((spirv[offset] & 0xffff) == spirv::OpExtInstImport && operands.size() >= 2 && ReadLiteralString(operands.subspan(1)).starts_with(spirv::k_NonSemanticPrefix))
+			{
+				nonSemanticSets.insert(operands[0]);
+			}
+			offset += wordCount;
+		}
+
+		auto stripped = List<U32>(spirv.begin(), spirv.begin() + spirv::k_HeaderWords);
+		stripped.reserve(spirv.size());
+		for (Size offset = spirv::k_HeaderWords; offset < spirv.size();)
+		{
+			auto wordCount = spirv[offset] >> 16;
+			auto operands = std::span<const U32>(spirv).subspan(offset + 1, wordCount - 1);
+
+			auto keep = true;
+			switch (spirv[offset] & 0xffff)
+			{
+			case spirv::OpSourceContinued:
+			case spirv::OpSource:
+			case spirv::OpSourceExtension:
+			case spirv::OpName:
+			case spirv::OpMemberName:
+			case spirv::OpString:
+			case spirv::OpLine:
+			case spirv::OpNoLine:
+			case spirv::OpModuleProcessed:
+				keep = false;
+				break;
+			case spirv::OpExtension:
+				keep = nonSemanticSets.empty() || ReadLiteralString(operands) != spirv::k_NonSemanticExtension;
+				break;
+			case spirv::OpExtInstImport:
+				keep = operands.empty() || !nonSemanticSets.contains(operands[0]);
+				break;
+			case spirv::OpExtInst:
+				// result type, result id, set, instruction
+				keep = operands.size() < 3 || !nonSemanticSets.contains(operands[2]);
+				break;
+			default:
+				break;
+			}
+
+			if (keep)
+			{
+				stripped.insert(stripped.end(), spirv.begin() + offset, spirv.begin() + offset + wordCount);
+			}
+			offset += wordCount;
+		}
+
+		spirv = std::move(stripped);
+		return true;
+	}
+}
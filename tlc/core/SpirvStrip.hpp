@@ -0,0 +1,12 @@
+#pragma once
+
+#include "core/Core.hpp"
+
+namespace tlc
+{
+	// Removes what only debuggers and tools read from a SPIR-V module: debug names, the source
+	// text, line information, the passes it went through and non-semantic instruction sets (eg.
+	// NonSemantic.Shader.DebugInfo.100). Decorations are kept, reflection works the same on the
+	// stripped module. Returns false and leaves the module as it was if it is malformed.
+	Bool StripSpirvDebugInfo(List<U32>& spirv);
+}
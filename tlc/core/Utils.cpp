@@ -1,30 +1,22 @@
 #include "core/Utils.hpp"
 #include "core/Core.hpp"
-
-#if (defined(__GNUC__) && defined(__i386__)) || defined(__WATCOMC__) \
-  || defined(_MSC_VER) || defined (__BORLANDC__) || defined (__TURBOC__)
-#define M_get16bits(d) (*((const uint16_t *) (d)))
-#endif
-
-#if !defined (M_get16bits)
-#define M_get16bits(d) ((((uint32_t)(((const uint8_t *)(d))[1])) << 8)\
-                       +(uint32_t)(((const uint8_t *)(d))[0]) )
-#endif
+#include "core/Hash.hpp"
 
 namespace tlc
 {
 	namespace utils
 	{
-		String tlc::utils::GetExecutablePath()
+		String GetExecutablePath()
 		{
 #if defined(PLATFORM_WINDOWS)
 			static CHAR buffer[2048];
 			::GetModuleFileNameA(NULL, buffer, 2048);
 			return String(buffer);
 #else
-			static I8 buffer[2048];
-			readlink("/proc/self/exe", buffer, 2048);
-			return String(buffer);
+			// readlink does not null terminate
+			static char buffer[2048];
+			auto length = readlink("/proc/self/exe", buffer, sizeof(buffer));
+			return String(buffer, length > 0 ? static_cast<Size>(length) : 0);
 #endif
 		}
 
@@ -160,57 +152,55 @@ namespace tlc
 			return 0;
 		}
 
-		U32 HashBuffer(const void* dat, Size len)
+		U64 GetFileModifiedTime(const String& filepath)
 		{
-			const U8* data = static_cast<const U8*>(dat);
-			U32 hash = static_cast<U32>(len);
-			U32 tmp = 0;
-			I32 rem = 0;
-			if (len <= 0 || data == NULL) return 0;
-
-			rem = len & 3;
-			len >>= 2;
-
-			/* Main loop */
-			for (; len > 0; len--) {
-				hash += M_get16bits(data);
-				tmp = (M_get16bits(data + 2) << 11) ^ hash;
-				hash = (hash << 16) ^ tmp;
-				data += 2 * sizeof(U16);
-				hash += hash >> 11;
-			}
-
-			/* Handle end cases */
-			switch (rem) {
-			case 3: hash += M_get16bits(data);
-				hash ^= hash << 16;
-				hash ^= ((signed char)data[sizeof(U16)]) << 18;
-				hash += hash >> 11;
-				break;
-			case 2: hash += M_get16bits(data);
-				hash ^= hash << 11;
-				hash += hash >> 17;
-				break;
-			case 1: hash += (signed char)*data;
-				hash ^= hash << 10;
-				hash += hash >> 1;
+			std::error_code error;
+			auto time = std::filesystem::last_write_time(filepath, error);
+			if (error)
+			{
+				log::Error("Failed to query modification time of '{}'", filepath);
+				return 0;
 			}
+			return static_cast<U64>(time.time_since_epoch().count());
+		}
 
-			/* Force "avalanching" of final 127 bits */
-			hash ^= hash << 3;
-			hash += hash >> 5;
-			hash ^= hash << 4;
-			hash += hash >> 17;
-			hash ^= hash << 25;
-			hash += hash >> 6;
-
-			return hash;
+		U64 HashBuffer(const void* buffer, Size size)
+		{
+			return Hash64(buffer, size);
 		}
 
-		U32 HashBuffer(const List<U8>& buffer)
+		U64 HashBuffer(const List<U8>& buffer)
 		{ 
 			return HashBuffer(buffer.data(), buffer.size());
 		}
+
+		U64 HashFile(const String& filepath, Size* fileSize)
+		{
+			std::ifstream file(filepath, std::ios::binary);
+			if (!file.is_open())
+			{
+				log::Error("Failed to open file '{}' for hashing", filepath);
+				return 0;
+			}
+
+			static constexpr Size k_ChunkSize = 256 * 1024;
+			auto chunk = List<char>(k_ChunkSize);
+			auto hasher = Hasher();
+			auto totalSize = Size(0);
+			while (file)
+			{
+				file.read(chunk.data(), chunk.size());
+				auto count = static_cast<Size>(file.gcount());
+				hasher.Update(chunk.data(), count);
+				totalSize += count;
+			}
+
+			if (fileSize != nullptr)
+			{
+				*fileSize = totalSize;
+			}
+			return hasher.Digest();
+		}
 	
 		List<String> SplitString(const String& str, const String& delimiter)
 		{
@@ -227,5 +217,50 @@ namespace tlc
 			return result;
 		}
 
+		void ParallelFor(Size count, const std::function<void(Size)>& func)
+		{
+			ParallelFor(count, std::thread::hardware_concurrency(), func);
+		}
+
+		void ParallelFor(Size count, Size maxThreads, const std::function<void(Size)>& func)
+		{
+			if (count == 0)
+			{
+				return;
+			}
+
+			auto numThreads = std::min<Size>(std::max<Size>(maxThreads, 1), count);
+			if (numThreads == 1)
+			{
+				for (Size i = 0; i < count; i++)
+				{
+					func(i);
+				}
+				return;
+			}
+
+			// workers pull indices off a shared counter so uneven work items balance out
+			std::atomic<Size> nextIndex = 0;
+			auto worker = [&]() {
+				for (auto i = nextIndex.fetch_add(1); i < count; i = nextIndex.fetch_add(1))
+				{
+					func(i);
+				}
+			};
+
+			List<std::thread> threads;
+			threads.reserve(numThreads - 1);
+			for (Size i = 0; i < numThreads - 1; i++)
+			{
+				threads.emplace_back(worker);
+			}
+			worker();
+
+			for (auto& thread : threads)
+			{
+				thread.join();
+			}
+		}
+
 	}
 }
\ No newline at end of file
@@ -22,10 +22,20 @@ namespace tlc
 		Bool RemoveFile(const String& path);
 
 		Size GetFileSize(const String& filepath);
+		U64 GetFileModifiedTime(const String& filepath);
 
-		U32 HashBuffer(const void* buffer, Size size);
+		// 64-bit content hash (XXH64, see core/Hash.hpp)
+		U64 HashBuffer(const void* buffer, Size size);
 
-		U32 HashBuffer(const List<U8>& buffer);
+		U64 HashBuffer(const List<U8>& buffer);
+		// Hashes a file while reading it in chunks, same result as HashBuffer over its contents
+		U64 HashFile(const String& filepath, Size* fileSize = nullptr);
 		List<String> SplitString(const String& str, const String& delimiter);
+
+		// Runs func(index) for every index in [0, count) across the available hardware threads
+		// and blocks until all of them are done
+		void ParallelFor(Size count, const std::function<void(Size)>& func);
+		// As above on at most maxThreads threads, the calling one included
+		void ParallelFor(Size count, Size maxThreads, const std::function<void(Size)>& func);
 	}
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "core/Uuid.hpp"
 
+#include <cstring>
 #include <random>
 #include <chrono>
 
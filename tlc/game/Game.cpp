@@ -9,6 +9,7 @@
 #include "services/renderer/PresentationRenderer.hpp"
 #include "services/renderer/DebugUIManager.hpp"
 #include "services/StatisticsManager.hpp"
+#include "services/assetmanager/AssetWatcher.hpp"
 
 // TODO: use a proper input manager service here rather than using glfw directly
 #include "glfw/glfw3.h"
@@ -46,6 +47,9 @@ namespace tlc
     {
 #ifdef TLC_ENABLE_STATISTICS
         Services::Get<StatisticsManager>()->NewFrame();
+#endif
+#ifdef TLC_ENABLE_ASSET_HOT_RELOAD
+        Services::Get<AssetWatcher>()->Poll();
 #endif
         if (GetCurrentFrameTime() - m_LastFrameTime > 1.0f)
         {
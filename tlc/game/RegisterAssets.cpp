@@ -2,6 +2,7 @@
 
 #include "services/assetmanager/AssetManager.hpp"
 #include "services/assetmanager/AssetBundler.hpp"
+#include "services/assetmanager/AssetWatcher.hpp"
 #include "services/CacheManager.hpp"
 
 
@@ -11,31 +12,38 @@ namespace tlc
     {
         
 
-        // NOTE: This might seem weird(kinda is) but is very specific to the projects directory structure and how assets are managed(for now)
-        auto assetsPath = String("./assets");
-        if (!utils::PathExists(assetsPath))
-        {
-            assetsPath = "../assets";
-            if (!utils::PathExists(assetsPath))
-            {
-                assetsPath = "../../assets";
-                if (!utils::PathExists(assetsPath))
-                {
-                    log::Warn("Game::RegisterAssets: Raw assets path does not exists! skipping manual asset registration!");
-                    return;
-                }
+        // small content updates ship as patch bundles that shadow the base bundles
+        auto assetManager = Services::Get<AssetManager>();
+        auto patchesPath = utils::GetExecutableDirectory() + "/asset_patches";
+        if (utils::PathExists(patchesPath)) {
+            assetManager->MountBundleDirectory(patchesPath, k_PatchMountPriority);
+        }
+
+        // raw assets live next to the build directory during development
+        auto assetsPath = String("");
+        for (const auto& candidate : { "./assets", "../assets", "../../assets" }) {
+            if (utils::PathExists(candidate)) {
+                assetsPath = candidate;
+                break;
             }
         }
 
+        if (assetsPath.empty()) {
+            log::Warn("Game::RegisterAssets: Raw assets path does not exists! skipping manual asset registration!");
+            assetManager->LoadAllBundles();
+            return;
+        }
 
+        // bundles are memory mapped while loaded, release them before they get repacked
+        assetManager->UnloadAllBundles();
 
         auto bundler = Services::Get<AssetBundler>();
         bundler->RegisterFromDirectory(assetsPath + "/standard", "standard");
         bundler->RegisterFromDirectory(assetsPath + "/debug", "debug");
+        bundler->RegisterFontAtlas("debug", "fonts/atlas.fontatlas");
         bundler->LogAssets();
         bundler->Pack();
 
-        auto assetManager = Services::Get<AssetManager>();
         assetManager->ReloadAssetMetadata();
         assetManager->LogAssets();
         assetManager->LoadAllBundles();
@@ -43,5 +51,11 @@ namespace tlc
         auto cacheManager = Services::Get<CacheManager>();
         cacheManager->CacheShaders();
 
+#ifdef TLC_ENABLE_ASSET_HOT_RELOAD
+        auto watcher = Services::Get<AssetWatcher>();
+        watcher->Watch(assetsPath + "/standard", "standard");
+        watcher->Watch(assetsPath + "/debug", "debug");
+#endif
+
     }
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "services/CacheManager.hpp"
 #include "services/assetmanager/AssetManager.hpp"
 #include "services/assetmanager/AssetBundler.hpp"
+#include "services/assetmanager/AssetWatcher.hpp"
 #include "services/renderer/VulkanManager.hpp"
 #include "services/renderer/PresentationRenderer.hpp"
 #include "services/renderer/DebugUIManager.hpp"
@@ -18,7 +19,9 @@ namespace tlc
     {
         // NOTE: The order of registration matters
         // as some services depend on others to be registered first
+#ifdef TLC_ENABLE_SHADER_COMPILER
         Services::RegisterService<ShaderCompiler>();
+#endif
         Services::RegisterService<CacheManager>(utils::GetExecutableDirectory() + "/cache");
         Services::RegisterService<AssetBundler>(utils::GetExecutableDirectory() + "/asset_bundles");
         Services::RegisterService<AssetManager>(utils::GetExecutableDirectory() + "/asset_bundles");
@@ -27,6 +30,9 @@ namespace tlc
         Services::RegisterService<DebugUIManager>();
 #ifdef TLC_ENABLE_STATISTICS
         Services::RegisterService<StatisticsManager>();
+#endif
+#ifdef TLC_ENABLE_ASSET_HOT_RELOAD
+        Services::RegisterService<AssetWatcher>();
 #endif
     }
 }
\ No newline at end of file
@@ -23,8 +23,8 @@ namespace tlc
 		const auto device = Application::Get()->GetVulkanDevice();
 
 		auto cacheService = Services::Get<CacheManager>();
-		auto vertShaderModule = device->CreateShaderModule(cacheService->GetCacheDataTyped<U32>("shaders/vert.glsl"));
-		auto fragShaderModule = device->CreateShaderModule(cacheService->GetCacheDataTyped<U32>("shaders/frag.glsl"));
+		auto vertShaderModule = device->CreateShaderModule(cacheService->PinShaderCode("shaders/vert.glsl").As<U32>());
+		auto fragShaderModule = device->CreateShaderModule(cacheService->PinShaderCode("shaders/frag.glsl").As<U32>());
 
 
 		m_PipelineSettings = VulkanGraphicsPipelineSettings()
@@ -1,10 +1,19 @@
 #pragma once
 
 #include "core/Core.hpp"
+#include "core/MappedFile.hpp"
+#include "core/PinnedData.hpp"
+#include "core/ShaderReflection.hpp"
 #include "services/Services.hpp"
+#include "services/ShaderCompiler.hpp"
+#include "services/assetmanager/ShaderPrecompiler.hpp"
 
 namespace tlc 
 {
+    // Entries are appended to a single data file and listed in an index file next to it,
+    // the index is the only file read at startup. Space of replaced and removed entries
+    // is reclaimed by compacting the data file in the background. Any number of threads
+    // can write at once, the data is hashed and appended without blocking readers.
     class CacheManager : public IService {
         public:
             void Setup(const String& cachePath);
@@ -16,29 +25,145 @@ namespace tlc
             U64 GetCacheVersion(const String& key) const;
             void UpdateCache(const String& key, const Raw<U8> value, Size size, U64 version);
             void CreateCache(const String& key, const Raw<U8> value, Size size, U64 version);
+            // The index on disk is updated with the next compaction or on shutdown,
+            // removing a batch of keys at once updates it right away
+            void RemoveCache(const String& key);
+            void RemoveCache(const List<String>& keys);
             void ClearCache();
 
             List<String> GetCacheKeys() const;
+            // Zero copy view into the mapped data file, the handle keeps its mapping alive
+            // across later writes and compactions. View it with As<T>() or AsString().
+            // Any number of threads can read at once, they only wait on writers. Entries loaded
+            // from disk are checked against their hash the first time they are read, a corrupted
+            // one (eg. its write never fully reached the disk) is dropped and reads as missing.
+            PinnedData PinCacheData(const String& key) const;
+
+            // Copies of the data, prefer PinCacheData where a view will do
             List<U8> GetCacheData(const String& key) const;
             String GetCacheDataString(const String& key) const;
 
             template<typename T>
             List<T> GetCacheDataTyped(const String& key) const {
-                auto data = GetCacheData(key);
-                return List<T>((T*)data.data(), (T*)(data.data() + data.size()));
+                auto data = PinCacheData(key).As<T>();
+                return List<T>(data.begin(), data.end());
             }
 
+            // Compiles the shaders that are out of date along with every permutation of the ones
+            // that were declared with precompile. Shaders with an up to date module pre-built into
+            // their bundle are not compiled, without shaderc those modules are all there is.
             void CacheShaders();
             void ReloadCacheMetadata();
 
+            // A shader with keywords is compiled once for every variant that is used. Every keyword
+            // set lists alternatives, a variant picks at most one keyword of each set and is compiled
+            // with the picked keywords defined. Shaders that were not declared accept any keywords.
+            // Variants are keyed by GetShaderVariantKey.
+            void DeclareShaderKeywords(const String& address, const List<List<String>>& keywordSets, Bool precompile = true);
+            // Ready right away if the variant is pre-built or cached, otherwise it is compiled in the background
+            // (batched with other requests). Requests for a variant that is being compiled share the
+            // compilation. The data is invalid if the variant could not be compiled.
+            std::shared_future<PinnedData> RequestShaderVariant(const String& address, const List<String>& keywords);
+            // As above but waits for the compilation, keep it away from the render thread
+            PinnedData GetShaderVariant(const String& address, const List<String>& keywords);
+            // SPIR-V of a shader or variant by its key, the pre-built module when it is up to date
+            // and the cache entry otherwise. Use this over PinCacheData for shaders.
+            PinnedData PinShaderCode(const String& key) const;
+            // Interface of a shader or variant, reflected once when it was compiled
+            Bool GetShaderReflection(const String& key, ShaderReflection& reflection) const;
+
         private:
+            struct CacheEntry {
+                U64 Offset = 0; // of the data in the data file
+                U64 Size = 0;
+                U64 Version = 0;
+                U64 Hash = 0; // of the data
+                Bool Verified = false; // the data was checked against the hash, written by this run or read since
+            };
+
+            // takes the locks itself, only the append waits for other writers
             void SaveCache(const String& key, const Raw<U8> value, Size size, U64 version);
-            void LoadCacheMetadata(const String& key);
+            // the entry and a view of its data, not verified yet
+            PinnedData PinCacheEntry(const String& key, CacheEntry& entry) const;
+            // drops the entry if it still has the data that failed to verify
+            void DropCorruptedEntry(const String& key, const CacheEntry& entry) const;
+
+            // all of these expect m_Mutex to be held, and m_WriteMutex as well where they touch the data file
             void LoadAllCacheMetadata();
-            String FlattenKey(const String& key) const;
+            Bool LoadIndex();
+            void RecoverRecords(U64 offset);
+            void SaveIndex();
+            Bool EraseEntry(const String& key);
+            Bool OpenDataFile();
+            void RemoveStaleFiles();
+            Ref<MappedFile> MapDataFile(U64 size) const;
+            String GetDataPath(U32 generation) const;
+            void RequestCompaction();
+
+            void CompactionThread();
+            void Compact();
+
+            struct ShaderKeywords {
+                List<List<String>> Sets;
+                Bool Precompile = true;
+            };
+
+            struct ShaderVariantRequest {
+                String Key = "";
+                String Address = "";
+                List<String> Keywords; // sorted
+                std::promise<PinnedData> Result;
+            };
+
+            // the SPIR-V and its reflection, unless another shader compiled to the same code
+            // already (returns true then), and a reference to it with the given version
+            Bool CacheShader(const String& key, List<U32>& spirv, U64 version);
+            // key of the SPIR-V a cached shader refers to, empty if it is not cached
+            String GetCachedShaderCodeKey(const String& key) const;
+            // SPIR-V no shader refers to anymore
+            void RemoveUnusedShaderCode();
+            // hashes the sources, the options and the toolchain
+            U64 GetShaderVersion(const String& address, const ShaderCompileOptions& options) const;
+            Bool IsShaderCached(const String& key, const String& address, const ShaderCompileOptions& options) const;
+            // the SPIR-V of the module the AssetBundler pre-built into the bundle of the shader, invalid
+            // if there is none or its sources changed since (eg. hot reloaded). Fills in the reflection if given.
+            PinnedData PinShaderModule(const String& key, Raw<ShaderReflection> reflection = nullptr) const;
+            // every variant of the shaders declared with precompile, by address
+            UnorderedMap<String, List<List<String>>> GetPrecompiledShaderVariants();
+            void ShaderVariantThread();
+            void CompileShaderVariants(List<Ref<ShaderVariantRequest>>& requests);
 
         private:
             String m_CachePath = "";
-            UnorderedMap<String, Pair<String, U64>> m_Cache;
+            mutable std::shared_mutex m_Mutex; // shared by readers
+            // serializes appends to the data file, taken before m_Mutex. m_DataFile belongs to it,
+            // m_DataSize is only changed while holding both so either one is enough to read it.
+            std::mutex m_WriteMutex;
+            // reads verify entries and drop corrupted ones, so they change it as well
+            mutable UnorderedMap<String, CacheEntry> m_Cache;
+            U32 m_Generation = 0; // of the data file, bumped by every compaction
+            std::ofstream m_DataFile;
+            U64 m_DataSize = 0;
+            mutable U64 m_DeadSize = 0; // bytes of the data file taken by replaced or removed entries
+            U64 m_IndexedSize = 0; // bytes of the data file covered by the index on disk
+            mutable Bool m_IndexOutdated = false; // entries were dropped since the index was written
+            mutable Ref<MappedFile> m_Mapping = nullptr;
+
+            std::thread m_CompactionThread;
+            std::condition_variable_any m_CompactionCondition;
+            Bool m_CompactionRequested = false;
+            Bool m_Running = false;
+
+            // the variants are guarded by their own mutex, compiling never holds m_Mutex
+            std::mutex m_VariantMutex;
+            std::condition_variable m_VariantCondition;
+            std::thread m_VariantThread;
+            UnorderedMap<String, ShaderKeywords> m_ShaderKeywords;
+            UnorderedMap<String, std::shared_future<PinnedData>> m_PendingVariants;
+            List<Ref<ShaderVariantRequest>> m_VariantQueue;
+            Bool m_VariantsRunning = false;
+
+            // held while a shader is cached so unused code is not removed before it is referred to
+            std::mutex m_ShaderCodeMutex;
     };
 }
\ No newline at end of file
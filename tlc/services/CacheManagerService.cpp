@@ -1,8 +1,136 @@
 #include "services/CacheManager.hpp"
 #include "services/ShaderCompiler.hpp"
 #include "services/assetmanager/AssetManager.hpp"
+#include "core/Hash.hpp"
 
 namespace tlc {
+    // The cache directory holds two files:
+    //
+    //  cache_<generation>.data  append only, every write adds a record
+    //                           [CacheRecordHeader][key][padding][data][padding]
+    //  cache.index              the live entries as of the last time it was written
+    //                           [CacheIndexHeader][CacheIndexEntry x entryCount][key string table]
+    //
+    // Records appended after the index was written are recovered from the data file on
+    // load, so writing an entry is a single append and the index only has to be rewritten
+    // when entries are removed, after a compaction and on shutdown. Records carry the hash
+    // of their data and entries read from disk are checked against it on their first read,
+    // so a record that a crash left half written on disk is never handed out.
+    static constexpr U32 k_CacheRecordMagic = 0x52434C54; // "TLCR"
+    static constexpr U32 k_CacheIndexMagic = 0x49434C54; // "TLCI"
+    static constexpr U32 k_CacheFormatVersion = 5;
+    static constexpr U64 k_CacheDataAlignment = 16; // so that word sized data (eg. SPIR-V) can be viewed in place
+    static constexpr Size k_MaxCacheKeySize = 1024;
+
+    // compaction starts once this much of the data file is dead and that is at least half of it
+    static constexpr U64 k_CompactionMinDeadSize = 4 * 1024 * 1024;
+
+    struct CacheRecordHeader {
+        U32 Magic = k_CacheRecordMagic;
+        U32 KeyLength = 0;
+        U64 Size = 0;
+        U64 Version = 0; // set by the owner of the entry, eg. the hash of the asset it was built from
+        U64 Hash = 0; // of the data
+    };
+
+    struct CacheIndexHeader {
+        U32 Magic = k_CacheIndexMagic;
+        U32 FormatVersion = k_CacheFormatVersion;
+        U32 Generation = 0; // of the data file the entries point into
+        U32 EntryCount = 0;
+        U64 DataSize = 0; // of the data file when the index was written
+        U64 StringTableSize = 0;
+        U64 Hash = 0; // of the entries and the string table
+    };
+
+    struct CacheIndexEntry {
+        U64 KeyHash = 0;
+        U64 Offset = 0;
+        U64 Size = 0;
+        U64 Version = 0;
+        U64 Hash = 0;
+        U32 KeyOffset = 0;
+        U32 KeyLength = 0;
+    };
+
+    static_assert(sizeof(CacheRecordHeader) == 32, "CacheRecordHeader must be tightly packed");
+    static_assert(sizeof(CacheIndexHeader) == 40, "CacheIndexHeader must be tightly packed");
+    static_assert(sizeof(CacheIndexEntry) == 48, "CacheIndexEntry must be tightly packed");
+
+    // the asset dependency graph is persisted next to what was built from it
+    static const String k_DependencyGraphCacheKey = "asset_dependency_graph";
+    static const String k_CacheIndexName = "cache.index";
+    // A shader or variant is cached as a reference to its SPIR-V under the reference prefix,
+    // the SPIR-V is stored once under the code prefix and referenced by however many variants
+    // compile to it. Its reflection is stored under the key of the SPIR-V with the suffix.
+    static const String k_ShaderReferenceKeyPrefix = "shader#";
+    static const String k_ShaderCodeKeyPrefix = "spirv#";
+    static const String k_ShaderReflectionKeySuffix = "@reflection";
+    static constexpr U32 k_ShaderCodeReferenceMagic = 0x52534C54; // "TLSR"
+
+    struct ShaderCodeReference {
+        U32 Magic = k_ShaderCodeReferenceMagic;
+        U32 Reserved = 0;
+        U64 CodeHash = 0;
+    };
+
+    static_assert(sizeof(ShaderCodeReference) == 16, "ShaderCodeReference must be tightly packed");
+
+    static inline String GetShaderReferenceKey(const String& key) {
+        return k_ShaderReferenceKeyPrefix + key;
+    }
+
+    static inline String GetShaderCodeKey(U64 codeHash) {
+        return std::format("{}{:016x}", k_ShaderCodeKeyPrefix, codeHash);
+    }
+
+    static inline U64 AlignCacheOffset(U64 offset) {
+        return (offset + k_CacheDataAlignment - 1) & ~(k_CacheDataAlignment - 1);
+    }
+
+    // offset of the data from the start of its record
+    static inline U64 GetRecordDataOffset(U64 keyLength) {
+        return AlignCacheOffset(sizeof(CacheRecordHeader) + keyLength);
+    }
+
+    static inline U64 GetRecordSize(U64 keyLength, U64 size) {
+        return GetRecordDataOffset(keyLength) + AlignCacheOffset(size);
+    }
+
+    // cache_<generation>.data
+    static Bool ParseDataFileGeneration(const std::filesystem::path& path, U32& generation) {
+        auto stem = path.stem().string();
+        if (path.extension() != ".data" || !stem.starts_with("cache_") || stem.size() == 6) {
+            return false;
+        }
+
+        auto number = stem.substr(6);
+        if (!std::all_of(number.begin(), number.end(), [](char c) { return std::isdigit(c); })) {
+            return false;
+        }
+        generation = static_cast<U32>(std::stoul(number));
+        return true;
+    }
+
+    // Appends a record and returns its size, the entry gives everything but the offset
+    static U64 WriteCacheRecord(std::ofstream& file, const String& key, const U8* data, U64 size, U64 version, U64 hash) {
+        static const char k_Padding[k_CacheDataAlignment] = {};
+
+        auto header = CacheRecordHeader();
+        header.KeyLength = static_cast<U32>(key.size());
+        header.Size = size;
+        header.Version = version;
+        header.Hash = hash;
+
+        auto dataOffset = GetRecordDataOffset(key.size());
+        file.write(reinterpret_cast<const char*>(&header), sizeof(CacheRecordHeader));
+        file.write(key.data(), key.size());
+        file.write(k_Padding, dataOffset - sizeof(CacheRecordHeader) - key.size());
+        file.write(reinterpret_cast<const char*>(data), size);
+        file.write(k_Padding, AlignCacheOffset(size) - size);
+        return dataOffset + AlignCacheOffset(size);
+    }
+
     void CacheManager::Setup(const String& cachePath) {
         m_CachePath = cachePath;
     }
@@ -10,58 +138,128 @@ namespace tlc {
     void CacheManager::OnStart() {
         utils::EnsureDirectory(m_CachePath);
         ReloadCacheMetadata();
+
+#ifdef TLC_ENABLE_SHADER_COMPILER
+        {
+            std::lock_guard<std::mutex> lock(m_VariantMutex);
+            m_VariantsRunning = true;
+            m_VariantThread = std::thread(&CacheManager::ShaderVariantThread, this);
+        }
+#endif
+
+        std::lock_guard<std::shared_mutex> lock(m_Mutex);
+        m_Running = true;
+        m_CompactionThread = std::thread(&CacheManager::CompactionThread, this);
+        // an earlier run may have left enough dead space behind
+        RequestCompaction();
     }
 
     void CacheManager::OnEnd() {
+        {
+            std::lock_guard<std::mutex> lock(m_VariantMutex);
+            m_VariantsRunning = false;
+        }
+        m_VariantCondition.notify_all();
+        if (m_VariantThread.joinable()) {
+            m_VariantThread.join();
+        }
+
+        {
+            std::lock_guard<std::shared_mutex> lock(m_Mutex);
+            m_Running = false;
+        }
+        m_CompactionCondition.notify_all();
+        if (m_CompactionThread.joinable()) {
+            m_CompactionThread.join();
+        }
+
+        std::scoped_lock<std::mutex, std::shared_mutex> lock(m_WriteMutex, m_Mutex);
+        if (m_IndexedSize != m_DataSize || m_IndexOutdated) {
+            SaveIndex();
+        }
+        m_DataFile.close();
+        m_Mapping.reset();
     }
 
     void CacheManager::ReloadCacheMetadata() {
+        std::scoped_lock<std::mutex, std::shared_mutex> lock(m_WriteMutex, m_Mutex);
         m_Cache.clear();
         LoadAllCacheMetadata();
     }
 
     Bool CacheManager::CacheExists(const String& key) const {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
         return m_Cache.find(key) != m_Cache.end();
     }
 
     U64 CacheManager::GetCacheVersion(const String& key) const {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
         auto cache = m_Cache.find(key);
         if (cache == m_Cache.end()) {
             return 0;
         }
-        return cache->second.second;
+        return cache->second.Version;
     }
 
     void CacheManager::UpdateCache(const String& key, const Raw<U8> value, Size size, U64 version) {
-        auto cache = m_Cache.find(key);
-        if (cache == m_Cache.end()) {
-            log::Warn("Cache with key: {} does not exist!", key);
-            return;
-        }
+        {
+            std::shared_lock<std::shared_mutex> lock(m_Mutex);
+            auto cache = m_Cache.find(key);
+            if (cache == m_Cache.end()) {
+                log::Warn("Cache with key: {} does not exist!", key);
+                return;
+            }
 
-        if (cache->second.second != version) {
-            SaveCache(key, value, size, version);
-        }
-        else {
-            log::Warn("Cache with key: {} is already up to date!", key);
+            if (cache->second.Version == version) {
+                log::Warn("Cache with key: {} is already up to date!", key);
+                return;
+            }
         }
+        SaveCache(key, value, size, version);
     }
 
     void CacheManager::CreateCache(const String& key, const Raw<U8> value, Size size, U64 version) {
         SaveCache(key, value, size, version);
     }
 
+    void CacheManager::RemoveCache(const String& key) {
+        std::lock_guard<std::shared_mutex> lock(m_Mutex);
+        if (EraseEntry(key)) {
+            RequestCompaction();
+        }
+    }
+
+    void CacheManager::RemoveCache(const List<String>& keys) {
+        std::lock_guard<std::shared_mutex> lock(m_Mutex);
+        auto removed = false;
+        for (const auto& key : keys) {
+            removed |= EraseEntry(key);
+        }
+
+        if (removed) {
+            SaveIndex();
+            RequestCompaction();
+        }
+    }
+
     void CacheManager::ClearCache() {
+        std::scoped_lock<std::mutex, std::shared_mutex> lock(m_WriteMutex, m_Mutex);
         m_Cache.clear();
-        for (auto files : std::filesystem::directory_iterator(m_CachePath)) {
-            auto path = files.path();
-            if (path.extension() == ".cache") {
-                std::remove(path.string().c_str());
-            }
-        }
+        m_DataFile.close();
+        m_Mapping.reset();
+
+        // start a new data file rather than truncating the current one, data pinned from it stays valid
+        m_Generation++;
+        m_DataSize = 0;
+        m_DeadSize = 0;
+        OpenDataFile();
+        // the new generation only becomes the live one with its index, an empty one is cheap to write
+        SaveIndex();
+        RemoveStaleFiles();
     }
 
     List<String> CacheManager::GetCacheKeys() const {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
         List<String> result;
         for (const auto& [key, _] : m_Cache) {
             result.emplace_back(key);
@@ -70,106 +268,690 @@ namespace tlc {
     }
 
     List<U8> CacheManager::GetCacheData(const String& key) const {
+        auto data = PinCacheData(key);
+        return List<U8>(data.GetData(), data.GetData() + data.GetSize());
+    }
+
+    PinnedData CacheManager::PinCacheData(const String& key) const {
+        auto entry = CacheEntry();
+        auto data = PinCacheEntry(key, entry);
+        if (!data.IsValid() || entry.Verified) {
+            return data;
+        }
+
+        // hashed without the lock, other threads may verify the same entry meanwhile
+        if (utils::HashBuffer(data.GetData(), data.GetSize()) != entry.Hash) {
+            DropCorruptedEntry(key, entry);
+            return {};
+        }
+
+        std::lock_guard<std::shared_mutex> lock(m_Mutex);
+        auto cache = m_Cache.find(key);
+        if (cache != m_Cache.end() && cache->second.Offset == entry.Offset && cache->second.Hash == entry.Hash) {
+            cache->second.Verified = true;
+        }
+        return data;
+    }
+
+    void CacheManager::DropCorruptedEntry(const String& key, const CacheEntry& entry) const {
+        std::lock_guard<std::shared_mutex> lock(m_Mutex);
+        auto cache = m_Cache.find(key);
+        if (cache == m_Cache.end() || cache->second.Offset != entry.Offset || cache->second.Hash != entry.Hash) {
+            // replaced or compacted meanwhile
+            return;
+        }
+
+        log::Error("Cache entry: {} does not match its hash, dropping it", key);
+        m_DeadSize += GetRecordSize(key.size(), cache->second.Size);
+        m_Cache.erase(cache);
+        m_IndexOutdated = true;
+    }
+
+    PinnedData CacheManager::PinCacheEntry(const String& key, CacheEntry& entry) const {
+        {
+            // usually the entry is inside the current mapping and the lock can be shared
+            std::shared_lock<std::shared_mutex> lock(m_Mutex);
+            auto cache = m_Cache.find(key);
+            if (cache == m_Cache.end()) {
+                log::Error("Cache with key: {} does not exist!", key);
+                return {};
+            }
+
+            entry = cache->second;
+            if (m_Mapping != nullptr && m_Mapping->GetSize() >= entry.Offset + entry.Size) {
+                return PinnedData(m_Mapping, m_Mapping->GetData() + entry.Offset, entry.Size);
+            }
+        }
+
+        // written after the file was last mapped, mapping it again takes the lock for itself
+        std::lock_guard<std::shared_mutex> lock(m_Mutex);
         auto cache = m_Cache.find(key);
         if (cache == m_Cache.end()) {
             log::Error("Cache with key: {} does not exist!", key);
             return {};
         }
 
-        auto cachePath = cache->second.first;
-        std::ifstream cacheFile(cachePath, std::ios::binary);
-        if (!cacheFile.is_open()) {
-            log::Error("Failed to open cache file: {}", cachePath);
+        entry = cache->second;
+        auto mapping = MapDataFile(entry.Offset + entry.Size);
+        if (mapping == nullptr) {
             return {};
         }
 
-        // read the hash
-        U32 hash = 0;
-        cacheFile.read(reinterpret_cast<char*>(&hash), sizeof(U32));
-        // read the size
-        Size size = 0;
-        cacheFile.read(reinterpret_cast<char*>(&size), sizeof(Size));
-        // read the version
-        U64 version = 0;
-        cacheFile.read(reinterpret_cast<char*>(&version), sizeof(U64));
-
-        // read the key
-        static char keyBuffer[1024];
-        cacheFile.read(keyBuffer, 1024);
-
-        auto data = List<U8>(size);
-        cacheFile.read(reinterpret_cast<char*>(data.data()), size);
-        cacheFile.close();
-
-        return data;
+        auto view = mapping->GetData() + entry.Offset;
+        return PinnedData(std::move(mapping), view, entry.Size);
     }
 
     String CacheManager::GetCacheDataString(const String& key) const {
-        auto data = GetCacheData(key);
-        return std::string(data.begin(), data.end());
+        return String(PinCacheData(key).AsString());
     }
 
     void CacheManager::SaveCache(const String& key, const Raw<U8> value, Size size, U64 version) {
+        if (key.empty() || key.size() > k_MaxCacheKeySize) {
+            log::Error("Cache key: {} has to be between 1 and {} characters long!", key, k_MaxCacheKeySize);
+            return;
+        }
+
+        // hashed before taking any lock, writers on other threads hash theirs at the same time
         auto hash = utils::HashBuffer(value, size);
-        auto cachePath = m_CachePath + "/" + FlattenKey(key) + ".cache";
-        std::ofstream cacheFile(cachePath, std::ios::binary);
-        if (!cacheFile.is_open()) {
-            log::Error("Failed to create cache file: {}", cachePath);
+
+        // the record is appended while readers carry on, they cannot see it before it is published
+        std::lock_guard<std::mutex> writeLock(m_WriteMutex);
+        if (!m_DataFile.is_open() && !OpenDataFile()) {
+            return;
+        }
+
+        auto recordOffset = m_DataSize;
+        auto recordSize = WriteCacheRecord(m_DataFile, key, value, size, version, hash);
+        // reads go through a mapping of the file, so the record has to reach it right away
+        m_DataFile.flush();
+        if (!m_DataFile) {
+            // cut the partial record off, records appended after it could not be recovered otherwise
+            log::Error("Failed to write cache entry: {} to: {}", key, GetDataPath(m_Generation));
+            m_DataFile.close();
+            std::error_code error;
+            std::filesystem::resize_file(GetDataPath(m_Generation), recordOffset, error);
+            OpenDataFile();
             return;
         }
 
-        cacheFile.write(reinterpret_cast<const char*>(&hash), sizeof(U32));
-        cacheFile.write(reinterpret_cast<const char*>(&size), sizeof(Size));
-        cacheFile.write(reinterpret_cast<const char*>(&version), sizeof(U64));
-        static char keyBuffer[1024];
-        std::snprintf(keyBuffer, 1024, "%s", key.c_str());
-        cacheFile.write(keyBuffer, 1024);
-        cacheFile.write(reinterpret_cast<const char*>(value), size);
-        cacheFile.close();
+        std::lock_guard<std::shared_mutex> lock(m_Mutex);
+        auto previous = m_Cache.find(key);
+        if (previous != m_Cache.end()) {
+            m_DeadSize += GetRecordSize(key.size(), previous->second.Size);
+        }
+
+        m_DataSize += recordSize;
+        m_Cache[key] = CacheEntry{
+            .Offset = recordOffset + GetRecordDataOffset(key.size()),
+            .Size = size,
+            .Version = version,
+            .Hash = hash,
+            .Verified = true,
+        };
+        RequestCompaction();
+    }
+
+    void CacheManager::LoadAllCacheMetadata()
+    {
+        m_DataFile.close();
+        m_Mapping.reset();
+        m_DataSize = 0;
+        m_DeadSize = 0;
+        m_IndexedSize = 0;
+
+        if (LoadIndex()) {
+            RecoverRecords(m_IndexedSize);
+        }
+        else {
+            // no usable index, whatever made it into the newest data file is recovered instead
+            m_Cache.clear();
+            m_Generation = 0;
+            for (const auto& file : std::filesystem::directory_iterator(m_CachePath)) {
+                auto generation = U32(0);
+                if (ParseDataFileGeneration(file.path(), generation)) {
+                    m_Generation = std::max(m_Generation, generation);
+                }
+            }
+            RecoverRecords(0);
+        }
+
+        RemoveStaleFiles();
+        OpenDataFile();
+        log::Info("Cache: {} entries, {} bytes in: {}", m_Cache.size(), m_DataSize, GetDataPath(m_Generation));
+    }
+
+    Bool CacheManager::LoadIndex()
+    {
+        auto indexPath = m_CachePath + "/" + k_CacheIndexName;
+        if (!utils::PathExists(indexPath)) {
+            return false;
+        }
+
+        // the whole index in one read
+        auto index = utils::ReadBinaryFile(indexPath);
+        auto header = CacheIndexHeader();
+        if (index.size() < sizeof(CacheIndexHeader)) {
+            log::Warn("Cache index: {} is truncated!", indexPath);
+            return false;
+        }
+        std::memcpy(&header, index.data(), sizeof(CacheIndexHeader));
+
+        if (header.Magic != k_CacheIndexMagic || header.FormatVersion != k_CacheFormatVersion) {
+            // written by an older build, its data files cannot be recovered either
+            log::Info("Removing outdated cache: {}", m_CachePath);
+            utils::RemoveFile(indexPath);
+            for (const auto& file : std::filesystem::directory_iterator(m_CachePath)) {
+                auto generation = U32(0);
+                if (ParseDataFileGeneration(file.path(), generation)) {
+                    std::error_code error;
+                    std::filesystem::remove(file.path(), error);
+                }
+            }
+            return false;
+        }
+
+        auto entriesSize = static_cast<Size>(header.EntryCount) * sizeof(CacheIndexEntry);
+        if (index.size() != sizeof(CacheIndexHeader) + entriesSize + header.StringTableSize
+            || utils::HashBuffer(index.data() + sizeof(CacheIndexHeader), entriesSize + header.StringTableSize) != header.Hash) {
+            log::Warn("Cache index: {} is corrupted!", indexPath);
+            return false;
+        }
+
+        auto dataPath = GetDataPath(header.Generation);
+        if (!utils::PathExists(dataPath) || utils::GetFileSize(dataPath) < header.DataSize) {
+            log::Warn("Cache data file: {} is missing or truncated!", dataPath);
+            return false;
+        }
+
+        auto entries = reinterpret_cast<const CacheIndexEntry*>(index.data() + sizeof(CacheIndexHeader));
+        auto stringTable = reinterpret_cast<const char*>(index.data() + sizeof(CacheIndexHeader) + entriesSize);
+        auto liveSize = U64(0);
+        for (U32 i = 0; i < header.EntryCount; i++) {
+            const auto& entry = entries[i];
+            if (static_cast<U64>(entry.KeyOffset) + entry.KeyLength > header.StringTableSize || entry.Offset + entry.Size > header.DataSize) {
+                log::Warn("Cache index: {} has an entry out of bounds, skipping it", indexPath);
+                continue;
+            }
+
+            auto key = String(stringTable + entry.KeyOffset, entry.KeyLength);
+            m_Cache[key] = CacheEntry{ .Offset = entry.Offset, .Size = entry.Size, .Version = entry.Version, .Hash = entry.Hash };
+            liveSize += GetRecordSize(key.size(), entry.Size);
+        }
 
-        m_Cache[key] = { cachePath, version };
+        m_Generation = header.Generation;
+        m_IndexedSize = header.DataSize;
+        m_DeadSize = header.DataSize > liveSize ? header.DataSize - liveSize : 0;
+        return true;
     }
-    
-    void CacheManager::LoadCacheMetadata(const String& cachePath)
+
+    void CacheManager::RecoverRecords(U64 offset)
     {
-        if (!utils::PathExists(cachePath)) {
-            log::Warn("Cache: {} not found!", cachePath);
+        auto dataPath = GetDataPath(m_Generation);
+        auto fileSize = utils::PathExists(dataPath) ? static_cast<U64>(utils::GetFileSize(dataPath)) : U64(0);
+        m_DataSize = std::min(offset, fileSize);
+        if (fileSize <= offset) {
             return;
         }
 
-        // open the cache file
-        std::ifstream cacheFile(cachePath, std::ios::binary);
-        if (!cacheFile.is_open()) {
-            log::Error("Failed to open cache file: {}", cachePath);
+        auto recovered = Size(0);
+        {
+            auto mapping = MappedFile(dataPath);
+            auto data = mapping.IsReady() ? mapping.GetData() : nullptr;
+            while (data != nullptr && offset + sizeof(CacheRecordHeader) <= fileSize) {
+                auto header = CacheRecordHeader();
+                std::memcpy(&header, data + offset, sizeof(CacheRecordHeader));
+                if (header.Magic != k_CacheRecordMagic || header.KeyLength == 0 || header.KeyLength > k_MaxCacheKeySize) {
+                    break;
+                }
+
+                auto recordSize = GetRecordSize(header.KeyLength, header.Size);
+                if (header.Size > fileSize || offset + recordSize > fileSize) {
+                    break;
+                }
+
+                auto key = String(reinterpret_cast<const char*>(data + offset + sizeof(CacheRecordHeader)), header.KeyLength);
+                auto previous = m_Cache.find(key);
+                if (previous != m_Cache.end()) {
+                    m_DeadSize += GetRecordSize(key.size(), previous->second.Size);
+                }
+
+                m_Cache[key] = CacheEntry{
+                    .Offset = offset + GetRecordDataOffset(header.KeyLength),
+                    .Size = header.Size,
+                    .Version = header.Version,
+                    .Hash = header.Hash,
+                };
+                offset += recordSize;
+                recovered++;
+            }
+        }
+
+        if (recovered > 0) {
+            log::Info("Cache: recovered {} entries written after the index", recovered);
+        }
+
+        if (offset < fileSize) {
+            // the tail of a write that never finished, eg. the game was killed halfway through it
+            log::Warn("Cache: dropping {} bytes of incomplete records from: {}", fileSize - offset, dataPath);
+            std::error_code error;
+            std::filesystem::resize_file(dataPath, offset, error);
+            if (error) {
+                log::Error("Failed to truncate cache data file: {} ({})", dataPath, error.message());
+            }
+        }
+        m_DataSize = offset;
+    }
+
+    void CacheManager::SaveIndex()
+    {
+        auto entries = List<CacheIndexEntry>();
+        auto stringTable = String();
+        entries.reserve(m_Cache.size());
+        for (const auto& [key, entry] : m_Cache) {
+            entries.emplace_back(CacheIndexEntry{
+                .KeyHash = utils::HashBuffer(key.data(), key.size()),
+                .Offset = entry.Offset,
+                .Size = entry.Size,
+                .Version = entry.Version,
+                .Hash = entry.Hash,
+                .KeyOffset = static_cast<U32>(stringTable.size()),
+                .KeyLength = static_cast<U32>(key.size()),
+            });
+            stringTable.append(key);
+        }
+
+        auto header = CacheIndexHeader();
+        header.Generation = m_Generation;
+        header.EntryCount = static_cast<U32>(entries.size());
+        header.DataSize = m_DataSize;
+        header.StringTableSize = stringTable.size();
+        auto hasher = Hasher();
+        hasher.Update(entries.data(), entries.size() * sizeof(CacheIndexEntry));
+        hasher.Update(stringTable.data(), stringTable.size());
+        header.Hash = hasher.Digest();
+
+        // written next to the index and renamed over it, a crash leaves either the old or the new one
+        auto indexPath = m_CachePath + "/" + k_CacheIndexName;
+        auto temporaryPath = indexPath + ".tmp";
+        std::ofstream indexFile(temporaryPath, std::ios::binary);
+        indexFile.write(reinterpret_cast<const char*>(&header), sizeof(CacheIndexHeader));
+        indexFile.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(CacheIndexEntry));
+        indexFile.write(stringTable.data(), stringTable.size());
+        indexFile.close();
+        if (!indexFile) {
+            log::Error("Failed to write cache index: {}", temporaryPath);
+            utils::RemoveFile(temporaryPath);
             return;
         }
 
-        // read the hash
-        U32 hash = 0;
-        cacheFile.read(reinterpret_cast<char*>(&hash), sizeof(U32));
-        // read the size
-        Size size = 0;
-        cacheFile.read(reinterpret_cast<char*>(&size), sizeof(Size));
-        // read the version
-        U64 version = 0;
-        cacheFile.read(reinterpret_cast<char*>(&version), sizeof(U64));
-        // read the key
-        static char keyBuffer[1024];
-        cacheFile.read(keyBuffer, 1024);
-        auto key = String(keyBuffer);
-        cacheFile.close();
+        std::error_code error;
+        std::filesystem::rename(temporaryPath, indexPath, error);
+        if (error) {
+            log::Error("Failed to replace cache index: {} ({})", indexPath, error.message());
+            utils::RemoveFile(temporaryPath);
+            return;
+        }
+        m_IndexedSize = m_DataSize;
+        m_IndexOutdated = false;
+    }
 
-        m_Cache[key] = { String(cachePath), version };
+    Bool CacheManager::EraseEntry(const String& key)
+    {
+        auto cache = m_Cache.find(key);
+        if (cache == m_Cache.end()) {
+            return false;
+        }
+
+        // the removed entry would come back on the next load until the index is written
+        m_DeadSize += GetRecordSize(key.size(), cache->second.Size);
+        m_Cache.erase(cache);
+        m_IndexOutdated = true;
+        return true;
     }
 
-    void CacheManager::LoadAllCacheMetadata()
+    Bool CacheManager::OpenDataFile()
+    {
+        auto dataPath = GetDataPath(m_Generation);
+        m_DataFile.close();
+        m_DataFile.clear();
+        m_DataFile.open(dataPath, std::ios::binary | std::ios::app);
+        if (!m_DataFile.is_open()) {
+            log::Error("Failed to open cache data file: {}", dataPath);
+            return false;
+        }
+        return true;
+    }
+
+    void CacheManager::RemoveStaleFiles()
+    {
+        // data files of other generations, half written indices and the .cache files of older builds
+        auto legacyFiles = Size(0);
+        for (const auto& file : std::filesystem::directory_iterator(m_CachePath)) {
+            auto path = file.path();
+            auto generation = U32(0);
+            auto isStaleData = ParseDataFileGeneration(path, generation) && generation != m_Generation;
+            auto isLegacy = path.extension() == ".cache";
+            if (!isStaleData && !isLegacy && path.extension() != ".tmp") {
+                continue;
+            }
+
+            // fails while the file is still mapped on some platforms, it is retried on the next load
+            std::error_code error;
+            std::filesystem::remove(path, error);
+            legacyFiles += isLegacy ? 1 : 0;
+        }
+
+        if (legacyFiles > 0) {
+            log::Info("Removed {} outdated cache files from: {}", legacyFiles, m_CachePath);
+        }
+    }
+
+    Ref<MappedFile> CacheManager::MapDataFile(U64 size) const
+    {
+        // records appended since the file was mapped are past the end of the mapping, it is
+        // replaced rather than grown so that data pinned from the old one stays valid
+        if (m_Mapping == nullptr || m_Mapping->GetSize() < size) {
+            auto dataPath = GetDataPath(m_Generation);
+            auto mapping = CreateRef<MappedFile>(dataPath);
+            if (!mapping->IsReady() || mapping->GetSize() < size) {
+                log::Error("Failed to map cache data file: {}", dataPath);
+                return nullptr;
+            }
+            m_Mapping = std::move(mapping);
+        }
+        return m_Mapping;
+    }
+
+    String CacheManager::GetDataPath(U32 generation) const
+    {
+        return m_CachePath + "/cache_" + std::to_string(generation) + ".data";
+    }
+
+    void CacheManager::RequestCompaction()
+    {
+        if (m_DeadSize < k_CompactionMinDeadSize || m_DeadSize * 2 < m_DataSize) {
+            return;
+        }
+
+        m_CompactionRequested = true;
+        m_CompactionCondition.notify_one();
+    }
+
+    void CacheManager::CompactionThread()
+    {
+        std::unique_lock<std::shared_mutex> lock(m_Mutex);
+        while (true) {
+            m_CompactionCondition.wait(lock, [this]() { return !m_Running || m_CompactionRequested; });
+            if (!m_Running) {
+                return;
+            }
+
+            m_CompactionRequested = false;
+            lock.unlock();
+            Compact();
+            lock.lock();
+        }
+    }
+
+    void CacheManager::Compact()
     {
-        for (auto files : std::filesystem::directory_iterator(m_CachePath)) {
-            auto path = files.path();
-            if (path.extension() == ".cache") {
-                LoadCacheMetadata(path.string());
+        // the live entries are copied into the next generation of the data file without
+        // holding the lock, reads and writes carry on against the current one meanwhile
+        auto snapshot = UnorderedMap<String, CacheEntry>();
+        auto source = Ref<MappedFile>();
+        auto generation = U32(0);
+        auto previousSize = U64(0);
+        {
+            std::lock_guard<std::shared_mutex> lock(m_Mutex);
+            snapshot = m_Cache;
+            generation = m_Generation;
+            previousSize = m_DataSize;
+            source = MapDataFile(m_DataSize);
+        }
+
+        if (source == nullptr) {
+            return;
+        }
+
+        auto startTime = std::chrono::steady_clock::now();
+        auto compactedPath = GetDataPath(generation + 1);
+        std::ofstream compactedFile(compactedPath, std::ios::binary | std::ios::trunc);
+        if (!compactedFile.is_open()) {
+            log::Error("Failed to create cache data file: {}", compactedPath);
+            return;
+        }
+
+        auto compacted = UnorderedMap<String, CacheEntry>();
+        auto compactedSize = U64(0);
+        auto copyEntry = [&](const Ref<MappedFile>& from, const String& key, const CacheEntry& entry) {
+            auto& copy = compacted[key];
+            copy = entry;
+            copy.Offset = compactedSize + GetRecordDataOffset(key.size());
+            compactedSize += WriteCacheRecord(compactedFile, key, from->GetData() + entry.Offset, entry.Size, entry.Version, entry.Hash);
+        };
+
+        compacted.reserve(snapshot.size());
+        for (const auto& [key, entry] : snapshot) {
+            copyEntry(source, key, entry);
+        }
+
+        std::scoped_lock<std::mutex, std::shared_mutex> lock(m_WriteMutex, m_Mutex);
+        if (m_Generation != generation) {
+            // cleared meanwhile, the copy is stale
+            compactedFile.close();
+            utils::RemoveFile(compactedPath);
+            return;
+        }
+
+        // entries written while copying went to the current data file and are carried over as well,
+        // entries removed meanwhile are dropped
+        auto current = MapDataFile(m_DataSize);
+        for (const auto& [key, entry] : m_Cache) {
+            auto copied = snapshot.find(key);
+            if (copied != snapshot.end() && copied->second.Offset == entry.Offset) {
+                continue;
+            }
+
+            if (current != nullptr) {
+                copyEntry(current, key, entry);
+            }
+        }
+        for (const auto& [key, _] : snapshot) {
+            if (!m_Cache.contains(key)) {
+                compacted.erase(key);
+            }
+        }
+
+        compactedFile.close();
+        if (!compactedFile || current == nullptr) {
+            log::Error("Failed to write cache data file: {}", compactedPath);
+            utils::RemoveFile(compactedPath);
+            return;
+        }
+
+        // switch over, the index written here is what makes the new generation the live one
+        m_DataFile.close();
+        m_Mapping.reset();
+        m_Cache = std::move(compacted);
+        m_Generation = generation + 1;
+        m_DataSize = compactedSize;
+        m_DeadSize = 0;
+        OpenDataFile();
+        SaveIndex();
+        RemoveStaleFiles();
+
+        auto elapsed = std::chrono::duration<F64, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+        log::Info("Cache: compacted {} entries, {} of {} bytes reclaimed in {:.2f} ms", m_Cache.size(), previousSize - compactedSize, previousSize, elapsed);
+    }
+
+    // the stage of a shader comes from the tags besides AssetTags::Shader
+    PinnedData CacheManager::PinShaderModule(const String& key, Raw<ShaderReflection> reflection) const {
+        auto assetManager = Services::Get<AssetManager>();
+        auto id = AssetId(GetShaderModuleAddress(key));
+        if (!assetManager || !assetManager->AssetExists(id) || (assetManager->GetAssetTags(id) & AssetTags::ShaderModule) != AssetTags::ShaderModule) {
+            return PinnedData();
+        }
+
+        auto module = assetManager->PinAssetData(id);
+        auto header = Raw<const ShaderModuleHeader>(nullptr);
+        auto stringTable = Raw<const char>(nullptr);
+        if (!ReadShaderModule(module.GetData(), module.GetSize(), header, stringTable)) {
+            log::Warn("CacheManager::PinShaderModule: pre-built module of shader: {} is invalid", key);
+            return PinnedData();
+        }
+
+#ifdef TLC_ENABLE_SHADER_COMPILER
+        // compiled differently than it would be now, or from sources that changed since. Without
+        // a compiler the module is used regardless, there is nothing else to use.
+        auto shaderCompiler = Services::Get<ShaderCompiler>();
+        if (shaderCompiler) {
+            if (header->CompilerVersion != ShaderCompiler::GetCompilerVersion() || header->OptionsHash != shaderCompiler->GetOptions()->Hash()) {
+                return PinnedData();
+            }
+
+            auto sources = GetShaderModuleSources(*header, stringTable);
+            auto sourceHash = GetShaderModuleSourceHash(sources.Address, sources.Includes, [&assetManager](const String& address) {
+                auto sourceId = AssetId(address);
+                return assetManager->AssetExists(sourceId) ? assetManager->GetAssetDataHash(sourceId) : U64(0);
+            });
+            if (sourceHash != header->SourceHash) {
+                return PinnedData();
             }
         }
+#endif
+
+        if (reflection != nullptr && !ShaderReflection::Deserialize(module.GetData() + header->ReflectionOffset, header->ReflectionSize, *reflection)) {
+            log::Warn("CacheManager::PinShaderModule: pre-built module of shader: {} has an invalid reflection", key);
+            return PinnedData();
+        }
+        return module.Slice(header->SpirvOffset, header->SpirvSize);
+    }
+
+    PinnedData CacheManager::PinShaderCode(const String& key) const {
+        auto module = PinShaderModule(key);
+        if (module.IsValid()) {
+            return module;
+        }
+
+        auto codeKey = GetCachedShaderCodeKey(key);
+        return codeKey.empty() ? PinnedData() : PinCacheData(codeKey);
+    }
+
+    String CacheManager::GetCachedShaderCodeKey(const String& key) const {
+        auto referenceKey = GetShaderReferenceKey(key);
+        if (!CacheExists(referenceKey)) {
+            return String();
+        }
+
+        auto data = PinCacheData(referenceKey);
+        if (!data.IsValid() || data.GetSize() != sizeof(ShaderCodeReference)) {
+            return String();
+        }
+
+        auto reference = ShaderCodeReference();
+        std::memcpy(&reference, data.GetData(), sizeof(ShaderCodeReference));
+        if (reference.Magic != k_ShaderCodeReferenceMagic) {
+            return String();
+        }
+
+        auto codeKey = GetShaderCodeKey(reference.CodeHash);
+        return CacheExists(codeKey) ? codeKey : String();
+    }
+
+    UnorderedMap<String, List<List<String>>> CacheManager::GetPrecompiledShaderVariants() {
+        auto precompiledVariants = UnorderedMap<String, List<List<String>>>();
+        std::lock_guard<std::mutex> lock(m_VariantMutex);
+        for (const auto& [address, keywords] : m_ShaderKeywords) {
+            if (keywords.Precompile) {
+                precompiledVariants[address] = GetShaderKeywordVariants(keywords.Sets);
+            }
+        }
+        return precompiledVariants;
+    }
+
+    Bool CacheManager::CacheShader(const String& key, List<U32>& spirv, U64 version) {
+        auto codeHash = utils::HashBuffer(spirv.data(), spirv.size() * sizeof(U32));
+        auto codeKey = GetShaderCodeKey(codeHash);
+
+        // the code has to be there before the reference, and stay until the reference is
+        std::lock_guard<std::mutex> lock(m_ShaderCodeMutex);
+        auto shared = CacheExists(codeKey);
+        if (!shared) {
+            CreateCache(codeKey, reinterpret_cast<Raw<U8>>(spirv.data()), spirv.size() * sizeof(U32), codeHash);
+
+            auto reflection = ShaderReflection();
+            if (ShaderReflection::Reflect(spirv, reflection)) {
+                auto reflectionData = reflection.Serialize();
+                CreateCache(codeKey + k_ShaderReflectionKeySuffix, reflectionData.data(), reflectionData.size(), codeHash);
+            }
+            else {
+                log::Warn("CacheManager::CacheShader: failed to reflect shader: {}", key);
+            }
+        }
+        auto reference = ShaderCodeReference{ .CodeHash = codeHash };
+        CreateCache(GetShaderReferenceKey(key), reinterpret_cast<Raw<U8>>(&reference), sizeof(ShaderCodeReference), version);
+        return shared;
+    }
+
+    void CacheManager::RemoveUnusedShaderCode() {
+        std::lock_guard<std::mutex> lock(m_ShaderCodeMutex);
+        auto keys = GetCacheKeys();
+        auto usedCodeKeys = Set<String>();
+        for (const auto& key : keys) {
+            if (key.starts_with(k_ShaderReferenceKeyPrefix)) {
+                if (auto codeKey = GetCachedShaderCodeKey(key.substr(k_ShaderReferenceKeyPrefix.size())); !codeKey.empty()) {
+                    usedCodeKeys.insert(std::move(codeKey));
+                }
+            }
+        }
+
+        // eg. left behind by edited shaders, the reflection goes with its code
+        auto unusedKeys = List<String>();
+        for (const auto& key : keys) {
+            if (key.starts_with(k_ShaderCodeKeyPrefix) && !key.ends_with(k_ShaderReflectionKeySuffix) && !usedCodeKeys.contains(key)) {
+                unusedKeys.push_back(key);
+                unusedKeys.push_back(key + k_ShaderReflectionKeySuffix);
+            }
+        }
+        if (!unusedKeys.empty()) {
+            RemoveCache(unusedKeys);
+            log::Info("Cache: removed {} unused shader modules", unusedKeys.size() / 2);
+        }
+    }
+
+    Bool CacheManager::GetShaderReflection(const String& key, ShaderReflection& reflection) const {
+        if (PinShaderModule(key, &reflection).IsValid()) {
+            return true;
+        }
+
+        auto codeKey = GetCachedShaderCodeKey(key);
+        if (codeKey.empty()) {
+            log::Warn("CacheManager::GetShaderReflection: shader: {} is not cached", key);
+            return false;
+        }
+
+        auto reflectionData = PinCacheData(codeKey + k_ShaderReflectionKeySuffix);
+        if (reflectionData.IsValid() && ShaderReflection::Deserialize(reflectionData.GetData(), reflectionData.GetSize(), reflection)) {
+            return true;
+        }
+
+        // reflecting failed when it was cached, it will fail again but the error is worth seeing
+        return ShaderReflection::Reflect(PinCacheData(codeKey).As<U32>(), reflection);
+    }
+
+#ifdef TLC_ENABLE_SHADER_COMPILER
+    U64 CacheManager::GetShaderVersion(const String& address, const ShaderCompileOptions& options) const {
+        // source and everything it includes, compiled with these options by this toolchain
+        auto hasher = Hasher();
+        hasher.UpdateValue(Services::Get<AssetManager>()->GetAssetDependencyHash(address));
+        hasher.UpdateValue(options.Hash());
+        hasher.UpdateValue(ShaderCompiler::GetCompilerVersion());
+        return hasher.Digest();
+    }
+
+    Bool CacheManager::IsShaderCached(const String& key, const String& address, const ShaderCompileOptions& options) const {
+        auto referenceKey = GetShaderReferenceKey(key);
+        return CacheExists(referenceKey) && GetCacheVersion(referenceKey) == GetShaderVersion(address, options) && !GetCachedShaderCodeKey(key).empty();
     }
 
     void CacheManager::CacheShaders() {
@@ -181,46 +963,317 @@ namespace tlc {
             return;
         }
 
-        auto lists = {
-            std::make_pair(assetManager->GetAssetsWithTags(AssetTags::VertexShader), ShaderCompiler::ShaderType::Vertex),
-            std::make_pair(assetManager->GetAssetsWithTags(AssetTags::FragmentShader), ShaderCompiler::ShaderType::Fragment),
-            std::make_pair(assetManager->GetAssetsWithTags(AssetTags::ComputeShader), ShaderCompiler::ShaderType::Compute)
-        };
+        // edges recorded by earlier runs, needed to notice edits to included files
+        auto& dependencyGraph = assetManager->GetDependencyGraph();
+        if (dependencyGraph.IsEmpty() && CacheExists(k_DependencyGraphCacheKey)) {
+            auto graphData = PinCacheData(k_DependencyGraphCacheKey);
+            dependencyGraph.Deserialize(graphData.GetData(), graphData.GetSize());
+        }
 
-        for (const auto& [list, type] : lists) {
-            for (const auto& address : list) {
-                Bool requiresUpdate = false;
-                if (CacheExists(address)) {
-                    auto version = GetCacheVersion(address);
-                    auto assetHash = assetManager->GetAssetDataHash(address);
-                    requiresUpdate = version != assetHash;
-                }
-                else {
-                    requiresUpdate = true;
+        auto precompiledVariants = GetPrecompiledShaderVariants();
+
+        // the options are fixed for the whole run, the versions and the compilations use the same snapshot
+        auto options = shaderCompiler->GetOptions();
+
+        // the out of date shaders are collected first and compiled together, the pins keep the sources alive meanwhile
+        auto pendingKeys = List<String>();
+        auto pendingAddresses = List<String>();
+        auto pendingSources = List<PinnedData>();
+        auto requests = List<ShaderCompiler::CompileRequest>();
+        auto numPrebuilt = Size(0);
+        for (auto asset : assetManager->QueryAssetsWithTags(AssetTags::Shader)) {
+            const auto& address = asset->Address;
+            auto stage = ShaderCompiler::GetShaderType(asset->Tags);
+            if (!stage) {
+                continue;
+            }
+
+            auto variants = List<List<String>>{ {} };
+            if (auto declared = precompiledVariants.find(address); declared != precompiledVariants.end()) {
+                variants = std::move(declared->second);
+            }
+
+            auto code = PinnedData();
+            for (const auto& keywords : variants) {
+                auto key = GetShaderVariantKey(address, keywords);
+                if (PinShaderModule(key).IsValid()) {
+                    numPrebuilt++;
+                    continue;
                 }
 
-                if (!requiresUpdate) {
+                if (IsShaderCached(key, address, *options)) {
                     continue;
                 }
 
-                log::Info("Compiling and caching shader: {}", address);
+                if (!code.IsValid()) {
+                    code = assetManager->PinAssetData(asset->Id);
+                    if (!code.IsValid()) {
+                        log::Error("CacheManager::CacheShaders: shader: {} is not loaded", address);
+                        break;
+                    }
+                }
+
+                log::Info("Compiling and caching shader: {}", key);
 
-                auto code = assetManager->GetAssetDataString(address);
-                auto spv = shaderCompiler->ToSpv(code, type, address);
+                requests.push_back({ code.AsString(), *stage, address, GetShaderKeywordMacros(keywords) });
+                pendingKeys.push_back(std::move(key));
+                pendingAddresses.push_back(address);
+            }
+
+            if (code.IsValid()) {
+                pendingSources.push_back(std::move(code));
+            }
+        }
+
+        if (numPrebuilt > 0) {
+            log::Info("Cache: {} shaders use their pre-built modules", numPrebuilt);
+        }
+
+        if (!requests.empty()) {
+            auto startTime = std::chrono::steady_clock::now();
+            auto results = shaderCompiler->CompileAll(requests, options);
+            auto elapsed = std::chrono::duration<F64, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+            log::Info("Cache: compiled {} shaders in {:.2f} ms", requests.size(), elapsed);
+
+            auto numShared = Size(0);
+            for (Size i = 0; i < results.size(); i++) {
+                auto& spv = results[i];
                 if (spv.empty()) {
-                    log::Error("CacheManager::CacheShaders: failed to cache shader: {}", address);
+                    log::Error("CacheManager::CacheShaders: failed to cache shader: {}", pendingKeys[i]);
                     continue;
                 }
 
-                CreateCache(address, reinterpret_cast<Raw<U8>>(spv.data()), spv.size() * sizeof(U32), assetManager->GetAssetDataHash(address));
+                // compiling recorded the current includes, the version has to cover those
+                if (CacheShader(pendingKeys[i], spv, GetShaderVersion(pendingAddresses[i], *options))) {
+                    numShared++;
+                }
+            }
+            if (numShared > 0) {
+                log::Info("Cache: {} shaders compiled to the same code as another one and share it", numShared);
+            }
+        }
+        RemoveUnusedShaderCode();
+
+        auto graphData = dependencyGraph.Serialize();
+        auto graphVersion = utils::HashBuffer(graphData);
+        if (GetCacheVersion(k_DependencyGraphCacheKey) != graphVersion) {
+            CreateCache(k_DependencyGraphCacheKey, graphData.data(), graphData.size(), graphVersion);
+        }
+    }
+#else
+    // shaderc is not part of this build, every shader has to come pre-built with its bundle
+    void CacheManager::CacheShaders() {
+        auto assetManager = Services::Get<AssetManager>();
+        if (!assetManager) {
+            log::Warn("CacheManager::CacheShaders: AssetManager service not found!");
+            return;
+        }
+
+        static const auto k_ShaderStageTags = AssetTags::VertexShader | AssetTags::FragmentShader | AssetTags::ComputeShader;
+        auto precompiledVariants = GetPrecompiledShaderVariants();
+        for (auto asset : assetManager->QueryAssetsWithTags(AssetTags::Shader)) {
+            if ((asset->Tags & k_ShaderStageTags) == AssetTags::None) {
+                continue;
+            }
+
+            auto variants = List<List<String>>{ {} };
+            if (auto declared = precompiledVariants.find(asset->Address); declared != precompiledVariants.end()) {
+                variants = std::move(declared->second);
+            }
+
+            for (const auto& keywords : variants) {
+                auto key = GetShaderVariantKey(asset->Address, keywords);
+                if (!PinShaderModule(key).IsValid()) {
+                    log::Error("CacheManager::CacheShaders: shader: {} has no pre-built module and this build cannot compile it", key);
+                }
+            }
+        }
+    }
+#endif
+
+    void CacheManager::DeclareShaderKeywords(const String& address, const List<List<String>>& keywordSets, Bool precompile) {
+        auto keywords = ShaderKeywords();
+        keywords.Precompile = precompile;
+        for (const auto& set : keywordSets) {
+            if (!set.empty()) {
+                keywords.Sets.push_back(set);
             }
         }
+
+        std::lock_guard<std::mutex> lock(m_VariantMutex);
+        m_ShaderKeywords[address] = std::move(keywords);
     }
 
-    String CacheManager::FlattenKey(const String& key) const {
-        // replace all invalid characters with '_'
-        String result = key;
-        std::replace_if(result.begin(), result.end(), [](char c) { return !std::isalnum(c); }, '_');
+    std::shared_future<PinnedData> CacheManager::RequestShaderVariant(const String& address, const List<String>& keywords) {
+        auto request = CreateRef<ShaderVariantRequest>();
+        request->Key = GetShaderVariantKey(address, keywords);
+        request->Address = address;
+        request->Keywords = keywords;
+        std::sort(request->Keywords.begin(), request->Keywords.end());
+        request->Keywords.erase(std::unique(request->Keywords.begin(), request->Keywords.end()), request->Keywords.end());
+
+        auto failed = [&]() {
+            request->Result.set_value(PinnedData());
+            return request->Result.get_future().share();
+        };
+
+        if (!Services::Get<AssetManager>()) {
+            log::Warn("CacheManager::RequestShaderVariant: AssetManager service not found!");
+            return failed();
+        }
+
+        std::unique_lock<std::mutex> lock(m_VariantMutex);
+        if (auto declared = m_ShaderKeywords.find(address); declared != m_ShaderKeywords.end()) {
+            for (const auto& set : declared->second.Sets) {
+                auto picked = std::count_if(request->Keywords.begin(), request->Keywords.end(), [&set](const String& keyword) {
+                    return std::find(set.begin(), set.end(), keyword) != set.end();
+                });
+                if (picked > 1) {
+                    log::Error("CacheManager::RequestShaderVariant: shader: {} picks more than one keyword of a set in: {}", address, request->Key);
+                    return failed();
+                }
+            }
+
+            for (const auto& keyword : request->Keywords) {
+                auto known = std::any_of(declared->second.Sets.begin(), declared->second.Sets.end(), [&keyword](const List<String>& set) {
+                    return std::find(set.begin(), set.end(), keyword) != set.end();
+                });
+                if (!known) {
+                    log::Error("CacheManager::RequestShaderVariant: shader: {} does not declare the keyword: {}", address, keyword);
+                    return failed();
+                }
+            }
+        }
+
+        if (auto pending = m_PendingVariants.find(request->Key); pending != m_PendingVariants.end()) {
+            return pending->second;
+        }
+
+        // hashing the sources does not need the lock, the variant thread checks the cache again anyway
+        lock.unlock();
+        if (auto module = PinShaderModule(request->Key); module.IsValid()) {
+            request->Result.set_value(std::move(module));
+            return request->Result.get_future().share();
+        }
+
+#ifdef TLC_ENABLE_SHADER_COMPILER
+        auto shaderCompiler = Services::Get<ShaderCompiler>();
+        if (!shaderCompiler) {
+            log::Warn("CacheManager::RequestShaderVariant: ShaderCompiler service not found, cannot compile: {}", request->Key);
+            return failed();
+        }
+
+        if (IsShaderCached(request->Key, address, *shaderCompiler->GetOptions())) {
+            request->Result.set_value(PinShaderCode(request->Key));
+            return request->Result.get_future().share();
+        }
+
+        lock.lock();
+        if (auto pending = m_PendingVariants.find(request->Key); pending != m_PendingVariants.end()) {
+            return pending->second;
+        }
+
+        if (!m_VariantsRunning) {
+            log::Warn("CacheManager::RequestShaderVariant: the cache is not running, cannot compile: {}", request->Key);
+            return failed();
+        }
+
+        auto result = request->Result.get_future().share();
+        m_PendingVariants[request->Key] = result;
+        m_VariantQueue.push_back(std::move(request));
+        m_VariantCondition.notify_one();
         return result;
+#else
+        log::Error("CacheManager::RequestShaderVariant: shader variant: {} has no pre-built module and this build cannot compile it", request->Key);
+        return failed();
+#endif
+    }
+
+    PinnedData CacheManager::GetShaderVariant(const String& address, const List<String>& keywords) {
+        return RequestShaderVariant(address, keywords).get();
+    }
+
+#ifdef TLC_ENABLE_SHADER_COMPILER
+    void CacheManager::ShaderVariantThread() {
+        while (true) {
+            auto requests = List<Ref<ShaderVariantRequest>>();
+            {
+                std::unique_lock<std::mutex> lock(m_VariantMutex);
+                m_VariantCondition.wait(lock, [this]() { return !m_VariantsRunning || !m_VariantQueue.empty(); });
+                if (!m_VariantsRunning) {
+                    break;
+                }
+                // whatever queued up meanwhile is compiled as one batch
+                requests.swap(m_VariantQueue);
+            }
+
+            CompileShaderVariants(requests);
+
+            std::lock_guard<std::mutex> lock(m_VariantMutex);
+            for (const auto& request : requests) {
+                m_PendingVariants.erase(request->Key);
+            }
+        }
+
+        // nobody is going to compile what is left
+        std::lock_guard<std::mutex> lock(m_VariantMutex);
+        for (auto& request : m_VariantQueue) {
+            request->Result.set_value(PinnedData());
+        }
+        m_VariantQueue.clear();
+        m_PendingVariants.clear();
+    }
+
+    void CacheManager::CompileShaderVariants(List<Ref<ShaderVariantRequest>>& requests) {
+        auto shaderCompiler = Services::Get<ShaderCompiler>();
+        auto assetManager = Services::Get<AssetManager>();
+        auto options = shaderCompiler->GetOptions();
+
+        auto compiled = List<Ref<ShaderVariantRequest>>();
+        auto sources = List<PinnedData>();
+        auto compileRequests = List<ShaderCompiler::CompileRequest>();
+        for (auto& request : requests) {
+            // may have been cached by CacheShaders since it was requested
+            if (IsShaderCached(request->Key, request->Address, *options)) {
+                request->Result.set_value(PinShaderCode(request->Key));
+                continue;
+            }
+
+            auto id = AssetId(request->Address);
+            auto stage = assetManager->AssetExists(id) ? ShaderCompiler::GetShaderType(assetManager->GetAssetTags(id)) : std::nullopt;
+            auto code = stage ? assetManager->PinAssetData(id) : PinnedData();
+            if (!stage || !code.IsValid()) {
+                log::Error("CacheManager::CompileShaderVariants: shader: {} is not loaded", request->Address);
+                request->Result.set_value(PinnedData());
+                continue;
+            }
+
+            compileRequests.push_back({ code.AsString(), *stage, request->Address, GetShaderKeywordMacros(request->Keywords) });
+            sources.push_back(std::move(code));
+            compiled.push_back(request);
+        }
+
+        if (compileRequests.empty()) {
+            return;
+        }
+
+        auto startTime = std::chrono::steady_clock::now();
+        auto results = shaderCompiler->CompileAll(compileRequests, options);
+        auto elapsed = std::chrono::duration<F64, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+        log::Info("Cache: compiled {} shader variants in {:.2f} ms", compileRequests.size(), elapsed);
+
+        for (Size i = 0; i < results.size(); i++) {
+            auto& request = compiled[i];
+            auto& spv = results[i];
+            if (spv.empty()) {
+                log::Error("CacheManager::CompileShaderVariants: failed to compile shader variant: {}", request->Key);
+                request->Result.set_value(PinnedData());
+                continue;
+            }
+
+            CacheShader(request->Key, spv, GetShaderVersion(request->Address, *options));
+            request->Result.set_value(PinShaderCode(request->Key));
+        }
     }
+#endif
 }
\ No newline at end of file
@@ -1,10 +1,38 @@
+#pragma once
+
 #include "core/Core.hpp"
 #include "services/Services.hpp"
+#include "core/PinnedData.hpp"
+#include "services/assetmanager/Asset.hpp"
 
 
 namespace tlc 
 {
+    struct ShaderInclude;
+
+#ifdef TLC_DEBUG
+    constexpr Bool k_DefaultStripShaderDebugInfo = false;
+#else
+    constexpr Bool k_DefaultStripShaderDebugInfo = true;
+#endif
+
+    // Everything the output of a compilation depends on besides the source. It is never
+    // changed in place, the setters swap in a new copy so compilations that are already
+    // running keep the options they started with.
+    struct ShaderCompileOptions
+    {
+        List<Pair<String, String>> Macros;
+        U32 OptimizationLevel = 0; // shaderc_optimization_level: 0 none, 1 size, 2 performance
+        Bool StripDebugInfo = k_DefaultStripShaderDebugInfo; // see StripSpirvDebugInfo
+        Bool EnableWarnings = true;
+        Bool WarningsAsErrors = false;
+
+        // Same for options that compile the same way, the order the macros were added in does not matter
+        U64 Hash() const;
+    };
 
+    // shaderc is optional (see TLC_WITH_SHADERC), builds without it only use the shader modules pre-built into the bundles
+#ifdef TLC_ENABLE_SHADER_COMPILER
     class ShaderCompiler : public IService
     {
     public:
@@ -16,30 +44,86 @@ namespace tlc
             Compute,
         };
 
-        inline void ClearMacros() { m_Macros.clear(); }
-        inline void AddMacro(const String& name, const String& value) { m_Macros.push_back({ name, value }); }
-        inline void SetOptimizationLevel(U32 level) { m_OptimizationLevel = level; }
-        inline void EnableWarnings(Bool enable) { m_EnableWarnings = enable; }
-        inline void SetWarningsAsErrors(Bool enable) { m_WarningsAsErrors = enable; }
-        inline void DisableWarnings() { m_EnableWarnings = false; }
+        // Reads an include by address, the includes of the loaded assets are used unless one is given
+        using IncludeLoader = std::function<PinnedData(const String& address)>;
+
+        // The stage of a shader asset, none for shader sources that are only included
+        static inline std::optional<ShaderType> GetShaderType(AssetTags assetTags)
+        {
+            static const Array<Pair<AssetTags, ShaderType>, 3> k_ShaderTypes = {{
+                { AssetTags::VertexShader, ShaderType::Vertex },
+                { AssetTags::FragmentShader, ShaderType::Fragment },
+                { AssetTags::ComputeShader, ShaderType::Compute },
+            }};
 
-        String Preprocess(const std::string& shaderSource, ShaderCompiler::ShaderType type, const String& inputFileName = "_ShaderMain");
-        String ToAssembly(const std::string& shaderSource, ShaderCompiler::ShaderType type, const String& inputFileName = "_ShaderMain");
-        List<U32> ToSpv(const std::string& shaderSource, ShaderCompiler::ShaderType type, const String& inputFileName = "_ShaderMain");
+            for (const auto& [tags, type] : k_ShaderTypes)
+            {
+                if ((assetTags & tags) == tags)
+                {
+                    return type;
+                }
+            }
+            return std::nullopt;
+        }
+
+        struct CompileRequest
+        {
+            StringView Source; // has to stay valid until the compilation is done
+            ShaderType Type = ShaderType::Vertex;
+            String InputFileName = "_ShaderMain";
+            List<Pair<String, String>> Macros; // defined on top of the ones of the options, eg. the keywords of a variant
+        };
+
+        inline void ClearMacros() { UpdateOptions([](auto& options) { options.Macros.clear(); }); }
+        inline void AddMacro(const String& name, const String& value) { UpdateOptions([&](auto& options) { options.Macros.push_back({ name, value }); }); }
+        inline void SetOptimizationLevel(U32 level) { UpdateOptions([=](auto& options) { options.OptimizationLevel = level; }); }
+        inline void EnableWarnings(Bool enable) { UpdateOptions([=](auto& options) { options.EnableWarnings = enable; }); }
+        inline void SetWarningsAsErrors(Bool enable) { UpdateOptions([=](auto& options) { options.WarningsAsErrors = enable; }); }
+        inline void SetStripDebugInfo(Bool enable) { UpdateOptions([=](auto& options) { options.StripDebugInfo = enable; }); }
+        inline void DisableWarnings() { EnableWarnings(false); }
+        Ref<const ShaderCompileOptions> GetOptions() const;
+
+        // Changes whenever an update of the toolchain could change the output for the same input
+        static U64 GetCompilerVersion();
+
+        // Safe to call from any number of threads at once, every thread compiles with its own shaderc compiler
+        String Preprocess(StringView shaderSource, ShaderCompiler::ShaderType type, const String& inputFileName = "_ShaderMain");
+        String ToAssembly(StringView shaderSource, ShaderCompiler::ShaderType type, const String& inputFileName = "_ShaderMain");
+        List<U32> ToSpv(StringView shaderSource, ShaderCompiler::ShaderType type, const String& inputFileName = "_ShaderMain");
+
+        // Compiles the requests to SPIR-V across the hardware threads, all with the given options
+        // (the current ones if none). The results are in the order of the requests, a failed
+        // compilation gives an empty one. Compilations with a loader (eg. while packing, before there
+        // are bundles to load) do not record their includes in the dependency graph of the assets,
+        // they are listed in includes instead (if given) by address for every request.
+        List<List<U32>> CompileAll(const List<CompileRequest>& requests, Ref<const ShaderCompileOptions> options = nullptr, const IncludeLoader& loader = nullptr, Raw<List<List<String>>> includes = nullptr);
 
         void Setup();
         virtual void OnStart() override;
         virtual void OnEnd() override;
 
-        // We do not care about include type (relative "" or standard <>) we only use relative
-        Pair<String, String> GetInclude(const String& requestedSource, const String& requestingSource, U32 includeDepth);
+        // We do not care about include type (relative "" or standard <>) we only use relative.
+        // Includes are resolved once and shared by every compilation until the cache is cleared,
+        // shaderc reads them straight from the pinned asset.
+        Ref<const ShaderInclude> GetInclude(const String& requestedSource, const String& requestingSource, U32 includeDepth);
+        // CompileAll clears it before every batch, clear it before single compilations if includes changed
+        void ClearIncludeCache();
 
 
     private:
-        List<Pair<String, String>> m_Macros;
-        U32 m_OptimizationLevel = 0;
-        Bool m_EnableWarnings = true;
-        Bool m_WarningsAsErrors = false;
-        std::mutex m_Mutex;
+        // requesting source -> requested sources, as seen by a compilation
+        using IncludeEdges = UnorderedMap<String, List<String>>;
+
+        void UpdateOptions(const std::function<void(ShaderCompileOptions&)>& update);
+        // Fills in the includes seen, they are only recorded in the dependency graph by the caller
+        List<U32> CompileToSpv(StringView shaderSource, ShaderCompiler::ShaderType type, const String& inputFileName, const ShaderCompileOptions& settings, const List<Pair<String, String>>& macros, const IncludeLoader& loader, IncludeEdges& includeEdges);
+
+    private:
+        Ref<const ShaderCompileOptions> m_Options = CreateRef<ShaderCompileOptions>();
+        mutable std::mutex m_Mutex; // only held to swap the options
+
+        std::shared_mutex m_IncludeMutex;
+        UnorderedMap<String, Ref<const ShaderInclude>> m_IncludeCache; // by address
     };
+#endif
 }
\ No newline at end of file
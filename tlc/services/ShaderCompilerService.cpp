@@ -1,10 +1,20 @@
 #include "services/ShaderCompiler.hpp"
 #include "services/assetmanager/AssetManager.hpp"
+#include "core/Hash.hpp"
+#include "core/SpirvStrip.hpp"
 
 #include "shaderc/shaderc.hpp"
 
+// the build passes the version of the SDK shaderc was taken from when it knows it
+#ifndef TLC_SHADERC_VERSION
+#define TLC_SHADERC_VERSION ""
+#endif
+
 namespace tlc
 {
+    // bump when the way shaders are handed to shaderc changes the output
+    static constexpr U32 k_ShaderCompilerRevision = 1;
+
     static inline shaderc_shader_kind ShaderTypeToShaderKind(const ShaderCompiler::ShaderType& type) 
     {
         switch (type)
@@ -21,54 +31,60 @@ namespace tlc
         }
     }
 
+    // A resolved include, shared by every compilation that includes it. shaderc gets the
+    // result as is, it points into the pinned asset and is never written to.
+    struct ShaderInclude
+    {
+        String Name = "";
+        PinnedData Content;
+        shaderc_include_result Result = {};
+    };
+
+    // An include that could not be read is handed to shaderc empty, which fails the compilation
+    static Ref<ShaderInclude> CreateShaderInclude(const String& name, PinnedData content)
+    {
+        auto include = CreateRef<ShaderInclude>();
+        include->Name = name;
+        include->Content = std::move(content);
+        include->Result.source_name = include->Name.c_str();
+        include->Result.source_name_length = include->Name.size();
+        if (include->Content.IsValid())
+        {
+            include->Result.content = reinterpret_cast<const char*>(include->Content.GetData());
+            include->Result.content_length = include->Content.GetSize();
+        }
+        else
+        {
+            include->Result.content = "";
+            include->Result.content_length = 0;
+        }
+        return include;
+    }
+
     class ShaderCompilerIncluder : public shaderc::CompileOptions::IncluderInterface
     {
     public:
-        ShaderCompilerIncluder(Raw<ShaderCompiler> compiler)
+        ShaderCompilerIncluder(Raw<ShaderCompiler> compiler, Raw<const ShaderCompiler::IncludeLoader> loader)
         {
             m_Compiler = compiler;
+            m_Loader = loader;
         }
 
         virtual Raw<shaderc_include_result> GetInclude(const char* requested_source, shaderc_include_type type, const char* requesting_source, size_t include_depth) override
         {
-            auto include = m_Compiler->GetInclude(
-                requested_source,
-                requesting_source,
-                static_cast<U32>(include_depth));
-
-            Raw<shaderc_include_result> result = new shaderc_include_result();
-            auto source_name = new char[include.first.size() + 1];
-            if (source_name == nullptr)
-            {
-                log::Error("ShaderCompilerIncluder::GetInclude: failed to allocate memory for source_name");
-                return nullptr;
-            }
-            std::memset(source_name, 0, include.first.size() + 1);
-            std::copy(include.first.begin(), include.first.end(), source_name);
-            result->source_name = source_name;
-            result->source_name_length = include.first.size();            
-
-            auto content = new char[include.second.size() + 1];
-            if (content == nullptr)
-            {
-                log::Error("ShaderCompilerIncluder::GetInclude: failed to allocate memory for content");
-                return nullptr;
-            }
-            std::memset(content, 0, include.second.size() + 1);
-            std::copy(include.second.begin(), include.second.end(), content);
-            result->content = content;
-            result->content_length = include.second.size();
-
-            result->user_data = this;
-            return result;
+            auto include = m_Loader != nullptr
+                ? Ref<const ShaderInclude>(CreateShaderInclude(requested_source, (*m_Loader)(requested_source)))
+                : m_Compiler->GetInclude(requested_source, requesting_source, static_cast<U32>(include_depth));
+            m_Includes[requesting_source].push_back(include->Name);
+
+            // held until the compilation is done, even if the include cache is cleared meanwhile
+            m_Held.push_back(include);
+            return const_cast<Raw<shaderc_include_result>>(&include->Result);
         }
 
-
         virtual void ReleaseInclude(Raw<shaderc_include_result> data) override
         {
-            delete[] data->source_name;
-            delete[] data->content;
-            delete data;
+            // owned by the include, released along with the includer
         }
 
         virtual ~ShaderCompilerIncluder() 
@@ -76,173 +92,340 @@ namespace tlc
             m_Compiler = nullptr;
         }
 
+        // requesting source -> requested sources
+        inline const UnorderedMap<String, List<String>>& GetIncludeEdges() const { return m_Includes; }
+
     private:
         Raw<ShaderCompiler> m_Compiler = nullptr;            
+        Raw<const ShaderCompiler::IncludeLoader> m_Loader = nullptr;
+        UnorderedMap<String, List<String>> m_Includes; // requesting source -> requested sources
+        List<Ref<const ShaderInclude>> m_Held;
     };
 
-    void ShaderCompiler::OnStart() 
+    // Every file a compilation included, directly or not, sorted
+    static List<String> GetIncludedSources(const UnorderedMap<String, List<String>>& includeEdges)
     {
-
+        auto includes = Set<String>();
+        for (const auto& [_, requested] : includeEdges)
+        {
+            includes.insert(requested.begin(), requested.end());
+        }
+        return List<String>(includes.begin(), includes.end());
     }
 
-    void ShaderCompiler::OnEnd()
+    // Records the includes seen while compiling the given source in the asset dependency graph,
+    // replacing the previous edges of every file that took part in the compilation. Variants
+    // (compiled with extra macros) may skip includes of the shader, their edges are only added.
+    static void CommitDependencies(const String& rootSource, const UnorderedMap<String, List<String>>& includeEdges, Bool mergeEdges)
     {
+        auto assetManager = Services::Get<AssetManager>();
+        if (!assetManager->AssetExists(rootSource))
+        {
+            return; // compiled from memory, there is no asset to invalidate
+        }
 
+        auto sources = Set<String>{ rootSource };
+        for (const auto& [_, includes] : includeEdges)
+        {
+            sources.insert(includes.begin(), includes.end());
+        }
+
+        auto& graph = assetManager->GetDependencyGraph();
+        for (const auto& source : sources)
+        {
+            auto includes = includeEdges.find(source);
+            auto dependencies = includes != includeEdges.end() ? includes->second : List<String>();
+            if (mergeEdges)
+            {
+                graph.AddDependencies(source, dependencies);
+            }
+            else
+            {
+                graph.SetDependencies(source, dependencies);
+            }
+        }
     }
 
-    void ShaderCompiler::Setup() 
+    // shaderc compilers are cheap to keep around but not meant to be shared between threads
+    static shaderc::Compiler& GetThreadCompiler()
     {
-
+        thread_local shaderc::Compiler compiler;
+        return compiler;
     }
 
-    String ShaderCompiler::Preprocess(const std::string& shaderSource, ShaderCompiler::ShaderType type, const String& inputFileName)
+    // The includer records the includes seen by the compilation, commit them once it is done
+    static shaderc::CompileOptions CreateCompileOptions(const ShaderCompileOptions& settings, const List<Pair<String, String>>& macros, Raw<ShaderCompiler> compiler, Raw<const ShaderCompiler::IncludeLoader> loader, Raw<ShaderCompilerIncluder>& includer)
     {
-        std::lock_guard<std::mutex> lock(m_Mutex);
-
-        shaderc::Compiler compiler;
-        shaderc::CompileOptions options;    
-
-        for (auto& [name, value] : m_Macros)
+        shaderc::CompileOptions options;
+        for (auto& [name, value] : settings.Macros)
+        {
+            options.AddMacroDefinition(name, value);
+        }
+        for (auto& [name, value] : macros)
         {
             options.AddMacroDefinition(name, value);
         }
         options.SetSourceLanguage(shaderc_source_language_glsl);
-        options.SetOptimizationLevel(shaderc_optimization_level(m_OptimizationLevel));
-        if (!m_EnableWarnings) options.SetSuppressWarnings();
-        if (m_EnableWarnings && m_WarningsAsErrors) options.SetWarningsAsErrors();       
-        options.SetIncluder(CreateScope<ShaderCompilerIncluder>(this));
-
-        auto result = compiler.PreprocessGlsl(shaderSource, ShaderTypeToShaderKind(type), inputFileName.c_str(), options);
+        options.SetOptimizationLevel(shaderc_optimization_level(settings.OptimizationLevel));
+        if (!settings.EnableWarnings) options.SetSuppressWarnings();
+        if (settings.EnableWarnings && settings.WarningsAsErrors) options.SetWarningsAsErrors();
+
+        auto ownedIncluder = CreateScope<ShaderCompilerIncluder>(compiler, loader);
+        includer = ownedIncluder.get();
+        options.SetIncluder(std::move(ownedIncluder));
+        return options;
+    }
 
-        if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+    // Tells the variants of a shader apart in the log, eg. " [SKINNED=1, FOG=1]"
+    static String GetMacroSuffix(const List<Pair<String, String>>& macros)
+    {
+        if (macros.empty())
         {
-            log::Error("ShaderCompiler::PreprocessShader: failed to preprocess shader: {}", result.GetErrorMessage());
-            return "";
+            return String();
         }
 
-        if (m_EnableWarnings && result.GetNumWarnings() > 0)
+        auto suffix = String(" [");
+        for (const auto& [name, value] : macros)
         {
-            log::Warn("ShaderCompiler::PreprocessShader: shader has warnings: {}", result.GetNumWarnings());
-            for (U32 i = 0; i < result.GetNumWarnings(); i++)
+            if (suffix.size() > 2)
             {
-                log::Warn("warning: {}", result.GetErrorMessage());
+                suffix += ", ";
             }
+            suffix += value.empty() ? name : std::format("{}={}", name, value);
         }
+        return suffix + "]";
+    }
 
-        if (result.GetNumErrors() > 0)
+    template<typename Result>
+    static Bool CheckCompilationResult(const Result& result, const ShaderCompileOptions& settings, const String& inputFileName)
+    {
+        if (result.GetCompilationStatus() != shaderc_compilation_status_success || result.GetNumErrors() > 0)
         {
-            log::Error("ShaderCompiler::PreprocessShader: shader has errors: {}", result.GetNumErrors());
-            for (U32 i = 0; i < result.GetNumErrors(); i++)
-            {
-                log::Error("error: {}", result.GetErrorMessage());
-            }
-            return "";
+            log::Error("ShaderCompiler: failed to compile shader: {} with {} errors: {}", inputFileName, result.GetNumErrors(), result.GetErrorMessage());
+            return false;
         }
 
-        return String(result.begin(), result.end());
+        if (settings.EnableWarnings && result.GetNumWarnings() > 0)
+        {
+            log::Warn("ShaderCompiler: shader: {} has {} warnings: {}", inputFileName, result.GetNumWarnings(), result.GetErrorMessage());
+        }
+        return true;
     }
 
-    String ShaderCompiler::ToAssembly(const std::string& shaderSource, ShaderCompiler::ShaderType type, const String& inputFileName)
+    U64 ShaderCompileOptions::Hash() const
     {
-        std::lock_guard<std::mutex> lock(m_Mutex);
-        
-        shaderc::Compiler compiler;
-        shaderc::CompileOptions options;    
+        auto macros = Macros;
+        std::sort(macros.begin(), macros.end());
 
-        for (auto& [name, value] : m_Macros)
+        auto hasher = Hasher();
+        hasher.UpdateValue(macros.size());
+        for (const auto& [name, value] : macros)
         {
-            options.AddMacroDefinition(name, value);
+            // lengths first so the boundaries between the strings are part of the hash
+            hasher.UpdateValue(name.size());
+            hasher.Update(name.data(), name.size());
+            hasher.UpdateValue(value.size());
+            hasher.Update(value.data(), value.size());
         }
-        options.SetSourceLanguage(shaderc_source_language_glsl);
-        options.SetOptimizationLevel(shaderc_optimization_level(m_OptimizationLevel));
-        if (!m_EnableWarnings) options.SetSuppressWarnings();
-        if (m_EnableWarnings && m_WarningsAsErrors) options.SetWarningsAsErrors();       
-        options.SetIncluder(CreateScope<ShaderCompilerIncluder>(this));
+        hasher.UpdateValue(OptimizationLevel);
+        hasher.UpdateValue(StripDebugInfo);
+        // warnings never change the output, only whether it fails
+        hasher.UpdateValue(EnableWarnings && WarningsAsErrors);
+        return hasher.Digest();
+    }
 
-        auto result = compiler.CompileGlslToSpvAssembly(shaderSource, ShaderTypeToShaderKind(type), inputFileName.c_str(), options);
+    U64 ShaderCompiler::GetCompilerVersion()
+    {
+        static const U64 s_Version = []() {
+            auto spvVersion = 0u, spvRevision = 0u;
+            shaderc_get_spv_version(&spvVersion, &spvRevision);
+
+            auto toolchain = StringView(TLC_SHADERC_VERSION);
+            auto hasher = Hasher();
+            hasher.UpdateValue(k_ShaderCompilerRevision);
+            hasher.UpdateValue(spvVersion);
+            hasher.UpdateValue(spvRevision);
+            hasher.Update(toolchain.data(), toolchain.size());
+            return hasher.Digest();
+        }();
+        return s_Version;
+    }
 
-        if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+    void ShaderCompiler::OnStart() 
+    {
+
+    }
+
+    void ShaderCompiler::OnEnd()
+    {
+
+    }
+
+    void ShaderCompiler::Setup() 
+    {
+
+    }
+
+    Ref<const ShaderCompileOptions> ShaderCompiler::GetOptions() const
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_Options;
+    }
+
+    void ShaderCompiler::UpdateOptions(const std::function<void(ShaderCompileOptions&)>& update)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto options = CreateRef<ShaderCompileOptions>(*m_Options);
+        update(*options);
+        m_Options = std::move(options);
+    }
+
+    String ShaderCompiler::Preprocess(StringView shaderSource, ShaderCompiler::ShaderType type, const String& inputFileName)
+    {
+        auto settings = GetOptions();
+        auto includer = Raw<ShaderCompilerIncluder>(nullptr);
+        auto options = CreateCompileOptions(*settings, {}, this, nullptr, includer);
+
+        auto result = GetThreadCompiler().PreprocessGlsl(shaderSource.data(), shaderSource.size(), ShaderTypeToShaderKind(type), inputFileName.c_str(), options);
+        CommitDependencies(inputFileName, includer->GetIncludeEdges(), false);
+        if (!CheckCompilationResult(result, *settings, inputFileName))
         {
-            log::Error("ShaderCompiler::PreprocessShader: failed to preprocess shader: {}", result.GetErrorMessage());
             return "";
         }
 
-        if (m_EnableWarnings && result.GetNumWarnings() > 0)
-        {
-            log::Warn("ShaderCompiler::PreprocessShader: shader has warnings: {}", result.GetNumWarnings());
-            for (U32 i = 0; i < result.GetNumWarnings(); i++)
-            {
-                log::Warn("warning: {}", result.GetErrorMessage());
-            }
-        }
+        return String(result.begin(), result.end());
+    }
+
+    String ShaderCompiler::ToAssembly(StringView shaderSource, ShaderCompiler::ShaderType type, const String& inputFileName)
+    {
+        auto settings = GetOptions();
+        auto includer = Raw<ShaderCompilerIncluder>(nullptr);
+        auto options = CreateCompileOptions(*settings, {}, this, nullptr, includer);
 
-        if (result.GetNumErrors() > 0)
+        auto result = GetThreadCompiler().CompileGlslToSpvAssembly(shaderSource.data(), shaderSource.size(), ShaderTypeToShaderKind(type), inputFileName.c_str(), options);
+        CommitDependencies(inputFileName, includer->GetIncludeEdges(), false);
+        if (!CheckCompilationResult(result, *settings, inputFileName))
         {
-            log::Error("ShaderCompiler::PreprocessShader: shader has errors: {}", result.GetNumErrors());
-            for (U32 i = 0; i < result.GetNumErrors(); i++)
-            {
-                log::Error("error: {}", result.GetErrorMessage());
-            }
             return "";
         }
 
         return String(result.begin(), result.end());
     }
 
-    List<U32> ShaderCompiler::ToSpv(const std::string& shaderSource, ShaderCompiler::ShaderType type, const String& inputFileName)
+    List<U32> ShaderCompiler::ToSpv(StringView shaderSource, ShaderCompiler::ShaderType type, const String& inputFileName)
     {
-        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto includeEdges = IncludeEdges();
+        auto spirv = CompileToSpv(shaderSource, type, inputFileName, *GetOptions(), {}, nullptr, includeEdges);
+        CommitDependencies(inputFileName, includeEdges, false);
+        return spirv;
+    }
 
-        shaderc::Compiler compiler;
-        shaderc::CompileOptions options;    
+    List<U32> ShaderCompiler::CompileToSpv(StringView shaderSource, ShaderCompiler::ShaderType type, const String& inputFileName, const ShaderCompileOptions& settings, const List<Pair<String, String>>& macros, const IncludeLoader& loader, IncludeEdges& includeEdges)
+    {
+        auto includer = Raw<ShaderCompilerIncluder>(nullptr);
+        auto options = CreateCompileOptions(settings, macros, this, loader ? &loader : nullptr, includer);
 
-        for (auto& [name, value] : m_Macros)
+        auto result = GetThreadCompiler().CompileGlslToSpv(shaderSource.data(), shaderSource.size(), ShaderTypeToShaderKind(type), inputFileName.c_str(), options);
+        includeEdges = includer->GetIncludeEdges();
+        if (!CheckCompilationResult(result, settings, inputFileName))
         {
-            options.AddMacroDefinition(name, value);
+            return List<U32>();
         }
-        options.SetSourceLanguage(shaderc_source_language_glsl);
-        options.SetOptimizationLevel(shaderc_optimization_level(m_OptimizationLevel));
-        if (!m_EnableWarnings) options.SetSuppressWarnings();
-        if (m_EnableWarnings && m_WarningsAsErrors) options.SetWarningsAsErrors();       
-        options.SetIncluder(CreateScope<ShaderCompilerIncluder>(this));
 
-        auto result = compiler.CompileGlslToSpv(shaderSource, ShaderTypeToShaderKind(type), inputFileName.c_str(), options);
+        auto spirv = List<U32>(result.begin(), result.end());
+        if (settings.StripDebugInfo)
+        {
+            auto unstrippedSize = spirv.size() * sizeof(U32);
+            if (StripSpirvDebugInfo(spirv))
+            {
+                auto strippedSize = spirv.size() * sizeof(U32);
+                log::Info("ShaderCompiler: stripped {}{} from {} to {} bytes ({:+.1f}%)", inputFileName, GetMacroSuffix(macros), unstrippedSize, strippedSize,
+                    100.0 * (static_cast<F64>(strippedSize) - static_cast<F64>(unstrippedSize)) / static_cast<F64>(unstrippedSize));
+            }
+        }
+        return spirv;
+    }
 
-        if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+    List<List<U32>> ShaderCompiler::CompileAll(const List<CompileRequest>& requests, Ref<const ShaderCompileOptions> options, const IncludeLoader& loader, Raw<List<List<String>>> includes)
+    {
+        // one snapshot for the whole batch, the compilations are independent of each other.
+        // Every batch resolves its includes again, so edits since the last one are picked up.
+        auto settings = options ? options : GetOptions();
+        if (!loader)
         {
-            log::Error("ShaderCompiler::PreprocessShader: failed to preprocess shader: {}", result.GetErrorMessage());
-            return List<U32>();
+            ClearIncludeCache();
         }
 
-        if (m_EnableWarnings && result.GetNumWarnings() > 0)
+        auto results = List<List<U32>>(requests.size());
+        auto includeEdges = List<IncludeEdges>(requests.size());
+        utils::ParallelFor(requests.size(), [&](Size i) {
+            const auto& request = requests[i];
+            results[i] = CompileToSpv(request.Source, request.Type, request.InputFileName, *settings, request.Macros, loader, includeEdges[i]);
+        });
+
+        if (includes != nullptr)
         {
-            log::Warn("ShaderCompiler::PreprocessShader: shader has warnings: {}", result.GetNumWarnings());
-            for (U32 i = 0; i < result.GetNumWarnings(); i++)
+            includes->clear();
+            for (const auto& edges : includeEdges)
             {
-                log::Warn("warning: {}", result.GetErrorMessage());
+                includes->push_back(GetIncludedSources(edges));
             }
         }
+        if (loader)
+        {
+            return results;
+        }
 
-        if (result.GetNumErrors() > 0)
+        // Committed here once the batch is done rather than by the workers. A shader and its
+        // variants in the same batch may include different files (eg. under #ifdef KEYWORD),
+        // their edges are combined so none of them depends on the order the compilations finish in.
+        // The edges replace the previous ones if the shader itself was compiled, variants compiled
+        // on their own only add theirs.
+        auto combinedEdges = UnorderedMap<String, Pair<IncludeEdges, Bool>>(); // by shader, the edges and whether the shader itself was compiled
+        for (Size i = 0; i < requests.size(); i++)
         {
-            log::Error("ShaderCompiler::PreprocessShader: shader has errors: {}", result.GetNumErrors());
-            for (U32 i = 0; i < result.GetNumErrors(); i++)
+            auto& [edges, compiledShader] = combinedEdges[requests[i].InputFileName];
+            for (const auto& [source, requested] : includeEdges[i])
             {
-                log::Error("error: {}", result.GetErrorMessage());
+                auto& combined = edges[source];
+                combined.insert(combined.end(), requested.begin(), requested.end());
             }
-            return List<U32>();
+            compiledShader = compiledShader || requests[i].Macros.empty();
         }
-
-        return List<U32>(result.begin(), result.end());
+        for (const auto& [shader, edges] : combinedEdges)
+        {
+            CommitDependencies(shader, edges.first, !edges.second);
+        }
+        return results;
     }
 
+    Ref<const ShaderInclude> ShaderCompiler::GetInclude(const String& requestedSource, const String& requestingSource, U32 includeDepth)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(m_IncludeMutex);
+            auto cached = m_IncludeCache.find(requestedSource);
+            if (cached != m_IncludeCache.end())
+            {
+                return cached->second;
+            }
+        }
+
+        auto include = CreateShaderInclude(requestedSource, Services::Get<AssetManager>()->PinAssetData(requestedSource));
+        if (!include->Content.IsValid())
+        {
+            // not cached, the include may exist by the next compilation
+            return include;
+        }
 
+        // another compilation may have resolved it meanwhile, keep the first one
+        std::lock_guard<std::shared_mutex> lock(m_IncludeMutex);
+        return m_IncludeCache.try_emplace(requestedSource, std::move(include)).first->second;
+    }
 
-    Pair<String, String> ShaderCompiler::GetInclude(const String& requestedSource, const String& requestingSource, U32 includeDepth)
+    void ShaderCompiler::ClearIncludeCache()
     {
-        auto assetManager = Services::Get<AssetManager>();
-        auto include = assetManager->GetAssetDataString(requestedSource);
-        return { requestedSource, include };
+        std::lock_guard<std::shared_mutex> lock(m_IncludeMutex);
+        m_IncludeCache.clear();
     }
 
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include "core/Core.hpp"
+#include "services/assetmanager/AssetId.hpp"
 
 namespace tlc 
 {
@@ -13,6 +14,9 @@ namespace tlc
         VertexShader         = 0b00000000000000000000000000010000,
         FragmentShader       = 0b00000000000000000000000000100000,
         ComputeShader        = 0b00000000000000000000000001000000,
+        Texture              = 0b00000000000000000000000010000000, // cooked at pack time, see CookedTextureHeader
+        FontAtlas            = 0b00000000000000000000000100000000, // baked at pack time, see FontAtlasHeader
+        ShaderModule         = 0b00000000000000000000001000000000, // SPIR-V compiled at pack time, see ShaderModuleHeader
     };
 
     inline AssetTags operator|(AssetTags a, AssetTags b) {
@@ -34,6 +38,9 @@ namespace tlc
             case AssetTags::Audio: return "Audio";
             case AssetTags::Font: return "Font";
             case AssetTags::Shader: return "Shader";
+            case AssetTags::Texture: return "Texture";
+            case AssetTags::FontAtlas: return "FontAtlas";
+            case AssetTags::ShaderModule: return "ShaderModule";
             default: return "Unknown";
         }
     }
@@ -57,16 +64,56 @@ namespace tlc
         return result;
     }
 
+    // Tags of a raw asset file from its extension
+    inline AssetTags DetectAssetTags(const String& path) {
+        auto tags = AssetTags::None;
+
+        if (path.ends_with(".png") || path.ends_with(".jpg") || path.ends_with(".jpeg")) {
+            tags = tags | AssetTags::Image;
+        }
+        else if (path.ends_with(".wav") || path.ends_with(".mp3") || path.ends_with(".ogg")) {
+            tags = tags | AssetTags::Audio;
+        }
+        else if (path.ends_with(".ttf") || path.ends_with(".otf")) {
+            tags = tags | AssetTags::Font;
+        }
+        else if (path.ends_with(".glsl")) {
+            tags = tags | AssetTags::Shader;
+            if (path.find("vert.glsl") != String::npos) {
+                tags = tags | AssetTags::VertexShader;
+            }
+            else if (path.find("frag.glsl") != String::npos) {
+                tags = tags | AssetTags::FragmentShader;
+            }
+            else if (path.find("comp.glsl") != String::npos) {
+                tags = tags | AssetTags::ComputeShader;
+            }
+        }
+        return tags;
+    }
+
     struct Asset {
         String Path = "";
         String Address = "";
-        UUID UUID = UUID::Zero();
-        Raw<U8> Data = nullptr;
-        Size Offset = 0;
-        Size Size = 0;
+        AssetId Id = AssetId();
+        tlc::UUID UUID = tlc::UUID::Zero(); // qualified, the member shadows the type
+        Raw<const U8> Data = nullptr;
+        tlc::Size Offset = 0;
+        tlc::Size Size = 0;
         AssetTags Tags = AssetTags::None;
-        U32 Hash = 0;
+        U64 Hash = 0;
+        U64 ModifiedTime = 0;
+        U32 Alignment = 1;
+
+        // only used by the AssetBundler
+        U64 SourceSize = 0;
+        U64 SourceHash = 0;
+        U32 CookFingerprint = 0;
+        String CookedPath = ""; // payload is read from here instead of Path when the asset was cooked
     };
+
+    // Lightweight reference to an asset owned by the AssetManager
+    using AssetHandle = Raw<const Asset>;
 }
 
 namespace std {
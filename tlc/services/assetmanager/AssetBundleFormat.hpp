@@ -0,0 +1,298 @@
+#pragma once
+
+#include "core/Core.hpp"
+#include "services/assetmanager/AssetId.hpp"
+
+namespace tlc
+{
+    // Layout of a .bundle file on disk:
+    //
+    //  [AssetBundleHeader]
+    //  [AssetBundleRecord x assetCount]    (sorted by address hash)
+    //  [string table]                      (null terminated addresses)
+    //  [asset data]
+    //
+    // The header, records and string table together form the table of contents,
+    // which is small enough to be loaded in a single read. The header carries a hash
+    // of the records and string table, the records carry a hash of every payload.
+
+    constexpr U32 k_AssetBundleMagic = 0x42434C54; // "TLCB"
+    constexpr U32 k_AssetBundleVersion = 4;
+
+    struct AssetBundleHeader {
+        U32 Magic = k_AssetBundleMagic;
+        U32 Version = k_AssetBundleVersion;
+        U32 AssetCount = 0;
+        U32 StringTableSize = 0;
+        U64 TableOfContentsSize = 0; // records + string table, excluding the header
+        U64 DataOffset = 0;
+        U64 TableOfContentsHash = 0; // of the records and string table, see utils::HashBuffer
+    };
+
+    struct AssetBundleRecord {
+        U64 AddressHash = 0;
+        U64 Offset = 0;
+        U64 Size = 0;
+        U64 Hash = 0; // of the payload, see utils::HashBuffer
+        U32 Tags = 0;
+        U32 AddressOffset = 0; // into the string table
+        U32 AddressLength = 0;
+        U32 Alignment = 1; // of Offset, always a power of two
+        U8 UUID[16] = {};
+    };
+
+    static_assert(sizeof(AssetBundleHeader) == 40, "AssetBundleHeader must be tightly packed");
+    static_assert(sizeof(AssetBundleRecord) == 64, "AssetBundleRecord must be tightly packed");
+
+    // A .manifest file is written next to every bundle by the AssetBundler and records
+    // the state of the source files that went into it, so unchanged bundles can be skipped:
+    //
+    //  [AssetManifestHeader]
+    //  [AssetManifestRecord, path, address] x EntryCount
+
+    constexpr U32 k_AssetManifestMagic = 0x4D434C54; // "TLCM"
+    constexpr U32 k_AssetManifestVersion = 4;
+
+    struct AssetManifestHeader {
+        U32 Magic = k_AssetManifestMagic;
+        U32 Version = k_AssetManifestVersion;
+        U32 BundleVersion = k_AssetBundleVersion;
+        U32 EntryCount = 0;
+    };
+
+    struct AssetManifestRecord {
+        U64 ModifiedTime = 0;
+        U64 SourceSize = 0;
+        U64 Size = 0; // of the payload, differs from the source for cooked assets
+        U64 SourceHash = 0;
+        U64 Hash = 0;
+        U32 Tags = 0;
+        U32 CookFingerprint = 0; // settings the payload was cooked with, 0 if stored as is
+        U32 PathLength = 0;
+        U32 AddressLength = 0;
+        U32 Alignment = 1;
+        U32 Reserved = 0;
+        U8 UUID[16] = {};
+    };
+
+    static_assert(sizeof(AssetManifestHeader) == 16, "AssetManifestHeader must be tightly packed");
+    static_assert(sizeof(AssetManifestRecord) == 80, "AssetManifestRecord must be tightly packed");
+
+    // Images are cooked at pack time into GPU ready textures, the payload of an asset
+    // tagged AssetTags::Texture is laid out as:
+    //
+    //  [CookedTextureHeader]
+    //  [CookedTextureMip x MipCount]       (largest mip first)
+    //  [texel data]                        (every mip starts at a 16 byte boundary)
+    //
+    // Texel data can be copied as is into a staging buffer, RGBA8 maps to
+    // vk::Format::eR8G8B8A8Unorm and BC1 to vk::Format::eBc1RgbaUnormBlock
+    // (or their Srgb variants when k_CookedTextureFlagSRGB is set).
+
+    constexpr U32 k_CookedTextureMagic = 0x54434C54; // "TLCT"
+    constexpr U32 k_CookedTextureVersion = 1;
+    constexpr U32 k_CookedTextureFlagSRGB = 0x1;
+    constexpr U32 k_MaxCookedTextureMips = 16;
+
+    enum class CookedTextureFormat : U32 {
+        RGBA8 = 0,
+        BC1 = 1,
+    };
+
+    struct CookedTextureHeader {
+        U32 Magic = k_CookedTextureMagic;
+        U32 Version = k_CookedTextureVersion;
+        CookedTextureFormat Format = CookedTextureFormat::RGBA8;
+        U32 Flags = 0;
+        U32 Width = 0;
+        U32 Height = 0;
+        U32 MipCount = 0;
+        U32 Reserved = 0;
+    };
+
+    struct CookedTextureMip {
+        U32 Width = 0;
+        U32 Height = 0;
+        U64 Offset = 0; // from the start of the payload
+        U64 Size = 0;
+    };
+
+    static_assert(sizeof(CookedTextureHeader) == 32, "CookedTextureHeader must be tightly packed");
+    static_assert(sizeof(CookedTextureMip) == 24, "CookedTextureMip must be tightly packed");
+
+    // Validates a cooked texture payload and points header and mips into it
+    inline Bool ReadCookedTexture(Raw<const U8> data, Size size, Raw<const CookedTextureHeader>& header, Raw<const CookedTextureMip>& mips) {
+        if (data == nullptr || size < sizeof(CookedTextureHeader)) {
+            return false;
+        }
+
+        header = reinterpret_cast<const CookedTextureHeader*>(data);
+        if (header->Magic != k_CookedTextureMagic || header->Version != k_CookedTextureVersion || header->MipCount == 0 || header->MipCount > k_MaxCookedTextureMips) {
+            return false;
+        }
+
+        if (size < sizeof(CookedTextureHeader) + header->MipCount * sizeof(CookedTextureMip)) {
+            return false;
+        }
+
+        mips = reinterpret_cast<const CookedTextureMip*>(data + sizeof(CookedTextureHeader));
+        for (U32 i = 0; i < header->MipCount; i++) {
+            if (mips[i].Offset > size || mips[i].Size > size - mips[i].Offset) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Fonts are baked at pack time into a single atlas, the payload of an asset
+    // tagged AssetTags::FontAtlas is laid out as:
+    //
+    //  [FontAtlasHeader]
+    //  [FontAtlasFont x FontCount]
+    //  [FontAtlasGlyph x GlyphCount]       (grouped by font)
+    //  [string table]                      (font names, not null terminated)
+    //  [alpha8 pixels]                     (Width x Height, at PixelsOffset)
+
+    constexpr U32 k_FontAtlasMagic = 0x46434C54; // "TLCF"
+    constexpr U32 k_FontAtlasVersion = 1;
+
+    struct FontAtlasHeader {
+        U32 Magic = k_FontAtlasMagic;
+        U32 Version = k_FontAtlasVersion;
+        U32 Width = 0;
+        U32 Height = 0;
+        U32 FontCount = 0;
+        U32 GlyphCount = 0;
+        U32 StringTableSize = 0;
+        U32 Reserved = 0;
+        F32 WhitePixelU = 0.0f;
+        F32 WhitePixelV = 0.0f;
+        U64 PixelsOffset = 0;
+    };
+
+    struct FontAtlasFont {
+        U32 NameOffset = 0; // into the string table
+        U32 NameLength = 0;
+        U32 FirstGlyph = 0;
+        U32 GlyphCount = 0;
+        F32 Size = 0.0f;
+        F32 Ascent = 0.0f;
+        F32 Descent = 0.0f;
+        U32 Reserved = 0;
+    };
+
+    struct FontAtlasGlyph {
+        U32 Codepoint = 0;
+        F32 AdvanceX = 0.0f;
+        F32 X0 = 0.0f, Y0 = 0.0f, X1 = 0.0f, Y1 = 0.0f;
+        F32 U0 = 0.0f, V0 = 0.0f, U1 = 0.0f, V1 = 0.0f;
+    };
+
+    static_assert(sizeof(FontAtlasHeader) == 48, "FontAtlasHeader must be tightly packed");
+    static_assert(sizeof(FontAtlasFont) == 32, "FontAtlasFont must be tightly packed");
+    static_assert(sizeof(FontAtlasGlyph) == 40, "FontAtlasGlyph must be tightly packed");
+
+    // Validates a baked font atlas payload and points the tables into it
+    inline Bool ReadFontAtlas(
+        Raw<const U8> data,
+        Size size,
+        Raw<const FontAtlasHeader>& header,
+        Raw<const FontAtlasFont>& fonts,
+        Raw<const FontAtlasGlyph>& glyphs,
+        Raw<const char>& stringTable
+    ) {
+        if (data == nullptr || size < sizeof(FontAtlasHeader)) {
+            return false;
+        }
+
+        header = reinterpret_cast<const FontAtlasHeader*>(data);
+        if (header->Magic != k_FontAtlasMagic || header->Version != k_FontAtlasVersion) {
+            return false;
+        }
+
+        auto tablesSize = static_cast<U64>(header->FontCount) * sizeof(FontAtlasFont) + static_cast<U64>(header->GlyphCount) * sizeof(FontAtlasGlyph) + header->StringTableSize;
+        auto pixelsSize = static_cast<U64>(header->Width) * header->Height;
+        if (sizeof(FontAtlasHeader) + tablesSize > size || header->PixelsOffset > size || pixelsSize > size - header->PixelsOffset) {
+            return false;
+        }
+
+        fonts = reinterpret_cast<const FontAtlasFont*>(data + sizeof(FontAtlasHeader));
+        glyphs = reinterpret_cast<const FontAtlasGlyph*>(fonts + header->FontCount);
+        stringTable = reinterpret_cast<const char*>(glyphs + header->GlyphCount);
+        for (U32 i = 0; i < header->FontCount; i++) {
+            if (static_cast<U64>(fonts[i].FirstGlyph) + fonts[i].GlyphCount > header->GlyphCount || static_cast<U64>(fonts[i].NameOffset) + fonts[i].NameLength > header->StringTableSize) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Shaders are compiled at pack time, every shader and every declared variant of it is
+    // stored as an asset tagged AssetTags::ShaderModule at the cache key of the variant
+    // followed by k_ShaderModuleAddressSuffix (eg. shaders/lit.glsl|FOG.spv), laid out as:
+    //
+    //  [ShaderModuleHeader]
+    //  [SPIR-V]                            (at SpirvOffset, word aligned)
+    //  [serialized ShaderReflection]       (at ReflectionOffset)
+    //  [string table]                      (source address then its includes, null terminated)
+    //
+    // The sources are listed so the runtime can tell whether they changed since the module
+    // was packed (eg. hot reloaded) without the dependency graph of the compilation.
+
+    constexpr U32 k_ShaderModuleMagic = 0x53434C54; // "TLCS"
+    constexpr U32 k_ShaderModuleVersion = 1;
+    constexpr const char* k_ShaderModuleAddressSuffix = ".spv";
+
+    struct ShaderModuleHeader {
+        U32 Magic = k_ShaderModuleMagic;
+        U32 Version = k_ShaderModuleVersion;
+        U32 Stage = 0; // see ShaderStage
+        U32 IncludeCount = 0;
+        U64 SourceHash = 0; // see GetShaderModuleSourceHash
+        U64 CompilerVersion = 0; // see ShaderCompiler::GetCompilerVersion
+        U64 OptionsHash = 0; // see ShaderCompileOptions::Hash
+        U64 SpirvOffset = 0;
+        U64 SpirvSize = 0;
+        U64 ReflectionOffset = 0;
+        U64 ReflectionSize = 0;
+        U64 StringTableOffset = 0;
+        U64 StringTableSize = 0;
+    };
+
+    static_assert(sizeof(ShaderModuleHeader) == 88, "ShaderModuleHeader must be tightly packed");
+
+    // Validates a shader module payload and points header and string table into it
+    inline Bool ReadShaderModule(Raw<const U8> data, Size size, Raw<const ShaderModuleHeader>& header, Raw<const char>& stringTable) {
+        if (data == nullptr || size < sizeof(ShaderModuleHeader)) {
+            return false;
+        }
+
+        header = reinterpret_cast<const ShaderModuleHeader*>(data);
+        if (header->Magic != k_ShaderModuleMagic || header->Version != k_ShaderModuleVersion) {
+            return false;
+        }
+
+        for (const auto& [offset, sectionSize] : { Pair<U64, U64>{ header->SpirvOffset, header->SpirvSize }, { header->ReflectionOffset, header->ReflectionSize }, { header->StringTableOffset, header->StringTableSize } }) {
+            if (offset > size || sectionSize > size - offset) {
+                return false;
+            }
+        }
+
+        if (header->SpirvOffset % sizeof(U32) != 0 || header->SpirvSize % sizeof(U32) != 0 || header->SpirvSize == 0) {
+            return false;
+        }
+
+        // the source address and every include
+        stringTable = reinterpret_cast<const char*>(data + header->StringTableOffset);
+        auto numStrings = std::count(stringTable, stringTable + header->StringTableSize, '\0');
+        return header->StringTableSize > 0 && stringTable[header->StringTableSize - 1] == '\0' && static_cast<U64>(numStrings) == static_cast<U64>(header->IncludeCount) + 1;
+    }
+
+    constexpr U32 k_DefaultAssetAlignment = 16;
+    constexpr U32 k_DefaultImageAssetAlignment = 256;
+    constexpr U32 k_MaxAssetAlignment = 64 * 1024; // bundles are mapped at page (or allocation granularity) boundaries
+
+    inline constexpr U64 AlignAssetOffset(U64 offset, U32 alignment) {
+        return (offset + alignment - 1) & ~static_cast<U64>(alignment - 1);
+    }
+}
@@ -0,0 +1,115 @@
+#include "services/assetmanager/AssetBundleVerifier.hpp"
+
+namespace tlc
+{
+    void AssetBundleVerifier::Start()
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_Running) {
+            return;
+        }
+
+        m_Running = true;
+        m_Thread = std::thread(&AssetBundleVerifier::VerifyThread, this);
+    }
+
+    void AssetBundleVerifier::Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (!m_Running) {
+                return;
+            }
+
+            // whatever is still queued is dropped, a bundle being verified finishes early
+            m_Running = false;
+            while (!m_Queue.empty()) {
+                m_Queue.front()->Cancelled = true;
+                m_Queue.pop();
+            }
+        }
+
+        m_QueueCondition.notify_all();
+        if (m_Thread.joinable()) {
+            m_Thread.join();
+        }
+        m_IdleCondition.notify_all();
+    }
+
+    void AssetBundleVerifier::Enqueue(Ref<AssetBundleVerification> verification)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (!m_Running) {
+                log::Warn("AssetBundleVerifier: not running, bundle: {} will not be verified", verification->BundleName);
+                return;
+            }
+            m_Queue.push(std::move(verification));
+        }
+        m_QueueCondition.notify_one();
+    }
+
+    void AssetBundleVerifier::Wait()
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_IdleCondition.wait(lock, [this]() { return !m_Running || (m_Queue.empty() && !m_Busy); });
+    }
+
+    void AssetBundleVerifier::VerifyThread()
+    {
+        while (true) {
+            auto verification = Ref<AssetBundleVerification>();
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Busy = false;
+                m_IdleCondition.notify_all();
+                m_QueueCondition.wait(lock, [this]() { return !m_Running || !m_Queue.empty(); });
+                if (!m_Running) {
+                    return;
+                }
+
+                verification = std::move(m_Queue.front());
+                m_Queue.pop();
+                m_Busy = true;
+            }
+
+            Verify(*verification);
+        }
+    }
+
+    void AssetBundleVerifier::Verify(AssetBundleVerification& verification)
+    {
+        auto startTime = std::chrono::steady_clock::now();
+        const auto data = verification.Mapping->GetData();
+
+        auto numThreads = std::max<Size>(std::thread::hardware_concurrency() / 2, 1);
+        utils::ParallelFor(verification.Assets.size(), numThreads, [&](Size i) {
+            if (verification.Cancelled) {
+                return;
+            }
+
+            const auto& asset = verification.Assets[i];
+            if (utils::HashBuffer(data + asset.Offset, asset.Size) == asset.Hash) {
+                verification.Results[i] = AssetIntegrity::Valid;
+                return;
+            }
+
+            verification.Results[i] = AssetIntegrity::Corrupted;
+            verification.NumCorrupted++;
+            log::Error("Bundle: {} asset: {} is corrupted, its data does not match the hash it was packed with!", verification.BundleName, asset.Address);
+        });
+
+        verification.Done = true;
+        if (verification.Cancelled) {
+            return;
+        }
+
+        auto elapsed = std::chrono::duration<F64, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+        if (verification.NumCorrupted > 0) {
+            log::Error("Bundle: {} failed verification, {} of {} assets are corrupted, repack it!", verification.BundleName, verification.NumCorrupted.load(), verification.Assets.size());
+        }
+        else {
+            log::Info("Bundle: {} verified {} assets in {:.2f} ms", verification.BundleName, verification.Assets.size(), elapsed);
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "core/Core.hpp"
+#include "core/MappedFile.hpp"
+#include "services/assetmanager/Asset.hpp"
+
+namespace tlc
+{
+    enum class AssetVerificationMode : U8 {
+        None,            // trust the bundle
+        TableOfContents, // check the header hash of the table of contents when a bundle is mounted
+        Full             // as above, and hash every payload against its record in the background once loaded
+    };
+
+    enum class AssetIntegrity : U8 {
+        Unverified, // not checked (yet)
+        Valid,
+        Corrupted
+    };
+
+    // Verification state of a loaded bundle. Shared with the verifier thread, the
+    // mapping is kept alive by it so unloading a bundle never waits on the hashing.
+    struct AssetBundleVerification {
+        String BundleName = "";
+        Ref<MappedFile> Mapping = nullptr;
+        List<Asset> Assets; // snapshot of the records, same order as the bundle
+        List<std::atomic<AssetIntegrity>> Results;
+        std::atomic<Size> NumCorrupted = 0;
+        std::atomic<Bool> Cancelled = false;
+        std::atomic<Bool> Done = false;
+    };
+
+    // Hashes the payloads of loaded bundles off the main thread, one bundle at a
+    // time with its assets spread over half of the hardware threads, so the
+    // frames rendered meanwhile keep the other half.
+    // Corrupted assets are logged as they are found and marked in the results.
+    class AssetBundleVerifier {
+        public:
+            void Start();
+            void Stop();
+
+            void Enqueue(Ref<AssetBundleVerification> verification);
+            // Blocks until every queued bundle has been verified (or cancelled)
+            void Wait();
+
+        private:
+            void VerifyThread();
+            void Verify(AssetBundleVerification& verification);
+
+        private:
+            std::thread m_Thread;
+            std::mutex m_Mutex;
+            std::condition_variable m_QueueCondition;
+            std::condition_variable m_IdleCondition;
+            std::queue<Ref<AssetBundleVerification>> m_Queue;
+            Bool m_Running = false;
+            Bool m_Busy = false;
+    };
+}
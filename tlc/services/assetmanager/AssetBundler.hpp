@@ -3,6 +3,10 @@
 #include "core/Core.hpp"
 #include "services/Services.hpp"
 #include "services/assetmanager/Asset.hpp"
+#include "services/assetmanager/AssetBundleFormat.hpp"
+#include "services/assetmanager/TextureCooker.hpp"
+#include "services/assetmanager/FontAtlasBaker.hpp"
+#include "services/assetmanager/ShaderPrecompiler.hpp"
 
 namespace tlc 
 {
@@ -15,12 +19,35 @@ namespace tlc
                 const String& path,
                 AssetTags tags,
                 const String& bundleName,
-                const String& address 
+                const String& address,
+                U32 alignment = 0 // 0 picks the alignment from the tags
             );
+            // Bakes every font of the bundle into a single atlas asset at the given address
+            Bool RegisterFontAtlas(const String& bundleName, const String& address, const FontAtlasSettings& settings = FontAtlasSettings());
+            // Shaders are compiled to SPIR-V at pack time (see ShaderModuleHeader), a shader with
+            // keywords gets a module for every variant (see CacheManager::DeclareShaderKeywords)
+            void DeclareShaderKeywords(const String& address, const List<List<String>>& keywordSets);
             Bool RegisterFromDirectory(const String& path, const String& bundleName, const String& addressPrefix = "");
             Bool AssetExists(const String& address); 
             void Pack();
 
+            // Builds the payload Pack() would store for a single source file (cooking it
+            // if needed) without touching any bundle, used for hot reloading assets
+            Bool BuildAssetPayload(const String& path, AssetTags& tags, List<U8>& payload);
+            // Rebakes every atlas the font at the given address is baked into from the
+            // source files on disk without touching any bundle, atlases that fail to bake are left out
+            List<Pair<String, List<U8>>> BuildFontAtlasPayloads(const String& fontAddress);
+
+            // Payload alignment within the bundle, must be a power of two.
+            // An asset uses the largest alignment of all its tags (or the default)
+            // unless it was registered with an explicit one.
+            void SetDefaultAlignment(U32 alignment);
+            void SetTagAlignment(AssetTags tag, U32 alignment);
+
+            // Images are decoded and cooked into GPU ready textures (see CookedTextureHeader)
+            // at pack time, images that fail to cook are stored as is
+            void SetTextureCookSettings(const TextureCookSettings& settings);
+
             
             void OnStart() override;
             void OnEnd() override;
@@ -28,15 +55,29 @@ namespace tlc
             void LogAssets();
 
         private:
-            AssetTags DetectAssetTags(const String& path);
-            void PackBundle(const String& bundleName);
-            void LoadAssets(const String& bundleName);
-            void UnloadAssets(const String& bundleName);
-            void WriteAssetMetadata(std::ofstream& bundleFile, const Asset& asset);
+            void ProcessAsset(Asset& asset);
+            Bool CookAsset(Asset& asset, const List<U8>& source);
+            U32 GetCookFingerprint(const Asset& asset) const;
+            String GetCookedPath(U64 addressHash, const String& extension) const;
+            void BakeFontAtlases(const List<String>& bundleNames, const List<UnorderedMap<String, Asset>>& manifests);
+            void PrecompileShaders(const List<String>& bundleNames, const List<UnorderedMap<String, Asset>>& manifests);
+            Bool PackBundle(const String& bundleName);
+            UnorderedMap<String, Asset> ReadManifest(const String& bundleName);
+            void WriteManifest(const String& bundleName);
+            Bool IsBundleUpToDate(const String& bundleName, const UnorderedMap<String, Asset>& manifest, Bool& manifestOutdated);
+            void LogDeduplicationStats();
+            U32 ResolveAlignment(const Asset& asset) const;
+            AssetBundleRecord CreateAssetRecord(const Asset& asset, U32 addressOffset);
 
         private:
             std::mutex m_Mutex;
             UnorderedMap<String, List<Asset>> m_Assets;
+            UnorderedMap<String, U32> m_AlignmentOverrides;
+            List<Pair<AssetTags, U32>> m_TagAlignments = { { AssetTags::Image, k_DefaultImageAssetAlignment } };
+            U32 m_DefaultAlignment = k_DefaultAssetAlignment;
+            TextureCookSettings m_TextureCookSettings = TextureCookSettings();
+            UnorderedMap<String, FontAtlasSettings> m_FontAtlasSettings;
+            UnorderedMap<String, List<List<String>>> m_ShaderKeywords;
             String m_BundlesPath = "";
     };
 }
\ No newline at end of file
@@ -1,13 +1,29 @@
 #include "services/assetmanager/AssetBundler.hpp"
+#include "services/ShaderCompiler.hpp"
+#include "core/Hash.hpp"
 
 namespace tlc {
 
+    static inline Bool IsValidAlignment(U32 alignment) {
+        return alignment != 0 && (alignment & (alignment - 1)) == 0 && alignment <= k_MaxAssetAlignment;
+    }
+
+    static inline const String& GetPayloadPath(const Asset& asset) {
+        return asset.CookedPath.empty() ? asset.Path : asset.CookedPath;
+    }
+
+    static inline Bool IsShaderStage(AssetTags tags) {
+        return (tags & AssetTags::Shader) == AssetTags::Shader
+            && (tags & (AssetTags::VertexShader | AssetTags::FragmentShader | AssetTags::ComputeShader)) != AssetTags::None;
+    }
+
     void AssetBundler::Setup(const String& bundlesPath) {
         m_BundlesPath = bundlesPath;
     }
 
     void AssetBundler::OnStart() {
         utils::EnsureDirectory(m_BundlesPath);
+        utils::EnsureDirectory(m_BundlesPath + "/cooked");
     }
 
     void AssetBundler::OnEnd() {
@@ -16,11 +32,18 @@ namespace tlc {
 
     Bool AssetBundler::AssetExists(const String& address)
     {       
+        auto id = AssetId(address);
         for (const auto& [_, bundle] : m_Assets) {
             for (const auto& asset : bundle) {
-                if (asset.Address == address) {
-                    return true;
+                if (asset.Id != id) {
+                    continue;
+                }
+
+                // ids have to be unique as the asset manager resolves addresses by id alone
+                if (asset.Address != address) {
+                    log::Error("Asset addresses: {} and {} hash to the same id, rename one of them!", asset.Address, address);
                 }
+                return true;
             }
         }
         return false;
@@ -30,7 +53,8 @@ namespace tlc {
         const String& path,
         AssetTags tags,
         const String& bundleName,
-        const String& address
+        const String& address,
+        U32 alignment
     ) {
         std::lock_guard<std::mutex> lock(m_Mutex);
 
@@ -44,6 +68,15 @@ namespace tlc {
             return false;
         }
 
+        if (alignment != 0 && !IsValidAlignment(alignment)) {
+            log::Warn("Alignment: {} of asset: {} is not a power of two up to {}!", alignment, address, k_MaxAssetAlignment);
+            return false;
+        }
+
+        if (alignment != 0) {
+            m_AlignmentOverrides[address] = alignment;
+        }
+
         auto res = m_Assets.find(bundleName);
         if(res == m_Assets.end()) {
             m_Assets[bundleName] = List<Asset>();
@@ -53,6 +86,7 @@ namespace tlc {
         res->second.emplace_back(Asset{
             .Path = path,
             .Address = address,
+            .Id = AssetId(address),
             .UUID = UUID::New(),
             .Data = nullptr,
             .Offset = 0,
@@ -64,6 +98,180 @@ namespace tlc {
         return true;
     }
 
+    Bool AssetBundler::RegisterFontAtlas(const String& bundleName, const String& address, const FontAtlasSettings& settings)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        if (AssetExists(address)) {
+            log::Warn("An asset with address : {} already exists!", address);
+            return false;
+        }
+
+        auto id = AssetId(address);
+        m_Assets[bundleName].emplace_back(Asset{
+            .Path = GetCookedPath(id.Value, ".fontatlas"),
+            .Address = address,
+            .Id = id,
+            .UUID = UUID::New(),
+            .Tags = AssetTags::FontAtlas,
+        });
+        m_FontAtlasSettings[address] = settings;
+
+        return true;
+    }
+
+    void AssetBundler::DeclareShaderKeywords(const String& address, const List<List<String>>& keywordSets)
+    {
+        auto sets = List<List<String>>();
+        for (const auto& set : keywordSets) {
+            if (!set.empty()) {
+                sets.push_back(set);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_ShaderKeywords[address] = std::move(sets);
+    }
+
+    void AssetBundler::SetDefaultAlignment(U32 alignment)
+    {
+        if (!IsValidAlignment(alignment)) {
+            log::Warn("Default asset alignment: {} is not a power of two up to {}!", alignment, k_MaxAssetAlignment);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_DefaultAlignment = alignment;
+    }
+
+    void AssetBundler::SetTagAlignment(AssetTags tag, U32 alignment)
+    {
+        if (!IsValidAlignment(alignment)) {
+            log::Warn("Alignment: {} for tag: {} is not a power of two up to {}!", alignment, tag, k_MaxAssetAlignment);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        for (auto& [existingTag, existingAlignment] : m_TagAlignments) {
+            if (existingTag == tag) {
+                existingAlignment = alignment;
+                return;
+            }
+        }
+        m_TagAlignments.emplace_back(tag, alignment);
+    }
+
+    void AssetBundler::SetTextureCookSettings(const TextureCookSettings& settings)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_TextureCookSettings = settings;
+    }
+
+    U32 AssetBundler::GetCookFingerprint(const Asset& asset) const
+    {
+        if ((asset.Tags & AssetTags::Image) == AssetTags::Image) {
+            return m_TextureCookSettings.GetFingerprint();
+        }
+        return 0;
+    }
+
+    String AssetBundler::GetCookedPath(U64 addressHash, const String& extension) const
+    {
+        // addresses are unique across bundles, so their hash names the cooked output
+        return m_BundlesPath + "/cooked/" + std::to_string(addressHash) + extension;
+    }
+
+    U32 AssetBundler::ResolveAlignment(const Asset& asset) const
+    {
+        auto alignmentOverride = m_AlignmentOverrides.find(asset.Address);
+        if (alignmentOverride != m_AlignmentOverrides.end()) {
+            return alignmentOverride->second;
+        }
+
+        auto alignment = m_DefaultAlignment;
+        for (const auto& [tag, tagAlignment] : m_TagAlignments) {
+            if ((asset.Tags & tag) == tag) {
+                alignment = std::max(alignment, tagAlignment);
+            }
+        }
+        return alignment;
+    }
+
+    Bool AssetBundler::BuildAssetPayload(const String& path, AssetTags& tags, List<U8>& payload)
+    {
+        if (!utils::PathExists(path)) {
+            log::Warn("Asset not found at path: {}!", path);
+            return false;
+        }
+
+        auto cookSettings = TextureCookSettings();
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            cookSettings = m_TextureCookSettings;
+        }
+
+        auto source = utils::ReadBinaryFile(path);
+        tags = tags & ~AssetTags::Texture;
+        if ((tags & AssetTags::Image) == AssetTags::Image && cookSettings.enabled) {
+            if (CookTexture(source.data(), source.size(), cookSettings, payload)) {
+                tags = tags | AssetTags::Texture;
+                return true;
+            }
+            log::Warn("Image: {} could not be cooked, using the source file instead", path);
+        }
+
+        payload = std::move(source);
+        return true;
+    }
+
+    // Every font of a bundle is baked into each of its atlases, sorted so the atlas layout is stable
+    static List<FontAtlasSource> GetFontAtlasSources(const List<Asset>& assets)
+    {
+        auto sources = List<FontAtlasSource>();
+        for (const auto& asset : assets) {
+            if ((asset.Tags & AssetTags::Font) == AssetTags::Font) {
+                sources.push_back({ asset.Address, asset.Path });
+            }
+        }
+        std::sort(sources.begin(), sources.end(), [](const FontAtlasSource& a, const FontAtlasSource& b) {
+            return a.Name < b.Name;
+        });
+        return sources;
+    }
+
+    List<Pair<String, List<U8>>> AssetBundler::BuildFontAtlasPayloads(const String& fontAddress)
+    {
+        auto jobs = List<std::tuple<String, FontAtlasSettings, List<FontAtlasSource>>>();
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            for (const auto& [_, assets] : m_Assets) {
+                auto isFontOfBundle = std::any_of(assets.begin(), assets.end(), [&fontAddress](const Asset& asset) {
+                    return asset.Address == fontAddress && (asset.Tags & AssetTags::Font) == AssetTags::Font;
+                });
+                if (!isFontOfBundle) {
+                    continue;
+                }
+
+                for (const auto& atlas : assets) {
+                    if ((atlas.Tags & AssetTags::FontAtlas) == AssetTags::FontAtlas) {
+                        jobs.emplace_back(atlas.Address, m_FontAtlasSettings[atlas.Address], GetFontAtlasSources(assets));
+                    }
+                }
+            }
+        }
+
+        auto atlases = List<Pair<String, List<U8>>>();
+        for (const auto& [atlasAddress, settings, sources] : jobs) {
+            auto baked = List<U8>();
+            if (!BakeFontAtlas(sources, settings, baked)) {
+                log::Error("Failed to bake font atlas: {}, skipping it", atlasAddress);
+                continue;
+            }
+            atlases.emplace_back(atlasAddress, std::move(baked));
+        }
+        return atlases;
+    }
+
     void AssetBundler::LogAssets()
     {
         std::lock_guard<std::mutex> lock(m_Mutex);
@@ -103,154 +311,747 @@ namespace tlc {
         return true;
     }
 
-    AssetTags AssetBundler::DetectAssetTags(const String& path) {
-        auto tags = AssetTags::None;
-
-        if (path.ends_with(".png") || path.ends_with(".jpg") || path.ends_with(".jpeg")) {
-            tags = tags | AssetTags::Image;
+    static Bool SourceFilesEqual(const String& pathA, const String& pathB)
+    {
+        if (pathA == pathB) {
+            return true;
         }
-        else if (path.ends_with(".wav") || path.ends_with(".mp3") || path.ends_with(".ogg")) {
-            tags = tags | AssetTags::Audio;
+
+        std::ifstream fileA(pathA, std::ios::binary);
+        std::ifstream fileB(pathB, std::ios::binary);
+        if (!fileA.is_open() || !fileB.is_open()) {
+            return false;
         }
-        else if (path.ends_with(".ttf") || path.ends_with(".otf")) {
-            tags = tags | AssetTags::Font;
+
+        static constexpr Size k_CompareChunkSize = 64 * 1024;
+        auto bufferA = List<char>(k_CompareChunkSize);
+        auto bufferB = List<char>(k_CompareChunkSize);
+        while (fileA && fileB) {
+            fileA.read(bufferA.data(), k_CompareChunkSize);
+            fileB.read(bufferB.data(), k_CompareChunkSize);
+            if (fileA.gcount() != fileB.gcount() || std::memcmp(bufferA.data(), bufferB.data(), fileA.gcount()) != 0) {
+                return false;
+            }
         }
-        else if (path.ends_with(".glsl")) {
-            tags = tags | AssetTags::Shader;
-            if (path.find("vert.glsl") != String::npos) {
-                tags = tags | AssetTags::VertexShader;
+        return fileA.eof() && fileB.eof();
+    }
+
+    void AssetBundler::LogDeduplicationStats()
+    {
+        // payloads that would be stored once if bundles shared a blob store
+        auto logicalSize = Size(0);
+        auto bundleUniqueSize = Size(0);
+        auto globalUniqueSize = Size(0);
+        auto globalPayloads = Set<Pair<U64, Size>>();
+        for (const auto& [_, assets] : m_Assets) {
+            auto bundlePayloads = Set<Pair<U64, Size>>();
+            for (const auto& asset : assets) {
+                logicalSize += asset.Size;
+                if (bundlePayloads.insert({ asset.Hash, asset.Size }).second) {
+                    bundleUniqueSize += asset.Size;
+                }
+                if (globalPayloads.insert({ asset.Hash, asset.Size }).second) {
+                    globalUniqueSize += asset.Size;
+                }
             }
-            else if (path.find("frag.glsl") != String::npos) {
-                tags = tags | AssetTags::FragmentShader;
+        }
+
+        if (bundleUniqueSize > globalUniqueSize) {
+            log::Info("{} bytes of payloads are duplicated across bundles", bundleUniqueSize - globalUniqueSize);
+        }
+        log::Info("Asset deduplication: {} bytes of assets stored as {} bytes (dedup ratio {:.2f})",
+            logicalSize, bundleUniqueSize,
+            bundleUniqueSize > 0 ? static_cast<F64>(logicalSize) / static_cast<F64>(bundleUniqueSize) : 1.0
+        );
+    }
+
+    void AssetBundler::ProcessAsset(Asset& asset)
+    {
+        asset.CookedPath = "";
+
+        std::ifstream assetFile(asset.Path, std::ios::binary);
+        if (!assetFile.is_open()) {
+            log::Warn("Failed to open asset file: {}", asset.Path);
+            asset.SourceSize = asset.Size = 0;
+            asset.SourceHash = asset.Hash = 0;
+            return;
+        }
+
+        // files stored as is are hashed while they are read, only cooked ones are needed in memory
+        if (asset.CookFingerprint == 0) {
+            assetFile.close();
+            auto size = Size(0);
+            asset.SourceHash = asset.Hash = utils::HashFile(asset.Path, &size);
+            asset.SourceSize = asset.Size = size;
+            return;
+        }
+
+        auto data = List<U8>(asset.SourceSize);
+        assetFile.read(reinterpret_cast<char*>(data.data()), data.size());
+        data.resize(static_cast<Size>(assetFile.gcount()));
+        assetFile.close();
+
+        asset.SourceSize = asset.Size = data.size();
+        asset.SourceHash = asset.Hash = utils::HashBuffer(data);
+        CookAsset(asset, data);
+    }
+
+    Bool AssetBundler::CookAsset(Asset& asset, const List<U8>& source)
+    {
+        auto cooked = List<U8>();
+        if (!CookTexture(source.data(), source.size(), m_TextureCookSettings, cooked)) {
+            log::Warn("Image: {} could not be cooked, storing the source file instead", asset.Path);
+            return false;
+        }
+
+        auto cookedPath = GetCookedPath(asset.Id.Value, ".texture");
+        std::ofstream cookedFile(cookedPath, std::ios::binary);
+        cookedFile.write(reinterpret_cast<const char*>(cooked.data()), cooked.size());
+        cookedFile.close();
+        if (!cookedFile) {
+            log::Error("Failed to write cooked texture: {}", cookedPath);
+            return false;
+        }
+
+        const auto header = reinterpret_cast<const CookedTextureHeader*>(cooked.data());
+        log::Trace("Cooked image: {} | {}x{} | {} mips | {} bytes -> {} bytes", asset.Path, header->Width, header->Height, header->MipCount, source.size(), cooked.size());
+
+        asset.CookedPath = cookedPath;
+        asset.Size = cooked.size();
+        asset.Hash = utils::HashBuffer(cooked);
+        asset.Tags = asset.Tags | AssetTags::Texture;
+        return true;
+    }
+
+    void AssetBundler::BakeFontAtlases(const List<String>& bundleNames, const List<UnorderedMap<String, Asset>>& manifests)
+    {
+        for (Size i = 0; i < bundleNames.size(); i++) {
+            auto& assets = m_Assets[bundleNames[i]];
+            auto failedAtlases = Set<String>();
+            for (auto& atlas : assets) {
+                if ((atlas.Tags & AssetTags::FontAtlas) != AssetTags::FontAtlas) {
+                    continue;
+                }
+
+                const auto& settings = m_FontAtlasSettings[atlas.Address];
+                auto sources = GetFontAtlasSources(assets);
+
+                // the atlas is rebaked whenever the settings or any font of the bundle change
+                auto fingerprint = Hasher();
+                fingerprint.UpdateValue(settings.GetFingerprint());
+                for (const auto& source : sources) {
+                    const auto& font = *std::find_if(assets.begin(), assets.end(), [&source](const Asset& asset) { return asset.Address == source.Name; });
+                    fingerprint.UpdateValue(font.Id.Value);
+                    fingerprint.UpdateValue(font.SourceHash);
+                }
+
+                atlas.Alignment = ResolveAlignment(atlas);
+                atlas.SourceHash = fingerprint.Digest();
+                atlas.CookFingerprint = settings.GetFingerprint();
+                atlas.CookedPath = atlas.Path;
+
+                auto entry = manifests[i].find(atlas.Address);
+                if (entry != manifests[i].end()) {
+                    const auto& previous = entry->second;
+                    atlas.UUID = previous.UUID;
+                    if (previous.SourceHash == atlas.SourceHash && utils::PathExists(atlas.Path) && utils::GetFileSize(atlas.Path) == previous.Size) {
+                        atlas.ModifiedTime = previous.ModifiedTime;
+                        atlas.SourceSize = previous.SourceSize;
+                        atlas.Size = previous.Size;
+                        atlas.Hash = previous.Hash;
+                        continue;
+                    }
+                }
+
+                // a stale atlas must not be packed in place of one that failed to bake
+                utils::RemoveFile(atlas.Path);
+
+                auto baked = List<U8>();
+                if (!BakeFontAtlas(sources, settings, baked)) {
+                    log::Error("Failed to bake font atlas: {}, skipping it", atlas.Address);
+                    failedAtlases.insert(atlas.Address);
+                    continue;
+                }
+
+                std::ofstream atlasFile(atlas.Path, std::ios::binary);
+                atlasFile.write(reinterpret_cast<const char*>(baked.data()), baked.size());
+                atlasFile.close();
+                if (!atlasFile) {
+                    log::Error("Failed to write font atlas: {}, skipping it", atlas.Path);
+                    utils::RemoveFile(atlas.Path);
+                    failedAtlases.insert(atlas.Address);
+                    continue;
+                }
+
+                atlas.ModifiedTime = utils::GetFileModifiedTime(atlas.Path);
+                atlas.SourceSize = atlas.Size = baked.size();
+                atlas.Hash = utils::HashBuffer(baked);
             }
-            else if (path.find("comp.glsl") != String::npos) {
-                tags = tags | AssetTags::ComputeShader;
+
+            // atlases that failed to bake are left out of the bundle, they have to be registered again
+            std::erase_if(assets, [&failedAtlases](const Asset& asset) {
+                return failedAtlases.contains(asset.Address);
+            });
+            for (const auto& address : failedAtlases) {
+                m_FontAtlasSettings.erase(address);
             }
         }
-        return tags;
     }
 
-    void AssetBundler::LoadAssets(const String& bundleName) 
+    // The module packed last time can be kept if it was compiled the same way from the same sources,
+    // a compiler version of 0 accepts modules of any compiler (builds without one can not do better)
+    static Bool ReusePackedShaderModule(Asset& module, const Asset& previous, U64 compilerVersion, U64 optionsHash, const std::function<U64(const String&)>& getPayloadHash)
     {
-        auto bundle = m_Assets.find(bundleName);
-        if(bundle == m_Assets.end()) {
-            log::Warn("Bundle: {} not found!", bundleName);
-            return;
+        if (!utils::PathExists(module.Path) || utils::GetFileSize(module.Path) != previous.Size) {
+            return false;
         }
 
-        auto& assets = bundle->second;
+        auto data = utils::ReadBinaryFile(module.Path);
+        auto header = Raw<const ShaderModuleHeader>(nullptr);
+        auto stringTable = Raw<const char>(nullptr);
+        if (!ReadShaderModule(data.data(), data.size(), header, stringTable)) {
+            return false;
+        }
 
-        for (auto& asset : assets) {
-            asset.Data = nullptr;
-            asset.Size = 0;
+        if (compilerVersion != 0 && (header->CompilerVersion != compilerVersion || header->OptionsHash != optionsHash)) {
+            return false;
+        }
 
-            std::ifstream assetFile(asset.Path, std::ios::binary);
-            if (!assetFile.is_open()) {
-                log::Warn("Failed to open asset file: {}", asset.Path);
-                continue;                
+        auto sources = GetShaderModuleSources(*header, stringTable);
+        if (GetShaderModuleSourceHash(sources.Address, sources.Includes, getPayloadHash) != header->SourceHash) {
+            return false;
+        }
+
+        module.ModifiedTime = previous.ModifiedTime;
+        module.SourceSize = previous.SourceSize;
+        module.SourceHash = header->SourceHash;
+        module.Size = previous.Size;
+        module.Hash = previous.Hash;
+        return true;
+    }
+
+    void AssetBundler::PrecompileShaders(const List<String>& bundleNames, const List<UnorderedMap<String, Asset>>& manifests)
+    {
+        // shaders may include files of any bundle, the includes are resolved by address
+        auto registered = UnorderedMap<String, Raw<const Asset>>();
+        for (const auto& [_, assets] : m_Assets) {
+            for (const auto& asset : assets) {
+                registered[asset.Address] = &asset;
             }
+        }
+        auto getPayloadHash = [&registered](const String& address) {
+            auto asset = registered.find(address);
+            return asset != registered.end() ? asset->second->Hash : U64(0);
+        };
+
+        auto compilerVersion = U64(0);
+        auto optionsHash = U64(0);
+#ifdef TLC_ENABLE_SHADER_COMPILER
+        auto shaderCompiler = Services::Get<ShaderCompiler>();
+        auto options = shaderCompiler ? shaderCompiler->GetOptions() : nullptr;
+        if (shaderCompiler) {
+            compilerVersion = ShaderCompiler::GetCompilerVersion();
+            optionsHash = options->Hash();
+        }
+#endif
 
-            // get the size of the file
-            assetFile.seekg(0, std::ios::end);
-            asset.Size = assetFile.tellg();
-            assetFile.seekg(0, std::ios::beg);
+        // the modules are added to the bundles once every shader is done, the registered assets are pointed to until then
+        auto modules = List<List<Asset>>(bundleNames.size());
+        auto pendingBundles = List<Size>();
+        auto pendingModules = List<Asset>();
+        auto pendingShaders = List<Raw<const Asset>>();
+        auto pendingKeywords = List<List<String>>();
+        for (Size i = 0; i < bundleNames.size(); i++) {
+            for (const auto& shader : m_Assets[bundleNames[i]]) {
+                if (!IsShaderStage(shader.Tags)) {
+                    continue;
+                }
 
-            // allocate memory for the asset
-            asset.Data = new U8[asset.Size];
-            assetFile.read(reinterpret_cast<char*>(asset.Data), asset.Size);
-            assetFile.close();
+                auto variants = List<List<String>>{ {} };
+                if (auto declared = m_ShaderKeywords.find(shader.Address); declared != m_ShaderKeywords.end()) {
+                    variants = GetShaderKeywordVariants(declared->second);
+                }
+
+                for (auto& keywords : variants) {
+                    auto address = GetShaderModuleAddress(GetShaderVariantKey(shader.Address, keywords));
+                    if (registered.contains(address)) {
+                        log::Error("Asset: {} takes the address of the pre-built module of shader: {}, the shader is packed without it", address, shader.Address);
+                        continue;
+                    }
 
-            // calculate the hash of the asset
-            asset.Hash = utils::HashBuffer(asset.Data, asset.Size);
+                    auto id = AssetId(address);
+                    auto module = Asset{
+                        .Path = GetCookedPath(id.Value, ".spv"),
+                        .Address = address,
+                        .Id = id,
+                        .UUID = UUID::New(),
+                        .Tags = AssetTags::ShaderModule,
+                    };
+                    module.CookedPath = module.Path;
+                    module.CookFingerprint = k_ShaderModuleVersion;
+                    module.Alignment = ResolveAlignment(module);
+
+                    auto entry = manifests[i].find(address);
+                    if (entry != manifests[i].end()) {
+                        module.UUID = entry->second.UUID;
+                        if (ReusePackedShaderModule(module, entry->second, compilerVersion, optionsHash, getPayloadHash)) {
+                            modules[i].push_back(std::move(module));
+                            continue;
+                        }
+                    }
+
+                    pendingBundles.push_back(i);
+                    pendingModules.push_back(std::move(module));
+                    pendingShaders.push_back(&shader);
+                    pendingKeywords.push_back(std::move(keywords));
+                }
+            }
+        }
+
+#ifdef TLC_ENABLE_SHADER_COMPILER
+        if (!pendingModules.empty() && !shaderCompiler) {
+            log::Error("AssetBundler::PrecompileShaders: ShaderCompiler service not found, {} shaders are packed without pre-built modules", pendingModules.size());
+        }
+        else if (!pendingModules.empty()) {
+            // the bundles are being packed, so the sources are read from the registered files
+            auto loadedMutex = std::mutex();
+            auto loaded = UnorderedMap<String, PinnedData>();
+            auto loader = ShaderCompiler::IncludeLoader([&](const String& address) {
+                std::lock_guard<std::mutex> lock(loadedMutex);
+                if (auto source = loaded.find(address); source != loaded.end()) {
+                    return source->second;
+                }
+
+                auto data = PinnedData();
+                if (auto asset = registered.find(address); asset != registered.end()) {
+                    auto content = CreateRef<List<U8>>(utils::ReadBinaryFile(asset->second->Path));
+                    data = PinnedData(content, content->data(), content->size());
+                }
+                return loaded[address] = data;
+            });
+
+            auto sources = List<PinnedData>();
+            auto requests = List<ShaderCompiler::CompileRequest>();
+            for (Size i = 0; i < pendingModules.size(); i++) {
+                const auto& shader = *pendingShaders[i];
+                sources.push_back(loader(shader.Address));
+                requests.push_back({ sources.back().AsString(), *ShaderCompiler::GetShaderType(shader.Tags), shader.Address, GetShaderKeywordMacros(pendingKeywords[i]) });
+            }
+
+            auto startTime = std::chrono::steady_clock::now();
+            auto includes = List<List<String>>();
+            auto results = shaderCompiler->CompileAll(requests, options, loader, &includes);
+            auto elapsed = std::chrono::duration<F64, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+            log::Info("Precompiled {} shaders in {:.2f} ms", requests.size(), elapsed);
+
+            for (Size i = 0; i < results.size(); i++) {
+                auto& module = pendingModules[i];
+                const auto& shader = *pendingShaders[i];
+                auto moduleSources = ShaderModuleSources{
+                    .Address = shader.Address,
+                    .Includes = std::move(includes[i]),
+                    .CompilerVersion = compilerVersion,
+                    .OptionsHash = optionsHash,
+                };
+                moduleSources.SourceHash = GetShaderModuleSourceHash(moduleSources.Address, moduleSources.Includes, getPayloadHash);
+
+                // the runtime compiles shaders without a module itself (if it can)
+                auto payload = List<U8>();
+                if (results[i].empty() || !BuildShaderModule(results[i], moduleSources, payload)) {
+                    log::Error("Failed to precompile shader: {}, it is packed without a pre-built module", module.Address);
+                    continue;
+                }
+
+                std::ofstream moduleFile(module.Path, std::ios::binary);
+                moduleFile.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+                moduleFile.close();
+                if (!moduleFile) {
+                    log::Error("Failed to write shader module: {}", module.Path);
+                    continue;
+                }
+
+                module.ModifiedTime = utils::GetFileModifiedTime(module.Path);
+                module.SourceSize = module.Size = payload.size();
+                module.SourceHash = moduleSources.SourceHash;
+                module.Hash = utils::HashBuffer(payload);
+                modules[pendingBundles[i]].push_back(std::move(module));
+            }
+        }
+#else
+        if (!pendingModules.empty()) {
+            log::Warn("{} shader modules are out of date and this build cannot compile shaders, their shaders are packed without them", pendingModules.size());
+        }
+#endif
+
+        for (Size i = 0; i < bundleNames.size(); i++) {
+            auto& assets = m_Assets[bundleNames[i]];
+            assets.insert(assets.end(), std::make_move_iterator(modules[i].begin()), std::make_move_iterator(modules[i].end()));
         }
     }
 
-    void AssetBundler::UnloadAssets(const String& bundleName)
+    UnorderedMap<String, Asset> AssetBundler::ReadManifest(const String& bundleName)
     {
-        auto bundle = m_Assets.find(bundleName);
-        if(bundle == m_Assets.end()) {
-            log::Warn("Bundle: {} not found!", bundleName);
+        auto result = UnorderedMap<String, Asset>();
+        auto manifestPath = m_BundlesPath + "/" + bundleName + ".manifest";
+        if (!utils::PathExists(manifestPath)) {
+            return result;
+        }
+
+        std::ifstream manifestFile(manifestPath, std::ios::binary);
+        if (!manifestFile.is_open()) {
+            log::Warn("Failed to open manifest file: {}", manifestPath);
+            return result;
+        }
+
+        auto header = AssetManifestHeader();
+        manifestFile.read(reinterpret_cast<char*>(&header), sizeof(AssetManifestHeader));
+        if (!manifestFile || header.Magic != k_AssetManifestMagic || header.Version != k_AssetManifestVersion || header.BundleVersion != k_AssetBundleVersion) {
+            log::Info("Manifest: {} is outdated, bundle: {} will be repacked", manifestPath, bundleName);
+            return result;
+        }
+
+        for (U32 i = 0; i < header.EntryCount; i++) {
+            auto record = AssetManifestRecord();
+            manifestFile.read(reinterpret_cast<char*>(&record), sizeof(AssetManifestRecord));
+
+            auto asset = Asset();
+            asset.Path.resize(record.PathLength);
+            asset.Address.resize(record.AddressLength);
+            manifestFile.read(asset.Path.data(), record.PathLength);
+            manifestFile.read(asset.Address.data(), record.AddressLength);
+            if (!manifestFile) {
+                log::Warn("Manifest: {} is truncated, bundle: {} will be repacked", manifestPath, bundleName);
+                return {};
+            }
+
+            asset.UUID = UUID::FromBytes(record.UUID);
+            asset.SourceSize = record.SourceSize;
+            asset.Size = record.Size;
+            asset.Tags = static_cast<AssetTags>(record.Tags);
+            asset.SourceHash = record.SourceHash;
+            asset.Hash = record.Hash;
+            asset.CookFingerprint = record.CookFingerprint;
+            asset.ModifiedTime = record.ModifiedTime;
+            asset.Alignment = record.Alignment;
+            result[asset.Address] = std::move(asset);
+        }
+
+        return result;
+    }
+
+    void AssetBundler::WriteManifest(const String& bundleName)
+    {
+        auto manifestPath = m_BundlesPath + "/" + bundleName + ".manifest";
+        const auto& assets = m_Assets.at(bundleName);
+
+        std::ofstream manifestFile(manifestPath, std::ios::binary);
+        if (!manifestFile.is_open()) {
+            log::Error("Failed to create manifest file: {}", manifestPath);
             return;
         }
 
-        auto& assets = bundle->second;
+        auto header = AssetManifestHeader();
+        header.EntryCount = static_cast<U32>(assets.size());
+        manifestFile.write(reinterpret_cast<const char*>(&header), sizeof(AssetManifestHeader));
+
+        for (const auto& asset : assets) {
+            auto record = AssetManifestRecord();
+            record.ModifiedTime = asset.ModifiedTime;
+            record.SourceSize = asset.SourceSize;
+            record.Size = asset.Size;
+            record.Tags = static_cast<U32>(asset.Tags);
+            record.SourceHash = asset.SourceHash;
+            record.Hash = asset.Hash;
+            record.CookFingerprint = asset.CookFingerprint;
+            record.PathLength = static_cast<U32>(asset.Path.size());
+            record.AddressLength = static_cast<U32>(asset.Address.size());
+            record.Alignment = asset.Alignment;
+            std::memcpy(record.UUID, asset.UUID.ToBytes(), sizeof(record.UUID));
+
+            manifestFile.write(reinterpret_cast<const char*>(&record), sizeof(AssetManifestRecord));
+            manifestFile.write(asset.Path.data(), asset.Path.size());
+            manifestFile.write(asset.Address.data(), asset.Address.size());
+        }
+    }
+
+    Bool AssetBundler::IsBundleUpToDate(const String& bundleName, const UnorderedMap<String, Asset>& manifest, Bool& manifestOutdated)
+    {
+        manifestOutdated = true;
 
-        for (auto& asset : assets) {
-            if (asset.Data != nullptr) {
-                delete[] asset.Data;
-                asset.Data = nullptr;
-                asset.Size = 0;
+        const auto& assets = m_Assets.at(bundleName);
+        if (!utils::PathExists(m_BundlesPath + "/" + bundleName + ".bundle") || manifest.size() != assets.size()) {
+            return false;
+        }
+
+        manifestOutdated = false;
+        for (const auto& asset : assets) {
+            auto entry = manifest.find(asset.Address);
+            if (entry == manifest.end()) {
+                return false;
             }
+
+            const auto& previous = entry->second;
+            if (previous.Path != asset.Path || previous.Tags != asset.Tags || previous.Size != asset.Size || previous.Hash != asset.Hash || previous.Alignment != asset.Alignment) {
+                return false;
+            }
+
+            // touched but identical files do not need a repack, only a manifest refresh
+            manifestOutdated |= previous.ModifiedTime != asset.ModifiedTime;
         }
+
+        return true;
     }
 
-    void AssetBundler::WriteAssetMetadata(std::ofstream& bundleFile, const Asset& asset)
+    AssetBundleRecord AssetBundler::CreateAssetRecord(const Asset& asset, U32 addressOffset)
     {
-        // write the uuid
-        bundleFile.write(reinterpret_cast<const char*>(&asset.UUID), sizeof(UUID));
-        // write the size
-        bundleFile.write(reinterpret_cast<const char*>(&asset.Size), sizeof(Size));
-        // write the offset
-        bundleFile.write(reinterpret_cast<const char*>(&asset.Offset), sizeof(Size));
-        // write the tags
-        bundleFile.write(reinterpret_cast<const char*>(&asset.Tags), sizeof(AssetTags));
-        // write the hash
-        bundleFile.write(reinterpret_cast<const char*>(&asset.Hash), sizeof(U32));
-        // write the address [max 1024 bytes]
-        static char address[1024];
-        std::snprintf(address, 1024, "%s", asset.Address.c_str());
-        bundleFile.write(address, 1024);
-    }
-
-    void AssetBundler::PackBundle(const String& bundleName)
+        auto record = AssetBundleRecord();
+        record.AddressHash = asset.Id.Value;
+        record.Offset = asset.Offset;
+        record.Size = asset.Size;
+        record.Tags = static_cast<U32>(asset.Tags);
+        record.Hash = asset.Hash;
+        record.AddressOffset = addressOffset;
+        record.AddressLength = static_cast<U32>(asset.Address.size());
+        record.Alignment = asset.Alignment;
+        std::memcpy(record.UUID, asset.UUID.ToBytes(), sizeof(record.UUID));
+        return record;
+    }
+
+    Bool AssetBundler::PackBundle(const String& bundleName)
     {
+        // bundles are written next to the target and renamed over it once complete,
+        // so a bundle that is currently mapped is never truncated underneath its reader
         auto bundlePath = m_BundlesPath + "/" + bundleName + ".bundle"; 
+        auto temporaryPath = bundlePath + ".tmp";
         auto bundle = m_Assets.find(bundleName);
         if(bundle == m_Assets.end()) {
             log::Warn("Bundle: {} not found!", bundleName);
-            return;
+            return false;
         }
 
         auto& assets = bundle->second;
 
         // create the bundle file
-        std::ofstream bundleFile(bundlePath, std::ios::binary);
+        std::ofstream bundleFile(temporaryPath, std::ios::binary);
         if (!bundleFile.is_open()) {
-            log::Error("Failed to create bundle file: {}", bundlePath);
-            return;
+            log::Error("Failed to create bundle file: {}", temporaryPath);
+            return false;
+        }
+
+        // the table of contents is sorted by address hash so that it can be binary searched on load
+        auto order = List<Size>(assets.size());
+        for (Size i = 0; i < assets.size(); i++) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&assets](Size a, Size b) {
+            return assets[a].Id.Value < assets[b].Id.Value;
+        });
+
+        // build the string table
+        auto stringTable = String();
+        auto addressOffsets = List<U32>(assets.size());
+        for (auto index : order) {
+            addressOffsets[index] = static_cast<U32>(stringTable.size());
+            stringTable.append(assets[index].Address);
+            stringTable.push_back('\0');
         }
 
-        // write the number of assets in the bundle
-        U32 numAssets = static_cast<U32>(assets.size());
-        bundleFile.write(reinterpret_cast<const char*>(&numAssets), sizeof(U32));
+        auto header = AssetBundleHeader();
+        header.AssetCount = static_cast<U32>(assets.size());
+        header.StringTableSize = static_cast<U32>(stringTable.size());
+        header.TableOfContentsSize = assets.size() * sizeof(AssetBundleRecord) + stringTable.size();
+        header.DataOffset = sizeof(AssetBundleHeader) + header.TableOfContentsSize;
 
-        LoadAssets(bundleName);
+        // sizes and hashes are already known, so the layout can be fixed before any data is read.
+        // identical payloads are stored once and shared by every record that refers to them
+        auto offset = header.DataOffset;
+        auto payloads = UnorderedMap<U64, List<Size>>();
+        auto isStored = List<Bool>(assets.size(), false);
+        auto numShared = Size(0);
+        for (Size i = 0; i < assets.size(); i++) {
+            auto& asset = assets[i];
+            auto& candidates = payloads[asset.Hash ^ asset.Size];
 
-        auto offset = sizeof(U32) + numAssets * (sizeof(UUID) + sizeof(Size) + sizeof(Size) + sizeof(AssetTags) + sizeof(U32) + 1024);
+            auto shared = false;
+            for (auto candidate : candidates) {
+                const auto& stored = assets[candidate];
+                if (stored.Hash == asset.Hash && stored.Size == asset.Size && (stored.Offset % asset.Alignment) == 0 && SourceFilesEqual(GetPayloadPath(stored), GetPayloadPath(asset))) {
+                    asset.Offset = stored.Offset;
+                    shared = true;
+                    break;
+                }
+            }
 
-        // write the asset metadata
-        for (auto& asset : assets) {
-            asset.Offset = offset;
-            offset += asset.Size;
+            if (shared) {
+                numShared++;
+                continue;
+            }
 
-            WriteAssetMetadata(bundleFile, asset);
+            asset.Offset = AlignAssetOffset(offset, asset.Alignment);
+            offset = asset.Offset + asset.Size;
+            isStored[i] = true;
+            candidates.push_back(i);
         }
 
-        // write the asset data
-        for (const auto& asset : assets) {
-            bundleFile.write(reinterpret_cast<const char*>(asset.Data), asset.Size);
+        auto records = List<AssetBundleRecord>();
+        records.reserve(assets.size());
+        for (auto index : order) {
+            records.emplace_back(CreateAssetRecord(assets[index], addressOffsets[index]));
         }
 
-        UnloadAssets(bundleName);
+        // write the table of contents
+        auto tableOfContentsHasher = Hasher();
+        tableOfContentsHasher.Update(records.data(), records.size() * sizeof(AssetBundleRecord));
+        tableOfContentsHasher.Update(stringTable.data(), stringTable.size());
+        header.TableOfContentsHash = tableOfContentsHasher.Digest();
+        bundleFile.write(reinterpret_cast<const char*>(&header), sizeof(AssetBundleHeader));
+        bundleFile.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(AssetBundleRecord));
+        bundleFile.write(stringTable.data(), stringTable.size());
+
+        // stream the asset data through a fixed size buffer
+        static constexpr Size k_CopyChunkSize = 1024 * 1024;
+        static const char k_Padding[k_MaxAssetAlignment] = {};
+        auto buffer = List<char>(k_CopyChunkSize);
+        auto position = static_cast<U64>(header.DataOffset);
+        for (Size i = 0; i < assets.size(); i++) {
+            if (!isStored[i]) {
+                continue;
+            }
+
+            const auto& asset = assets[i];
+            bundleFile.write(k_Padding, asset.Offset - position);
+            position = asset.Offset + asset.Size;
+
+            std::ifstream assetFile(GetPayloadPath(asset), std::ios::binary);
+            auto remaining = asset.Size;
+            while (remaining > 0 && assetFile) {
+                assetFile.read(buffer.data(), std::min(remaining, k_CopyChunkSize));
+                auto bytesRead = static_cast<Size>(assetFile.gcount());
+                bundleFile.write(buffer.data(), bytesRead);
+                remaining -= bytesRead;
+            }
+
+            if (remaining > 0) {
+                // keep the layout intact, the asset will fail its hash check
+                log::Error("Asset: {} changed while packing bundle: {}", asset.Path, bundleName);
+                std::fill(buffer.begin(), buffer.end(), 0);
+                while (remaining > 0) {
+                    auto padding = std::min(remaining, k_CopyChunkSize);
+                    bundleFile.write(buffer.data(), padding);
+                    remaining -= padding;
+                }
+            }
+        }
 
         bundleFile.close();
+        if (!bundleFile) {
+            log::Error("Failed to write bundle file: {}", temporaryPath);
+            utils::RemoveFile(temporaryPath);
+            return false;
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temporaryPath, bundlePath, error);
+        if (error) {
+            log::Error("Failed to replace bundle file: {} ({})", bundlePath, error.message());
+            utils::RemoveFile(temporaryPath);
+            return false;
+        }
+
+        auto logicalSize = Size(0);
+        for (const auto& asset : assets) {
+            logicalSize += asset.Size;
+        }
+        auto storedSize = offset - header.DataOffset;
+        log::Info("Bundle: {} | {} assets share {} payloads | {} bytes stored for {} bytes of assets (dedup ratio {:.2f})",
+            bundleName, assets.size(), assets.size() - numShared, storedSize, logicalSize,
+            storedSize > 0 ? static_cast<F64>(logicalSize) / static_cast<F64>(storedSize) : 1.0
+        );
+
+        return true;
     }
 
     void AssetBundler::Pack() 
     {
         std::lock_guard<std::mutex> lock(m_Mutex);
-        for (const auto& [bundleName, bundle] : m_Assets) {
-            PackBundle(bundleName);
+
+        // shader modules are generated by every pack, from the shaders registered by then
+        auto bundleNames = List<String>();
+        for (auto& [bundleName, assets] : m_Assets) {
+            bundleNames.emplace_back(bundleName);
+            std::erase_if(assets, [](const Asset& asset) {
+                return (asset.Tags & AssetTags::ShaderModule) == AssetTags::ShaderModule;
+            });
         }
+
+        // refresh the source file state, reusing the manifest hash and cooked output for untouched files
+        auto manifests = List<UnorderedMap<String, Asset>>(bundleNames.size());
+        auto dirtyAssets = List<Raw<Asset>>();
+        for (Size i = 0; i < bundleNames.size(); i++) {
+            manifests[i] = ReadManifest(bundleNames[i]);
+            for (auto& asset : m_Assets[bundleNames[i]]) {
+                if ((asset.Tags & AssetTags::FontAtlas) == AssetTags::FontAtlas) {
+                    continue; // baked once the fonts it depends on are processed
+                }
+
+                asset.Tags = asset.Tags & ~AssetTags::Texture;
+                asset.Alignment = ResolveAlignment(asset);
+                asset.ModifiedTime = utils::GetFileModifiedTime(asset.Path);
+                asset.SourceSize = utils::GetFileSize(asset.Path);
+                asset.CookFingerprint = GetCookFingerprint(asset);
+
+                auto entry = manifests[i].find(asset.Address);
+                if (entry != manifests[i].end()) {
+                    const auto& previous = entry->second;
+                    asset.UUID = previous.UUID; // keep UUIDs stable across repacks
+
+                    auto isCooked = (previous.Tags & AssetTags::Texture) == AssetTags::Texture;
+                    auto cookedPath = isCooked ? GetCookedPath(asset.Id.Value, ".texture") : String();
+                    auto sourceUnchanged = previous.Path == asset.Path && previous.ModifiedTime == asset.ModifiedTime && previous.SourceSize == asset.SourceSize;
+                    auto cookUnchanged = previous.CookFingerprint == asset.CookFingerprint && (previous.Tags & ~AssetTags::Texture) == asset.Tags;
+                    auto cookedOutputIntact = !isCooked || (utils::PathExists(cookedPath) && utils::GetFileSize(cookedPath) == previous.Size);
+                    if (sourceUnchanged && cookUnchanged && cookedOutputIntact) {
+                        asset.SourceHash = previous.SourceHash;
+                        asset.Size = previous.Size;
+                        asset.Hash = previous.Hash;
+                        asset.Tags = previous.Tags;
+                        asset.CookedPath = cookedPath;
+                        continue;
+                    }
+                }
+                dirtyAssets.push_back(&asset);
+            }
+        }
+
+        utils::ParallelFor(dirtyAssets.size(), [&](Size i) {
+            ProcessAsset(*dirtyAssets[i]);
+        });
+
+        BakeFontAtlases(bundleNames, manifests);
+        PrecompileShaders(bundleNames, manifests);
+
+        std::atomic<U32> numPacked = 0;
+        utils::ParallelFor(bundleNames.size(), [&](Size i) {
+            const auto& bundleName = bundleNames[i];
+            Bool manifestOutdated = false;
+            if (IsBundleUpToDate(bundleName, manifests[i], manifestOutdated)) {
+                log::Info("Bundle: {} is up to date, skipping", bundleName);
+                if (manifestOutdated) {
+                    WriteManifest(bundleName);
+                }
+                return;
+            }
+
+            // drop the manifest first so an interrupted pack is never mistaken for an up to date bundle
+            utils::RemoveFile(m_BundlesPath + "/" + bundleName + ".manifest");
+            log::Info("Packing bundle: {}", bundleName);
+            if (PackBundle(bundleName)) {
+                WriteManifest(bundleName);
+                numPacked++;
+            }
+        });
+
+        log::Info("Packed {} of {} bundles ({} source files processed)", numPacked.load(), bundleNames.size(), dirtyAssets.size());
+        LogDeduplicationStats();
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,229 @@
+#include "services/assetmanager/AssetDependencyGraph.hpp"
+
+namespace tlc
+{
+    static constexpr U32 k_DependencyGraphMagic = 0x44434C54; // "TLCD"
+    static constexpr U32 k_DependencyGraphVersion = 1;
+
+    void AssetDependencyGraph::SetDependencies(const String& address, const List<String>& dependencies)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        LinkDependencies(address, dependencies);
+    }
+
+    void AssetDependencyGraph::AddDependencies(const String& address, const List<String>& dependencies)
+    {
+        // read and replaced under the same lock, edges added by other threads meanwhile are not lost
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto merged = dependencies;
+        auto previous = m_Dependencies.find(address);
+        if (previous != m_Dependencies.end()) {
+            merged.insert(merged.end(), previous->second.begin(), previous->second.end());
+        }
+        LinkDependencies(address, std::move(merged));
+    }
+
+    void AssetDependencyGraph::LinkDependencies(const String& address, List<String> dependencies)
+    {
+        std::sort(dependencies.begin(), dependencies.end());
+        dependencies.erase(std::unique(dependencies.begin(), dependencies.end()), dependencies.end());
+        std::erase(dependencies, address);
+
+        UnlinkDependencies(address);
+        if (dependencies.empty()) {
+            return;
+        }
+
+        for (const auto& dependency : dependencies) {
+            m_Dependents[dependency].push_back(address);
+        }
+        m_Dependencies[address] = std::move(dependencies);
+    }
+
+    void AssetDependencyGraph::RemoveAsset(const String& address)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        UnlinkDependencies(address);
+    }
+
+    void AssetDependencyGraph::Clear()
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Dependencies.clear();
+        m_Dependents.clear();
+    }
+
+    Bool AssetDependencyGraph::IsEmpty() const
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_Dependencies.empty();
+    }
+
+    void AssetDependencyGraph::UnlinkDependencies(const String& address)
+    {
+        auto dependencies = m_Dependencies.find(address);
+        if (dependencies == m_Dependencies.end()) {
+            return;
+        }
+
+        for (const auto& dependency : dependencies->second) {
+            auto dependents = m_Dependents.find(dependency);
+            if (dependents == m_Dependents.end()) {
+                continue;
+            }
+
+            std::erase(dependents->second, address);
+            if (dependents->second.empty()) {
+                m_Dependents.erase(dependents);
+            }
+        }
+        m_Dependencies.erase(dependencies);
+    }
+
+    List<String> AssetDependencyGraph::GetDependencies(const String& address) const
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto dependencies = m_Dependencies.find(address);
+        return dependencies != m_Dependencies.end() ? dependencies->second : List<String>();
+    }
+
+    // Breadth first walk over the given edges, cycles (eg. mutually including files) are fine
+    static List<String> CollectReachable(const UnorderedMap<String, List<String>>& edges, const List<String>& roots)
+    {
+        auto visited = Set<String>(roots.begin(), roots.end());
+        auto queue = std::queue<String>();
+        for (const auto& root : roots) {
+            queue.push(root);
+        }
+
+        while (!queue.empty()) {
+            auto node = edges.find(queue.front());
+            queue.pop();
+            if (node == edges.end()) {
+                continue;
+            }
+
+            for (const auto& next : node->second) {
+                if (visited.insert(next).second) {
+                    queue.push(next);
+                }
+            }
+        }
+
+        return List<String>(visited.begin(), visited.end());
+    }
+
+    List<String> AssetDependencyGraph::GetTransitiveDependencies(const String& address) const
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto result = CollectReachable(m_Dependencies, { address });
+        std::erase(result, address);
+        return result;
+    }
+
+    List<String> AssetDependencyGraph::GetDirtySet(const List<String>& changed) const
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return CollectReachable(m_Dependents, changed);
+    }
+
+    // Layout: [magic][version][asset count] then per asset
+    // [address length][address][dependency count] and [length][address] per dependency
+    List<U8> AssetDependencyGraph::Serialize() const
+    {
+        auto result = List<U8>();
+        auto write = [&result](const void* data, Size size) {
+            auto bytes = static_cast<const U8*>(data);
+            result.insert(result.end(), bytes, bytes + size);
+        };
+        auto writeU32 = [&write](U32 value) { write(&value, sizeof(U32)); };
+        auto writeString = [&](const String& value) {
+            writeU32(static_cast<U32>(value.size()));
+            write(value.data(), value.size());
+        };
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        // sorted so that the same graph always serializes to the same bytes
+        auto addresses = List<String>();
+        for (const auto& [address, _] : m_Dependencies) {
+            addresses.push_back(address);
+        }
+        std::sort(addresses.begin(), addresses.end());
+
+        writeU32(k_DependencyGraphMagic);
+        writeU32(k_DependencyGraphVersion);
+        writeU32(static_cast<U32>(addresses.size()));
+        for (const auto& address : addresses) {
+            const auto& dependencies = m_Dependencies.at(address);
+            writeString(address);
+            writeU32(static_cast<U32>(dependencies.size()));
+            for (const auto& dependency : dependencies) {
+                writeString(dependency);
+            }
+        }
+        return result;
+    }
+
+    Bool AssetDependencyGraph::Deserialize(const U8* data, Size size)
+    {
+        auto offset = Size(0);
+        auto readU32 = [&](U32& value) {
+            if (offset + sizeof(U32) > size) {
+                return false;
+            }
+            std::memcpy(&value, data + offset, sizeof(U32));
+            offset += sizeof(U32);
+            return true;
+        };
+        auto readString = [&](String& value) {
+            auto length = U32(0);
+            if (!readU32(length) || offset + length > size) {
+                return false;
+            }
+            value.assign(reinterpret_cast<const char*>(data + offset), length);
+            offset += length;
+            return true;
+        };
+
+        auto magic = U32(0), version = U32(0), count = U32(0);
+        if (!readU32(magic) || !readU32(version) || !readU32(count) || magic != k_DependencyGraphMagic || version != k_DependencyGraphVersion) {
+            log::Warn("Asset dependency graph data is not valid, it will be rebuilt");
+            return false;
+        }
+
+        // every entry and dependency takes at least a length, larger counts can not be
+        // right and are rejected before anything is allocated for them
+        auto fitsRemaining = [&](U32 value) {
+            return value <= (size - offset) / sizeof(U32);
+        };
+
+        if (!fitsRemaining(count)) {
+            log::Warn("Asset dependency graph data is truncated, it will be rebuilt");
+            return false;
+        }
+
+        auto entries = List<Pair<String, List<String>>>(count);
+        for (auto& [address, dependencies] : entries) {
+            auto dependencyCount = U32(0);
+            if (!readString(address) || !readU32(dependencyCount) || !fitsRemaining(dependencyCount)) {
+                log::Warn("Asset dependency graph data is truncated, it will be rebuilt");
+                return false;
+            }
+
+            dependencies.resize(dependencyCount);
+            for (auto& dependency : dependencies) {
+                if (!readString(dependency)) {
+                    log::Warn("Asset dependency graph data is truncated, it will be rebuilt");
+                    return false;
+                }
+            }
+        }
+
+        Clear();
+        for (const auto& [address, dependencies] : entries) {
+            SetDependencies(address, dependencies);
+        }
+        return true;
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "core/Core.hpp"
+
+namespace tlc
+{
+    // Dependency edges between assets by address (eg. a shader and the files it
+    // includes), recorded by whoever discovers them while cooking or compiling.
+    // Thread safe, edges may be recorded from worker threads.
+    class AssetDependencyGraph {
+        public:
+            // Replaces the direct dependencies of an asset
+            void SetDependencies(const String& address, const List<String>& dependencies);
+            // Adds to the direct dependencies of an asset, the ones it already has are kept
+            void AddDependencies(const String& address, const List<String>& dependencies);
+            void RemoveAsset(const String& address);
+            void Clear();
+
+            Bool IsEmpty() const;
+            List<String> GetDependencies(const String& address) const;
+            // Every asset reachable from the given one, sorted and without the asset itself
+            List<String> GetTransitiveDependencies(const String& address) const;
+            // The changed assets and every asset that transitively depends on one of them,
+            // exactly the set that has to be rebuilt after the change
+            List<String> GetDirtySet(const List<String>& changed) const;
+
+            List<U8> Serialize() const;
+            Bool Deserialize(const U8* data, Size size);
+
+        private:
+            // both expect m_Mutex to be held
+            void LinkDependencies(const String& address, List<String> dependencies);
+            void UnlinkDependencies(const String& address);
+
+        private:
+            mutable std::mutex m_Mutex;
+            UnorderedMap<String, List<String>> m_Dependencies; // asset -> what it uses
+            UnorderedMap<String, List<String>> m_Dependents;   // asset -> what uses it
+    };
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "core/Core.hpp"
+
+namespace tlc
+{
+    // 64-bit FNV-1a, used to key the table of contents by address
+    inline constexpr U64 HashAssetAddress(StringView address) {
+        U64 hash = 0xcbf29ce484222325ull;
+        for (auto c : address) {
+            hash ^= static_cast<U8>(c);
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    // Interned asset address. The id is the address hash the bundles are keyed by, so
+    // resolving an id is a single integer lookup. Ids of literal addresses are computed
+    // at compile time with the _asset suffix, keep the id around instead of the address
+    // wherever an asset is looked up often (eg. every frame).
+    struct AssetId {
+        U64 Value = 0;
+
+        constexpr AssetId() = default;
+        constexpr explicit AssetId(U64 value) : Value(value) {}
+        constexpr explicit AssetId(StringView address) : Value(HashAssetAddress(address)) {}
+
+        constexpr Bool IsValid() const { return Value != 0; }
+        constexpr Bool operator==(const AssetId& other) const = default;
+    };
+
+    consteval AssetId operator""_asset(const char* address, Size length) {
+        return AssetId(StringView(address, length));
+    }
+}
+
+namespace std {
+    template <>
+    struct hash<tlc::AssetId> {
+        size_t operator()(const tlc::AssetId& id) const {
+            // already a well mixed hash
+            return static_cast<size_t>(id.Value);
+        }
+    };
+
+    template <>
+    struct formatter<tlc::AssetId> : formatter<string> {
+        template<typename ParseContext>
+        auto parse(ParseContext& ctx) {
+            return ctx.begin();
+        }
+
+        template <typename FormatContext>
+        auto format(const tlc::AssetId& id, FormatContext& ctx) const {
+            return format_to(ctx.out(), "#{:016x}", id.Value);
+        }
+    };
+}
@@ -1,14 +1,38 @@
 #pragma once
 
 #include "core/Core.hpp"
+#include "core/MappedFile.hpp"
+#include "core/PinnedData.hpp"
 #include "services/Services.hpp"
 #include "services/assetmanager/Asset.hpp"
+#include "services/assetmanager/AssetBundleFormat.hpp"
+#include "services/assetmanager/AssetTagIndex.hpp"
+#include "services/assetmanager/AssetDependencyGraph.hpp"
+#include "services/assetmanager/AssetBundleVerifier.hpp"
 
 namespace tlc 
 {
+    // Mount priorities used by the game, any value works as long as patches sort above the base content
+    constexpr I32 k_BaseMountPriority = 0;
+    constexpr I32 k_PatchMountPriority = 100;
+    constexpr I32 k_LooseMountPriority = 200;
+
+#ifdef TLC_DEBUG
+    constexpr AssetVerificationMode k_DefaultVerificationMode = AssetVerificationMode::Full;
+#else
+    constexpr AssetVerificationMode k_DefaultVerificationMode = AssetVerificationMode::TableOfContents;
+#endif
+
+    enum class AssetMountType : U8 {
+        BundleDirectory, // every .bundle file in a directory
+        Bundle,          // a single bundle file, usually a patch
+        LooseDirectory   // raw files, addressed by their path relative to the directory
+    };
+
     class AssetManager : public IService {
         public:
-            void Setup(const String& bundlesPath);
+            // The bundles path is mounted as the base bundle directory
+            void Setup(const String& bundlesPath, AssetVerificationMode verificationMode = k_DefaultVerificationMode);
 
             void OnStart() override;
             void OnEnd() override;
@@ -19,32 +43,130 @@ namespace tlc
             void LoadAllBundles();
             void LogAssets();
 
-            // Asset queries
+            // Layered mounts, an address resolves to the asset of the highest priority mount
+            // that has it (the most recent mount wins ties), so patch bundles and loose files
+            // shadow base content without repacking it. Mounting only reads metadata, the new
+            // bundles still have to be loaded. Unmounting invalidates handles into the mount.
+            Bool MountBundleDirectory(const String& directory, I32 priority = k_BaseMountPriority);
+            Bool MountBundle(const String& bundlePath, I32 priority = k_PatchMountPriority, const String& bundleName = "");
+            Bool MountDirectory(const String& directory, const String& bundleName, I32 priority = k_LooseMountPriority, const String& addressPrefix = "");
+            void Unmount(const String& path);
+
+            // Asset queries, every query of a single asset takes either the address or its AssetId.
+            // The address overloads only hash the address, ids skip that as well.
             List<String> GetBundleNames() const;
             Bool AssetExists(const String& address) const;
+            Bool AssetExists(AssetId id) const;
             Bool AssetLoaded(const String& address) const;
+            Bool AssetLoaded(AssetId id) const;
             String GetAssetBundle(const String& address) const;
+            String GetAssetBundle(AssetId id) const;
+            AssetTags GetAssetTags(const String& address) const;
+            AssetTags GetAssetTags(AssetId id) const;
             List<String> GetAllAssets() const;
             List<String> GetAssetsInBundle(const String& bundleName) const;
             List<String> GetAssetsWithTags(AssetTags tags) const;
             List<String> GetAssetsWithTagsInBundle(AssetTags tags, const String& bundleName) const;
 
+            // Tag queries served from the per bundle tag index without copying addresses,
+            // the handles stay valid until the asset metadata is reloaded
+            List<AssetHandle> QueryAssetsWithTags(AssetTags tags) const;
+            List<AssetHandle> QueryAssetsWithTagsInBundle(AssetTags tags, const String& bundleName) const;
+
 
             // Asset Data queries
-            const Raw<U8> GetAssetDataRaw(const String& address, Size& size) const;
+            Raw<const U8> GetAssetDataRaw(const String& address, Size& size) const;
+            Raw<const U8> GetAssetDataRaw(AssetId id, Size& size) const;
             String GetAssetDataString(const String& address) const;
-            U32 GetAssetDataHash(const String& address) const;
+            String GetAssetDataString(AssetId id) const;
+            // Zero copy access, the handle keeps the data alive across unloads and reloads
+            PinnedData PinAssetData(const String& address) const;
+            PinnedData PinAssetData(AssetId id) const;
+            U64 GetAssetDataHash(const String& address) const;
+            U64 GetAssetDataHash(AssetId id) const;
+            // Hash of the asset and everything it transitively depends on, changes
+            // whenever anything that went into data built from the asset changes
+            U64 GetAssetDependencyHash(const String& address) const;
+
+            // Integrity of loaded bundles, with AssetVerificationMode::Full payloads are hashed in
+            // the background after a bundle is loaded so assets read Unverified until their turn.
+            // Loose files and overlays are always Valid, their hashes come from the data itself.
+            AssetIntegrity GetAssetIntegrity(const String& address) const;
+            AssetIntegrity GetAssetIntegrity(AssetId id) const;
+            List<String> GetCorruptedAssets() const;
+            void WaitForVerification();
+
+            // Edges are recorded by whoever discovers them (eg. the ShaderCompiler for includes)
+            inline AssetDependencyGraph& GetDependencyGraph() { return m_DependencyGraph; }
+
+            // Hot reload, an overlay shadows the packed copy of an asset until the
+            // asset metadata is reloaded. Data handed out for earlier versions of
+            // the asset stays valid until then as well.
+            Bool OverlayAsset(const String& address, List<U8> data, AssetTags tags);
+            void ClearOverlays();
 
 
         private:
-            void ReadAssetMetadata(std::ifstream& bundleFile, Asset& asset);
-            void LoadBundleMetadata(const String& bundleName);
+            struct AssetMount {
+                U32 Id = 0; // increasing, breaks priority ties
+                AssetMountType Type = AssetMountType::BundleDirectory;
+                String Path = "";
+                String BundleName = "";
+                String AddressPrefix = "";
+                I32 Priority = 0;
+            };
+
+            Bool AddMount(AssetMount mount);
+            void LoadMountMetadata(const AssetMount& mount);
+            void LoadBundleMetadata(const String& bundleName, const String& bundlePath, const AssetMount& mount);
+            void LoadDirectoryMetadata(const AssetMount& mount);
+            void RebuildAddressCache();
+
+        private:
+            struct LoadedBundle {
+                String Name = "";
+                String Path = ""; // the bundle file, or the directory of a loose bundle
+                U32 MountId = 0;
+                I32 Priority = 0;
+                Bool Loose = false;
+                Bool Loaded = false;
+                Ref<MappedFile> Mapping = nullptr; // shared with the verifier
+                Ref<List<List<U8>>> LooseData = nullptr; // file contents of a loaded loose bundle
+                List<Asset> Assets;
+                List<Bool> Shadowed; // by an asset with the same address in a higher priority mount
+                AssetTagIndex TagIndex;
+                Ref<AssetBundleVerification> Verification = nullptr;
+            };
+
+            struct AssetLocation {
+                Raw<LoadedBundle> Bundle = nullptr;
+                AssetHandle Asset = nullptr;
+            };
+
+            struct AssetOverlay {
+                List<U8> Data;
+                Asset Metadata;
+            };
 
-            const std::optional<Asset> GetAsset(const String& address, String& bundle) const;
+            // both expect m_Mutex to be held
+            AssetHandle ResolveOverlay(AssetHandle asset) const;
+            // The visible asset for an id (overlays included) and the bundle it is in, both null if there is none
+            AssetLocation FindAsset(AssetId id) const;
+            void CancelVerification(LoadedBundle& bundle);
 
         private:
-            std::mutex m_Mutex;
-            UnorderedMap<String, Pair<Raw<U8>, List<Asset>>> m_Assets;
+            // Held exclusively while mounts, bundles and overlays change and shared by the queries,
+            // so assets can be queried from worker threads (eg. shader variants) during hot reloads
+            mutable std::shared_mutex m_Mutex;
+            UnorderedMap<String, LoadedBundle> m_Assets;
+            UnorderedMap<AssetId, AssetLocation> m_AddressCache; // every visible address across all mounts
+            List<AssetMount> m_Mounts;
+            U32 m_NextMountId = 0;
+            UnorderedMap<AssetId, Ref<AssetOverlay>> m_Overlays;
+            List<Ref<AssetOverlay>> m_RetiredOverlays;
+            AssetDependencyGraph m_DependencyGraph;
+            AssetVerificationMode m_VerificationMode = k_DefaultVerificationMode;
+            AssetBundleVerifier m_Verifier;
             String m_BundlesPath = "";
     };
 }
\ No newline at end of file
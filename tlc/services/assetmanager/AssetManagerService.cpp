@@ -1,46 +1,128 @@
 #include "services/assetmanager/AssetManager.hpp"
+#include "core/Hash.hpp"
 
 namespace tlc {
 
-    void AssetManager::Setup(const String& bundlesPath) {
+    void AssetManager::Setup(const String& bundlesPath, AssetVerificationMode verificationMode) {
         m_BundlesPath = bundlesPath;
+        m_VerificationMode = verificationMode;
+        m_Mounts.push_back(AssetMount{
+            .Id = m_NextMountId++,
+            .Type = AssetMountType::BundleDirectory,
+            .Path = bundlesPath,
+            .Priority = k_BaseMountPriority,
+        });
     }
 
     void AssetManager::OnStart() {
         utils::EnsureDirectory(m_BundlesPath);
+        if (m_VerificationMode == AssetVerificationMode::Full) {
+            m_Verifier.Start();
+        }
         ReloadAssetMetadata();
         LoadAllBundles();
     }
 
     void AssetManager::OnEnd() {
         UnloadAllBundles();
+        m_Verifier.Stop();
+    }
+
+    Bool AssetManager::MountBundleDirectory(const String& directory, I32 priority) {
+        return AddMount(AssetMount{ .Type = AssetMountType::BundleDirectory, .Path = directory, .Priority = priority });
     }
 
-    void AssetManager::ReadAssetMetadata(std::ifstream& bundleFile, Asset& asset) {
-        // read the uuid
-        bundleFile.read(reinterpret_cast<char*>(&asset.UUID), sizeof(UUID));
-        // read the size
-        bundleFile.read(reinterpret_cast<char*>(&asset.Size), sizeof(Size));
-        // read the offset
-        bundleFile.read(reinterpret_cast<char*>(&asset.Offset), sizeof(Size));
-        // read the tags
-        bundleFile.read(reinterpret_cast<char*>(&asset.Tags), sizeof(AssetTags));
-        // read the hash
-        bundleFile.read(reinterpret_cast<char*>(&asset.Hash), sizeof(U32));
-        // read the address [max 1024 bytes]
-        static char address[1024];
-        bundleFile.read(address, 1024);
-        asset.Address = address;
+    Bool AssetManager::MountBundle(const String& bundlePath, I32 priority, const String& bundleName) {
+        auto name = bundleName.empty() ? std::filesystem::path(bundlePath).stem().string() : bundleName;
+        return AddMount(AssetMount{ .Type = AssetMountType::Bundle, .Path = bundlePath, .BundleName = name, .Priority = priority });
     }
 
+    Bool AssetManager::MountDirectory(const String& directory, const String& bundleName, I32 priority, const String& addressPrefix) {
+        return AddMount(AssetMount{ .Type = AssetMountType::LooseDirectory, .Path = directory, .BundleName = bundleName, .AddressPrefix = addressPrefix, .Priority = priority });
+    }
+
+    Bool AssetManager::AddMount(AssetMount mount) {
+        if (!utils::PathExists(mount.Path)) {
+            log::Warn("Mount point: {} not found!", mount.Path);
+            return false;
+        }
+
+        std::lock_guard<std::shared_mutex> lock(m_Mutex);
+        for (const auto& existing : m_Mounts) {
+            if (existing.Path == mount.Path) {
+                log::Warn("Mount point: {} is already mounted!", mount.Path);
+                return false;
+            }
+        }
+
+        mount.Id = m_NextMountId++;
+        m_Mounts.push_back(mount);
+        LoadMountMetadata(mount);
+        RebuildAddressCache();
+        log::Info("Mounted: {} with priority {}", mount.Path, mount.Priority);
+        return true;
+    }
+
+    void AssetManager::Unmount(const String& path) {
+        std::lock_guard<std::shared_mutex> lock(m_Mutex);
+        auto mount = std::find_if(m_Mounts.begin(), m_Mounts.end(), [&](const AssetMount& mount) { return mount.Path == path; });
+        if (mount == m_Mounts.end()) {
+            log::Warn("Mount point: {} is not mounted!", path);
+            return;
+        }
+
+        // dropping a bundle unmaps it as well
+        for (auto bundle = m_Assets.begin(); bundle != m_Assets.end();) {
+            if (bundle->second.MountId != mount->Id) {
+                ++bundle;
+                continue;
+            }
+            CancelVerification(bundle->second);
+            bundle = m_Assets.erase(bundle);
+        }
+        m_Mounts.erase(mount);
+        RebuildAddressCache();
+    }
+
+    void AssetManager::LoadMountMetadata(const AssetMount& mount) {
+        if (!utils::PathExists(mount.Path)) {
+            log::Warn("Mount point: {} not found!", mount.Path);
+            return;
+        }
+
+        switch (mount.Type) {
+            case AssetMountType::BundleDirectory:
+                for (const auto& entry : std::filesystem::directory_iterator(mount.Path)) {
+                    auto path = entry.path();
+                    if (path.extension() != ".bundle") {
+                        continue;
+                    }
+
+                    log::Info("Loading bundle: {}", path.string());
+                    LoadBundleMetadata(path.stem().string(), path.string(), mount);
+                }
+                break;
+            case AssetMountType::Bundle:
+                log::Info("Loading bundle: {}", mount.Path);
+                LoadBundleMetadata(mount.BundleName, mount.Path, mount);
+                break;
+            case AssetMountType::LooseDirectory:
+                LoadDirectoryMetadata(mount);
+                break;
+        }
+    }
 
-    void AssetManager::LoadBundleMetadata(const String& bundleName) {
-        auto bundlePath = m_BundlesPath + "/" + bundleName + ".bundle";
+    void AssetManager::LoadBundleMetadata(const String& bundleName, const String& bundlePath, const AssetMount& mount) {
         if (!utils::PathExists(bundlePath)) {
             log::Warn("Bundle: {} not found!", bundlePath);
             return;
         }
 
+        if (m_Assets.contains(bundleName)) {
+            log::Warn("Bundle: {} is already mounted, skipping: {}", bundleName, bundlePath);
+            return;
+        }
+
         // open the bundle file
         std::ifstream bundleFile(bundlePath, std::ios::binary);
         if (!bundleFile.is_open()) {
@@ -48,46 +130,155 @@ namespace tlc {
             return;
         }
 
-        // read the number of assets
-        U32 numAssets = 0;
-        bundleFile.read(reinterpret_cast<char*>(&numAssets), sizeof(U32));
-        
+        auto header = AssetBundleHeader();
+        bundleFile.read(reinterpret_cast<char*>(&header), sizeof(AssetBundleHeader));
+        if (!bundleFile || header.Magic != k_AssetBundleMagic) {
+            log::Error("Bundle: {} is not a valid bundle file!", bundlePath);
+            return;
+        }
+
+        if (header.Version != k_AssetBundleVersion) {
+            log::Error("Bundle: {} has version {} but {} is required, repack it!", bundlePath, header.Version, k_AssetBundleVersion);
+            return;
+        }
+
+        auto recordsSize = static_cast<Size>(header.AssetCount) * sizeof(AssetBundleRecord);
+        if (header.TableOfContentsSize != recordsSize + header.StringTableSize) {
+            log::Error("Bundle: {} has a corrupted table of contents!", bundlePath);
+            return;
+        }
+
+        // read the whole table of contents in one go
+        auto tableOfContents = List<U8>(header.TableOfContentsSize);
+        bundleFile.read(reinterpret_cast<char*>(tableOfContents.data()), tableOfContents.size());
+        if (!bundleFile) {
+            log::Error("Bundle: {} has a truncated table of contents!", bundlePath);
+            return;
+        }
+        bundleFile.close();
+
+        // fast mode only checks the table of contents, payloads are checked against their records once loaded
+        if (m_VerificationMode != AssetVerificationMode::None && utils::HashBuffer(tableOfContents) != header.TableOfContentsHash) {
+            log::Error("Bundle: {} has a corrupted table of contents, its hash does not match the header!", bundlePath);
+            return;
+        }
+
+        auto records = reinterpret_cast<const AssetBundleRecord*>(tableOfContents.data());
+        auto stringTable = reinterpret_cast<const char*>(tableOfContents.data() + recordsSize);
+
+        auto assets = List<Asset>(header.AssetCount);
+        for (U32 i = 0; i < header.AssetCount; i++) {
+            const auto& record = records[i];
+            if (static_cast<Size>(record.AddressOffset) + record.AddressLength > header.StringTableSize) {
+                log::Error("Bundle: {} has a corrupted string table!", bundlePath);
+                return;
+            }
+
+            auto& asset = assets[i];
+            asset.Address = String(stringTable + record.AddressOffset, record.AddressLength);
+            asset.Id = AssetId(record.AddressHash);
+            asset.UUID = UUID::FromBytes(record.UUID);
+            asset.Offset = record.Offset;
+            asset.Size = record.Size;
+            asset.Tags = static_cast<AssetTags>(record.Tags);
+            asset.Hash = record.Hash;
+            asset.Alignment = record.Alignment;
+        }
+
+        // store the assets and index their tags
+        auto& bundle = m_Assets[bundleName];
+        bundle.Name = bundleName;
+        bundle.Path = bundlePath;
+        bundle.MountId = mount.Id;
+        bundle.Priority = mount.Priority;
+        bundle.Assets = std::move(assets);
+        bundle.TagIndex.Build(bundle.Assets);
+    }
+
+    void AssetManager::LoadDirectoryMetadata(const AssetMount& mount) {
+        if (m_Assets.contains(mount.BundleName)) {
+            log::Warn("Bundle: {} is already mounted, skipping: {}", mount.BundleName, mount.Path);
+            return;
+        }
+
         auto assets = List<Asset>();
-        assets.reserve(numAssets);
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(mount.Path)) {
+            if (!entry.is_regular_file()) {
+                continue;
+            }
 
-        for (U32 i = 0; i < numAssets; i++) {
-            Asset asset;
-            ReadAssetMetadata(bundleFile, asset);
-            assets.emplace_back(asset);
+            // loose files are not cooked, they are served exactly as they are on disk
+            auto address = mount.AddressPrefix + std::filesystem::relative(entry.path(), mount.Path).generic_string();
+            assets.emplace_back(Asset{
+                .Path = entry.path().string(),
+                .Address = address,
+                .Id = AssetId(address),
+                .Size = static_cast<Size>(entry.file_size()),
+                .Tags = DetectAssetTags(address),
+            });
         }
 
-        // store the assets
-        m_Assets[bundleName] = { nullptr, assets };
+        auto& bundle = m_Assets[mount.BundleName];
+        bundle.Name = mount.BundleName;
+        bundle.Path = mount.Path;
+        bundle.MountId = mount.Id;
+        bundle.Priority = mount.Priority;
+        bundle.Loose = true;
+        bundle.Assets = std::move(assets);
+        bundle.TagIndex.Build(bundle.Assets);
+    }
+
+    void AssetManager::RebuildAddressCache() {
+        // walk the bundles from the lowest to the highest priority so that later ones shadow earlier ones
+        auto bundles = List<Raw<LoadedBundle>>();
+        auto assetCount = Size(0);
+        for (auto& [_, bundle] : m_Assets) {
+            bundles.push_back(&bundle);
+            assetCount += bundle.Assets.size();
+        }
+        std::sort(bundles.begin(), bundles.end(), [](const auto a, const auto b) {
+            return a->Priority != b->Priority ? a->Priority < b->Priority : a->MountId < b->MountId;
+        });
+
+        m_AddressCache.clear();
+        m_AddressCache.reserve(assetCount);
+        for (auto bundle : bundles) {
+            bundle->Shadowed.assign(bundle->Assets.size(), false);
+            for (Size i = 0; i < bundle->Assets.size(); i++) {
+                const auto& asset = bundle->Assets[i];
+                auto [location, inserted] = m_AddressCache.try_emplace(asset.Id);
+                if (!inserted) {
+                    auto shadowed = location->second;
+                    shadowed.Bundle->Shadowed[shadowed.Asset - shadowed.Bundle->Assets.data()] = true;
+                    if (shadowed.Asset->Address != asset.Address) {
+                        log::Error("Asset: {} shadows: {}, their addresses hash to the same id, rename one of them!", asset.Address, shadowed.Asset->Address);
+                    }
+                }
+                location->second = AssetLocation{ bundle, &asset };
+            }
+        }
     }
 
     void AssetManager::ReloadAssetMetadata() 
     {
         UnloadAllBundles();
 
-        std::lock_guard<std::mutex> lock(m_Mutex);
+        std::lock_guard<std::shared_mutex> lock(m_Mutex);
         m_Assets.clear();
+        m_AddressCache.clear();
+        m_Overlays.clear();
+        m_RetiredOverlays.clear();
 
-        // load all the bundle metadata
-        for (const auto& entry : std::filesystem::directory_iterator(m_BundlesPath)) {
-            auto path = entry.path();
-            if (path.extension() != ".bundle") {
-                continue;
-            }
-
-            log::Info("Loading bundle: {}", path.string());
-            auto bundleName = path.stem().string();
-            LoadBundleMetadata(bundleName);
+        // load the metadata of every mount
+        for (const auto& mount : m_Mounts) {
+            LoadMountMetadata(mount);
         }
+        RebuildAddressCache();
     }
 
     void AssetManager::UnloadBundle(const String& bundleName)
     {
-        std::lock_guard<std::mutex> lock(m_Mutex);
+        std::lock_guard<std::shared_mutex> lock(m_Mutex);
 
         auto bundle = m_Assets.find(bundleName);
         if(bundle == m_Assets.end()) {
@@ -96,15 +287,17 @@ namespace tlc {
         }
 
         // unload the assets
-        if (bundle->second.first != nullptr) {
+        if (bundle->second.Loaded) {
             // delink the assets
-            for (auto& asset : bundle->second.second) {
+            for (auto& asset : bundle->second.Assets) {
                 asset.Data = nullptr;
             }
 
-            // free the memory
-            delete[] bundle->second.first;
-            bundle->second.first = nullptr;
+            // unmap the bundle, a pending verification keeps its own reference to the mapping
+            CancelVerification(bundle->second);
+            bundle->second.Mapping.reset();
+            bundle->second.LooseData.reset();
+            bundle->second.Loaded = false;
         }
     }
 
@@ -117,13 +310,14 @@ namespace tlc {
 
     void AssetManager::LogAssets()
     {
-        std::lock_guard<std::mutex> lock(m_Mutex);
+        std::lock_guard<std::shared_mutex> lock(m_Mutex);
 
         for (const auto& [bundleName, bundle] : m_Assets) {
-            log::Trace("Bundle: {}", bundleName);
-            for (const auto& asset : bundle.second) {
-                log::Trace("Asset: {} | Address: {} | Tags: {} | Offset: {}",
-                    asset.Path, asset.Address, asset.Tags, asset.Offset
+            log::Trace("Bundle: {} | Path: {} | Priority: {}", bundleName, bundle.Path, bundle.Priority);
+            for (Size i = 0; i < bundle.Assets.size(); i++) {
+                const auto& asset = bundle.Assets[i];
+                log::Trace("Asset: {} | Address: {} | Tags: {} | Offset: {}{}",
+                    asset.Path, asset.Address, asset.Tags, asset.Offset, bundle.Shadowed[i] ? " | Shadowed" : ""
                 );
             }
         }
@@ -136,39 +330,72 @@ namespace tlc {
             return;
         }
 
+        std::lock_guard<std::shared_mutex> lock(m_Mutex);
         auto bundle = m_Assets.find(bundleName);
         if(bundle == m_Assets.end()) {
             log::Warn("Bundle: {} not found!", bundleName);
             return;
         }
 
-        if (bundle->second.first != nullptr) {
+        if (bundle->second.Loaded) {
             log::Warn("Bundle: {} already loaded!", bundleName);
             return;
         }
 
-        std::lock_guard<std::mutex> lock(m_Mutex);
-        auto file = m_BundlesPath + "/" + bundleName + ".bundle";
-        auto bundleFile = std::ifstream(file, std::ios::binary);
-        if (!bundleFile.is_open()) {
-            log::Error("Failed to open bundle file: {}", file);
+        auto& assets = bundle->second.Assets;
+        if (bundle->second.Loose) {
+            auto looseData = CreateRef<List<List<U8>>>(assets.size());
+            for (Size i = 0; i < assets.size(); i++) {
+                (*looseData)[i] = utils::ReadBinaryFile(assets[i].Path);
+            }
+
+            for (Size i = 0; i < assets.size(); i++) {
+                const auto& data = (*looseData)[i];
+                assets[i].Data = data.data();
+                assets[i].Size = data.size();
+                assets[i].Hash = utils::HashBuffer(data);
+            }
+            bundle->second.LooseData = std::move(looseData);
+            bundle->second.Loaded = true;
+
+            log::Info("Loose bundle: {} loaded!", bundleName);
             return;
         }
 
-        // read the whole bundle into memory
-        bundleFile.seekg(0, std::ios::end);
-        auto size = bundleFile.tellg();
-        bundleFile.seekg(0, std::ios::beg);
+        const auto& file = bundle->second.Path;
 
-        bundle->second.first = new U8[size];
-        bundleFile.read(reinterpret_cast<char*>(bundle->second.first), size);
-        bundleFile.close();
+        // map the whole bundle, the mapping is page aligned so aligned
+        // payload offsets give aligned data pointers
+        auto mappedFile = CreateRef<MappedFile>(file);
+        if (!mappedFile->IsReady()) {
+            log::Error("Failed to map bundle file: {}", file);
+            return;
+        }
 
+        for (const auto& asset : assets) {
+            if (asset.Offset + asset.Size > mappedFile->GetSize()) {
+                log::Error("Bundle: {} is truncated, asset: {} is out of bounds!", bundleName, asset.Address);
+                return;
+            }
+        }
 
         // link the assets
-        auto& assets = bundle->second.second;
+        bundle->second.Mapping = std::move(mappedFile);
+        bundle->second.Loaded = true;
         for (auto& asset : assets) {
-            asset.Data = bundle->second.first + asset.Offset;
+            asset.Data = bundle->second.Mapping->GetData() + asset.Offset;
+        }
+
+        // hashing every payload takes far longer than mapping the bundle, so it is
+        // left to the verifier and the assets can be used right away
+        if (m_VerificationMode == AssetVerificationMode::Full) {
+            auto verification = CreateRef<AssetBundleVerification>();
+            verification->BundleName = bundleName;
+            verification->Mapping = bundle->second.Mapping;
+            verification->Assets = assets;
+            verification->Results = List<std::atomic<AssetIntegrity>>(assets.size());
+            bundle->second.Verification = verification;
+            m_Verifier.Enqueue(std::move(verification));
         }
 
         log::Info("Bundle: {} loaded!", bundleName);
@@ -176,12 +403,16 @@ namespace tlc {
     
     void AssetManager::LoadAllBundles()
     {
-        for (const auto& [bundleName, _] : m_Assets) {
-            LoadBundle(bundleName);
+        for (const auto& [bundleName, bundle] : m_Assets) {
+            // bundles mounted after the last call are the only ones left to load
+            if (!bundle.Loaded) {
+                LoadBundle(bundleName);
+            }
         }
     }
 
     List<String> AssetManager::GetBundleNames() const {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
         List<String> result;
         for (const auto& [bundleName, _] : m_Assets) {
             result.emplace_back(bundleName);
@@ -190,47 +421,51 @@ namespace tlc {
     }
 
     List<String> AssetManager::GetAllAssets() const {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
         List<String> result;
-        for (const auto& [_, bundle] : m_Assets) {
-            for (const auto& asset : bundle.second) {
-                result.emplace_back(asset.Address);
-            }
+        result.reserve(m_AddressCache.size());
+        for (const auto& [_, location] : m_AddressCache) {
+            result.emplace_back(location.Asset->Address);
         }
         return result;
     }
 
     Bool AssetManager::AssetExists(const String& address) const {
-        String bundleName = "";
-        auto asset = GetAsset(address, bundleName);
-        return asset.has_value();
+        return AssetExists(AssetId(address));
+    }
+
+    Bool AssetManager::AssetExists(AssetId id) const {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
+        return FindAsset(id).Asset != nullptr;
     }
 
     Bool AssetManager::AssetLoaded(const String& address) const
     {
-        String bundleName = "";
-        auto asset = GetAsset(address, bundleName);
-        if (!asset.has_value()) {
-            return false;
-        }
-        
-        auto bundle = m_Assets.find(bundleName);
-        if(bundle == m_Assets.end()) {
-            log::Warn("Bundle: {} not found!", bundleName);
-            return false;
-        }
+        return AssetLoaded(AssetId(address));
+    }
 
-        return bundle->second.first != nullptr;        
+    Bool AssetManager::AssetLoaded(AssetId id) const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
+        auto location = FindAsset(id);
+        return location.Asset != nullptr && location.Bundle->Loaded;
     }
 
     String AssetManager::GetAssetBundle(const String& address) const
     {
-        String bundleName = "";
-        GetAsset(address, bundleName);
-        return bundleName;
+        return GetAssetBundle(AssetId(address));
+    }
+
+    String AssetManager::GetAssetBundle(AssetId id) const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
+        auto location = FindAsset(id);
+        return location.Asset != nullptr ? location.Bundle->Name : "";
     }
 
     List<String> AssetManager::GetAssetsInBundle(const String& bundleName) const
     {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
         List<String> result;
         auto bundle = m_Assets.find(bundleName);
         if(bundle == m_Assets.end()) {
@@ -238,7 +473,7 @@ namespace tlc {
             return result;
         }
 
-        for (const auto& asset : bundle->second.second) {
+        for (const auto& asset : bundle->second.Assets) {
             result.emplace_back(asset.Address);
         }
 
@@ -247,12 +482,8 @@ namespace tlc {
 
     List<String> AssetManager::GetAssetsWithTags(AssetTags tags) const {
         List<String> result;
-        for (const auto& [_, bundle] : m_Assets) {
-            for (const auto& asset : bundle.second) {
-                if ((asset.Tags & tags) == tags) {
-                    result.emplace_back(asset.Address);
-                }
-            }
+        for (auto asset : QueryAssetsWithTags(tags)) {
+            result.emplace_back(asset->Address);
         }
         return result;
     }
@@ -260,64 +491,253 @@ namespace tlc {
     List<String> AssetManager::GetAssetsWithTagsInBundle(AssetTags tags, const String& bundleName) const
     {
         List<String> result;
+        for (auto asset : QueryAssetsWithTagsInBundle(tags, bundleName)) {
+            result.emplace_back(asset->Address);
+        }
+        return result;
+    }
+
+    List<AssetHandle> AssetManager::QueryAssetsWithTags(AssetTags tags) const {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
+        List<AssetHandle> result;
+        for (const auto& [_, bundle] : m_Assets) {
+            bundle.TagIndex.ForEach(tags, [&](Size index) {
+                if (!bundle.Shadowed[index]) {
+                    result.emplace_back(ResolveOverlay(&bundle.Assets[index]));
+                }
+            });
+        }
+        return result;
+    }
+
+    List<AssetHandle> AssetManager::QueryAssetsWithTagsInBundle(AssetTags tags, const String& bundleName) const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
+        List<AssetHandle> result;
         auto bundle = m_Assets.find(bundleName);
         if(bundle == m_Assets.end()) {
             log::Warn("Bundle: {} not found!", bundleName);
             return result;
         }
 
-        for (const auto& asset : bundle->second.second) {
-            if ((asset.Tags & tags) == tags) {
-                result.emplace_back(asset.Address);
+        bundle->second.TagIndex.ForEach(tags, [&](Size index) {
+            if (!bundle->second.Shadowed[index]) {
+                result.emplace_back(ResolveOverlay(&bundle->second.Assets[index]));
             }
+        });
+        return result;
+    }
+
+    AssetHandle AssetManager::ResolveOverlay(AssetHandle asset) const {
+        if (m_Overlays.empty()) {
+            return asset;
         }
 
-        return result;
+        auto overlay = m_Overlays.find(asset->Id);
+        return overlay != m_Overlays.end() ? &overlay->second->Metadata : asset;
+    }
+
+    AssetManager::AssetLocation AssetManager::FindAsset(AssetId id) const {
+        // a single lookup no matter how many mounts there are
+        auto location = m_AddressCache.find(id);
+        if (location == m_AddressCache.end()) {
+            return AssetLocation();
+        }
+
+        return AssetLocation{ location->second.Bundle, ResolveOverlay(location->second.Asset) };
     }
 
-    const std::optional<Asset> AssetManager::GetAsset(const String& address, String& bundleName) const {
-        bundleName = "";
-        for (const auto& [assetBundleName, bundle] : m_Assets) {
-            for (const auto& asset : bundle.second) {
-                if (asset.Address == address) {
-                    bundleName = assetBundleName;
-                    return std::optional<Asset>(asset);
+    Bool AssetManager::OverlayAsset(const String& address, List<U8> data, AssetTags tags) {
+        // the overlay is replaced rather than updated so that data handed out
+        // for the previous version is not freed underneath its reader
+        auto overlay = CreateRef<AssetOverlay>();
+        overlay->Data = std::move(data);
+        auto hash = utils::HashBuffer(overlay->Data);
+
+        auto id = AssetId(address);
+        std::lock_guard<std::shared_mutex> lock(m_Mutex);
+        auto location = FindAsset(id);
+        if (location.Asset == nullptr) {
+            log::Warn("Asset: {} not found, only packed assets can be overlaid!", address);
+            return false;
+        }
+
+        overlay->Metadata = *location.Asset;
+        overlay->Metadata.Data = overlay->Data.data();
+        overlay->Metadata.Size = overlay->Data.size();
+        overlay->Metadata.Hash = hash;
+        overlay->Metadata.Tags = tags;
+
+        auto& slot = m_Overlays[id];
+        if (slot != nullptr) {
+            m_RetiredOverlays.emplace_back(std::move(slot));
+        }
+        slot = std::move(overlay);
+        return true;
+    }
+
+    void AssetManager::ClearOverlays() {
+        std::lock_guard<std::shared_mutex> lock(m_Mutex);
+        m_Overlays.clear();
+        m_RetiredOverlays.clear();
+    }
+
+    void AssetManager::CancelVerification(LoadedBundle& bundle) {
+        if (bundle.Verification != nullptr) {
+            bundle.Verification->Cancelled = true;
+            bundle.Verification.reset();
+        }
+    }
+
+    AssetIntegrity AssetManager::GetAssetIntegrity(const String& address) const {
+        return GetAssetIntegrity(AssetId(address));
+    }
+
+    AssetIntegrity AssetManager::GetAssetIntegrity(AssetId id) const {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
+        if (!m_Overlays.empty() && m_Overlays.contains(id)) {
+            return AssetIntegrity::Valid;
+        }
+
+        auto location = m_AddressCache.find(id);
+        if (location == m_AddressCache.end() || !location->second.Bundle->Loaded) {
+            return AssetIntegrity::Unverified;
+        }
+
+        const auto& bundle = *location->second.Bundle;
+        if (bundle.Loose) {
+            return AssetIntegrity::Valid;
+        }
+
+        if (bundle.Verification == nullptr) {
+            return AssetIntegrity::Unverified;
+        }
+        return bundle.Verification->Results[location->second.Asset - bundle.Assets.data()];
+    }
+
+    List<String> AssetManager::GetCorruptedAssets() const {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
+        List<String> result;
+        for (const auto& [_, bundle] : m_Assets) {
+            if (bundle.Verification == nullptr || bundle.Verification->NumCorrupted == 0) {
+                continue;
+            }
+
+            for (Size i = 0; i < bundle.Assets.size(); i++) {
+                if (bundle.Verification->Results[i] == AssetIntegrity::Corrupted) {
+                    result.emplace_back(bundle.Assets[i].Address);
                 }
             }
         }
-        return std::nullopt;
+        return result;
     }
 
-    const Raw<U8> AssetManager::GetAssetDataRaw(const String& address, Size& size) const {
-        String bundleName = "";
-        auto asset = GetAsset(address, bundleName);
-        if (!asset.has_value()) {
-            log::Warn("Asset: {} not found!", address);
+    void AssetManager::WaitForVerification() {
+        m_Verifier.Wait();
+    }
+
+    AssetTags AssetManager::GetAssetTags(const String& address) const {
+        return GetAssetTags(AssetId(address));
+    }
+
+    AssetTags AssetManager::GetAssetTags(AssetId id) const {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
+        auto location = FindAsset(id);
+        return location.Asset != nullptr ? location.Asset->Tags : AssetTags::None;
+    }
+
+    Raw<const U8> AssetManager::GetAssetDataRaw(const String& address, Size& size) const {
+        return GetAssetDataRaw(AssetId(address), size);
+    }
+
+    Raw<const U8> AssetManager::GetAssetDataRaw(AssetId id, Size& size) const {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
+        auto location = FindAsset(id);
+        if (location.Asset == nullptr) {
+            log::Warn("Asset: {} not found!", id);
             return nullptr;
         }
-        size = asset->Size;
-        return asset->Data;
+        size = location.Asset->Size;
+        return location.Asset->Data;
     }
 
     String AssetManager::GetAssetDataString(const String& address) const  {
-        String bundleName = "";
-        auto asset = GetAsset(address, bundleName);
-        if (!asset.has_value()) {
-            log::Warn("Asset: {} not found!", address);
+        return GetAssetDataString(AssetId(address));
+    }
+
+    String AssetManager::GetAssetDataString(AssetId id) const  {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
+        auto location = FindAsset(id);
+        if (location.Asset == nullptr) {
+            log::Warn("Asset: {} not found!", id);
             return "";
         }
 
-        return String(reinterpret_cast<const char*>(asset->Data), asset->Size);
+        return String(reinterpret_cast<const char*>(location.Asset->Data), location.Asset->Size);
     }
 
-    U32 AssetManager::GetAssetDataHash(const String& address) const {
-        String bundleName = "";
-        auto asset = GetAsset(address, bundleName);
-        if (!asset.has_value()) {
-            log::Warn("Asset: {} not found!", address);
+    PinnedData AssetManager::PinAssetData(const String& address) const {
+        return PinAssetData(AssetId(address));
+    }
+
+    PinnedData AssetManager::PinAssetData(AssetId id) const {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
+        if (!m_Overlays.empty()) {
+            auto overlay = m_Overlays.find(id);
+            if (overlay != m_Overlays.end()) {
+                const auto& metadata = overlay->second->Metadata;
+                return PinnedData(overlay->second, metadata.Data, metadata.Size);
+            }
+        }
+
+        auto location = m_AddressCache.find(id);
+        if (location == m_AddressCache.end()) {
+            log::Warn("Asset: {} not found!", id);
+            return PinnedData();
+        }
+
+        const auto& bundle = *location->second.Bundle;
+        if (!bundle.Loaded) {
+            log::Warn("Asset: {} is in bundle: {} which is not loaded!", location->second.Asset->Address, bundle.Name);
+            return PinnedData();
+        }
+
+        // the asset points into the mapping or the loose file contents, either one owns it
+        auto owner = bundle.Loose ? Ref<const void>(bundle.LooseData) : Ref<const void>(bundle.Mapping);
+        return PinnedData(std::move(owner), location->second.Asset->Data, location->second.Asset->Size);
+    }
+
+    U64 AssetManager::GetAssetDataHash(const String& address) const {
+        return GetAssetDataHash(AssetId(address));
+    }
+
+    U64 AssetManager::GetAssetDataHash(AssetId id) const {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
+        auto location = FindAsset(id);
+        if (location.Asset == nullptr) {
+            log::Warn("Asset: {} not found!", id);
             return 0;
         }
 
-        return asset->Hash;
+        return location.Asset->Hash;
+    }
+
+    U64 AssetManager::GetAssetDependencyHash(const String& address) const {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
+        auto root = FindAsset(AssetId(address));
+        if (root.Asset == nullptr) {
+            log::Warn("Asset: {} not found!", address);
+        }
+
+        auto hasher = Hasher();
+        hasher.UpdateValue(root.Asset != nullptr ? root.Asset->Hash : U64(0));
+        for (const auto& dependency : m_DependencyGraph.GetTransitiveDependencies(address)) {
+            // a dependency that no longer exists changes the hash as well
+            auto id = AssetId(dependency);
+            auto location = FindAsset(id);
+            hasher.UpdateValue(id.Value);
+            hasher.UpdateValue(location.Asset != nullptr ? location.Asset->Hash : U64(0));
+        }
+        return hasher.Digest();
     }
-}
+}
\ No newline at end of file
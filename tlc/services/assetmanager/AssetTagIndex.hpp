@@ -0,0 +1,68 @@
+#pragma once
+
+#include <bit>
+
+#include "core/Core.hpp"
+#include "services/assetmanager/Asset.hpp"
+
+namespace tlc
+{
+    // Posting index over the tags of a bundle, one bitset per tag bit with a bit
+    // per asset. Multi tag queries AND the bitsets of every requested tag bit
+    // a word at a time instead of testing each asset.
+    class AssetTagIndex {
+        public:
+            inline void Build(const List<Asset>& assets) {
+                m_NumAssets = assets.size();
+                m_NumWords = (m_NumAssets + 63) / 64;
+                m_Bitsets.assign(k_NumTagBits * m_NumWords, 0);
+
+                for (Size i = 0; i < assets.size(); i++) {
+                    auto tags = static_cast<U32>(assets[i].Tags);
+                    while (tags != 0) {
+                        auto bit = static_cast<U32>(std::countr_zero(tags));
+                        m_Bitsets[bit * m_NumWords + i / 64] |= 1ull << (i % 64);
+                        tags &= tags - 1;
+                    }
+                }
+            }
+
+            // Calls func(assetIndex) in ascending order for every asset that has all the tags
+            template<typename Func>
+            inline void ForEach(AssetTags tags, Func&& func) const {
+                for (Size word = 0; word < m_NumWords; word++) {
+                    auto bits = GetValidBits(word);
+                    auto remainingTags = static_cast<U32>(tags);
+                    while (remainingTags != 0 && bits != 0) {
+                        auto bit = static_cast<U32>(std::countr_zero(remainingTags));
+                        bits &= m_Bitsets[bit * m_NumWords + word];
+                        remainingTags &= remainingTags - 1;
+                    }
+
+                    while (bits != 0) {
+                        func(word * 64 + static_cast<Size>(std::countr_zero(bits)));
+                        bits &= bits - 1;
+                    }
+                }
+            }
+
+            inline Size Count(AssetTags tags) const {
+                auto count = Size(0);
+                ForEach(tags, [&count](Size) { count++; });
+                return count;
+            }
+
+        private:
+            inline U64 GetValidBits(Size word) const {
+                auto remaining = m_NumAssets - word * 64;
+                return remaining >= 64 ? ~0ull : (1ull << remaining) - 1;
+            }
+
+        private:
+            static constexpr U32 k_NumTagBits = 32;
+
+            Size m_NumAssets = 0;
+            Size m_NumWords = 0;
+            List<U64> m_Bitsets; // k_NumTagBits bitsets of m_NumWords words each
+    };
+}
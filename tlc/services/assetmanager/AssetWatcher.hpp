@@ -0,0 +1,68 @@
+#pragma once
+
+#include "core/Core.hpp"
+#include "services/Services.hpp"
+#include "services/assetmanager/Asset.hpp"
+
+// Hot reloading is a development feature, release builds only load packed bundles
+#ifdef TLC_DEBUG
+#define TLC_ENABLE_ASSET_HOT_RELOAD
+#endif
+
+#ifdef TLC_ENABLE_ASSET_HOT_RELOAD
+namespace tlc
+{
+    // Watches the raw asset directories (inotify on linux, polling elsewhere) and hot
+    // reloads edited assets: the asset is rebuilt on its own and overlaid on top of its
+    // bundle, cache entries built from it are invalidated and an
+    // EventManager<EventType::AssetChanged, String, AssetTags> event is raised.
+    //
+    // File events are collected on a background thread, Poll() applies them on the
+    // calling thread once a file has been quiet for a short while.
+    class AssetWatcher : public IService {
+        public:
+            void Setup();
+
+            void OnStart() override;
+            void OnEnd() override;
+
+            // Mirrors AssetBundler::RegisterFromDirectory, addresses are built the same way
+            Bool Watch(const String& directory, const String& bundleName, const String& addressPrefix = "");
+            void Poll();
+
+        private:
+            struct WatchedDirectory {
+                String Path = "";
+                String BundleName = "";
+                String AddressPrefix = "";
+            };
+
+            struct PendingChange {
+                String Path = "";
+                String BundleName = "";
+                F64 LastEventTime = 0.0;
+            };
+
+            void WatchThread();
+            void WatchDirectoryTree(const WatchedDirectory& directory);
+            void QueueChange(const WatchedDirectory& directory, const String& fileName);
+            void PollModifiedTimes(Bool reportChanges);
+            void ApplyChange(const String& address, const PendingChange& change);
+
+        private:
+            std::thread m_Thread;
+            std::atomic<Bool> m_Running = false;
+            std::mutex m_Mutex;
+
+            List<WatchedDirectory> m_Roots;
+            UnorderedMap<String, PendingChange> m_PendingChanges; // by address
+
+            // inotify watch descriptors, unused by the polling fallback
+            I32 m_NotifyHandle = -1;
+            UnorderedMap<I32, WatchedDirectory> m_Watches;
+
+            // polling fallback
+            UnorderedMap<String, U64> m_ModifiedTimes;
+    };
+}
+#endif
@@ -0,0 +1,244 @@
+#include "services/assetmanager/AssetWatcher.hpp"
+
+#ifdef TLC_ENABLE_ASSET_HOT_RELOAD
+
+#include "core/EventManager.hpp"
+#include "services/CacheManager.hpp"
+#include "services/assetmanager/AssetManager.hpp"
+#include "services/assetmanager/AssetBundler.hpp"
+
+#if defined(PLATFORM_LINUX)
+#include <sys/inotify.h>
+#include <poll.h>
+#endif
+
+namespace tlc {
+
+    static constexpr F64 k_SettleTime = 0.15; // seconds a file has to stay quiet before it is reloaded
+    static constexpr I32 k_NotifyTimeoutMs = 100;
+    static constexpr I32 k_ScanIntervalMs = 500;
+
+    static F64 GetWatcherTime() {
+        return std::chrono::duration<F64>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void AssetWatcher::Setup() {
+
+    }
+
+    void AssetWatcher::OnStart() {
+#if defined(PLATFORM_LINUX)
+        m_NotifyHandle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_NotifyHandle < 0) {
+            log::Warn("AssetWatcher: inotify is not available, falling back to polling");
+        }
+#endif
+
+        m_Running = true;
+        m_Thread = std::thread(&AssetWatcher::WatchThread, this);
+    }
+
+    void AssetWatcher::OnEnd() {
+        m_Running = false;
+        if (m_Thread.joinable()) {
+            m_Thread.join();
+        }
+
+#if defined(PLATFORM_LINUX)
+        if (m_NotifyHandle >= 0) {
+            close(m_NotifyHandle);
+            m_NotifyHandle = -1;
+        }
+#endif
+    }
+
+    Bool AssetWatcher::Watch(const String& directory, const String& bundleName, const String& addressPrefix) {
+        if (!utils::PathExists(directory)) {
+            log::Warn("AssetWatcher: directory not found at path: {}!", directory);
+            return false;
+        }
+
+        auto root = WatchedDirectory{ directory, bundleName, addressPrefix };
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Roots.push_back(root);
+        if (m_NotifyHandle >= 0) {
+            WatchDirectoryTree(root);
+        }
+        else {
+            // record the current state, only later modifications are reported
+            PollModifiedTimes(false);
+        }
+
+        log::Info("AssetWatcher: watching: {} for bundle: {}", directory, bundleName);
+        return true;
+    }
+
+    void AssetWatcher::Poll() {
+        auto readyChanges = List<Pair<String, PendingChange>>();
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            auto now = GetWatcherTime();
+            for (auto it = m_PendingChanges.begin(); it != m_PendingChanges.end();) {
+                if (now - it->second.LastEventTime < k_SettleTime) {
+                    ++it;
+                    continue;
+                }
+                readyChanges.emplace_back(it->first, std::move(it->second));
+                it = m_PendingChanges.erase(it);
+            }
+        }
+
+        for (const auto& [address, change] : readyChanges) {
+            ApplyChange(address, change);
+        }
+    }
+
+    void AssetWatcher::ApplyChange(const String& address, const PendingChange& change) {
+        auto assetManager = Services::Get<AssetManager>();
+        auto bundler = Services::Get<AssetBundler>();
+
+        if (!assetManager->AssetExists(address)) {
+            log::Info("AssetWatcher: new asset: {} will be added to bundle: {} on the next pack", address, change.BundleName);
+            return;
+        }
+
+        auto tags = assetManager->GetAssetTags(address);
+        auto payload = List<U8>();
+        if (!bundler->BuildAssetPayload(change.Path, tags, payload) || !assetManager->OverlayAsset(address, std::move(payload), tags)) {
+            log::Warn("AssetWatcher: failed to reload asset: {}", address);
+            return;
+        }
+
+        log::Info("AssetWatcher: reloaded asset: {}", address);
+
+        // fonts are only used through the atlases baked from them
+        auto changedAssets = List<String>{ address };
+        if ((tags & AssetTags::Font) == AssetTags::Font) {
+            for (auto& [atlasAddress, atlas] : bundler->BuildFontAtlasPayloads(address)) {
+                if (!assetManager->OverlayAsset(atlasAddress, std::move(atlas), assetManager->GetAssetTags(atlasAddress))) {
+                    log::Warn("AssetWatcher: failed to reload font atlas: {}", atlasAddress);
+                    continue;
+                }
+                log::Info("AssetWatcher: rebaked font atlas: {}", atlasAddress);
+                changedAssets.push_back(atlasAddress);
+            }
+        }
+
+        // everything built from the asset is stale as well (eg. shaders including it). Cached
+        // shaders are versioned by their sources and includes, CacheShaders recompiles the stale ones
+        auto dirtyAssets = assetManager->GetDependencyGraph().GetDirtySet(changedAssets);
+        auto rebuildShaders = false;
+        for (const auto& dirtyAddress : dirtyAssets) {
+            rebuildShaders |= (assetManager->GetAssetTags(dirtyAddress) & AssetTags::Shader) == AssetTags::Shader;
+        }
+
+        if (rebuildShaders) {
+            Services::Get<CacheManager>()->CacheShaders();
+        }
+
+        for (const auto& dirtyAddress : dirtyAssets) {
+            EventManager<EventType::AssetChanged, String, AssetTags>::Get()->RaiseEvent(dirtyAddress, assetManager->GetAssetTags(dirtyAddress));
+        }
+    }
+
+    void AssetWatcher::QueueChange(const WatchedDirectory& directory, const String& fileName) {
+        auto& change = m_PendingChanges[directory.AddressPrefix + fileName];
+        change.Path = directory.Path + "/" + fileName;
+        change.BundleName = directory.BundleName;
+        change.LastEventTime = GetWatcherTime();
+    }
+
+    void AssetWatcher::WatchDirectoryTree(const WatchedDirectory& directory) {
+#if defined(PLATFORM_LINUX)
+        // inotify is not recursive, every sub directory gets its own watch
+        auto handle = inotify_add_watch(m_NotifyHandle, directory.Path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (handle < 0) {
+            log::Warn("AssetWatcher: failed to watch directory: {}", directory.Path);
+            return;
+        }
+        m_Watches[handle] = directory;
+
+        for (const auto& entry : std::filesystem::directory_iterator(directory.Path)) {
+            if (entry.is_directory()) {
+                auto name = entry.path().filename().string();
+                WatchDirectoryTree({ directory.Path + "/" + name, directory.BundleName, directory.AddressPrefix + name + "/" });
+            }
+        }
+#endif
+    }
+
+    void AssetWatcher::PollModifiedTimes(Bool reportChanges) {
+        for (const auto& root : m_Roots) {
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(root.Path)) {
+                if (!entry.is_regular_file()) {
+                    continue;
+                }
+
+                auto path = entry.path().string();
+                auto modifiedTime = utils::GetFileModifiedTime(path);
+                auto [previous, inserted] = m_ModifiedTimes.try_emplace(path, modifiedTime);
+                if (!inserted && previous->second == modifiedTime) {
+                    continue;
+                }
+                previous->second = modifiedTime;
+
+                if (reportChanges) {
+                    auto relativePath = std::filesystem::relative(entry.path(), root.Path).generic_string();
+                    QueueChange(root, relativePath);
+                }
+            }
+        }
+    }
+
+    void AssetWatcher::WatchThread() {
+        while (m_Running) {
+#if defined(PLATFORM_LINUX)
+            if (m_NotifyHandle >= 0) {
+                auto descriptor = pollfd{ m_NotifyHandle, POLLIN, 0 };
+                if (poll(&descriptor, 1, k_NotifyTimeoutMs) <= 0) {
+                    continue;
+                }
+
+                alignas(inotify_event) char buffer[4096];
+                auto length = read(m_NotifyHandle, buffer, sizeof(buffer));
+                if (length <= 0) {
+                    continue;
+                }
+
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                for (auto position = buffer; position < buffer + length;) {
+                    auto event = reinterpret_cast<const inotify_event*>(position);
+                    position += sizeof(inotify_event) + event->len;
+
+                    auto watch = m_Watches.find(event->wd);
+                    if (watch == m_Watches.end() || event->len == 0) {
+                        continue;
+                    }
+
+                    auto directory = watch->second;
+                    auto name = String(event->name);
+                    if ((event->mask & IN_ISDIR) != 0) {
+                        if ((event->mask & (IN_CREATE | IN_MOVED_TO)) != 0) {
+                            WatchDirectoryTree({ directory.Path + "/" + name, directory.BundleName, directory.AddressPrefix + name + "/" });
+                        }
+                        continue;
+                    }
+
+                    // editors either rewrite the file in place or rename a temporary over it
+                    if ((event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) != 0) {
+                        QueueChange(directory, name);
+                    }
+                }
+                continue;
+            }
+#endif
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(k_ScanIntervalMs));
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            PollModifiedTimes(true);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,117 @@
+#include "services/assetmanager/FontAtlasBaker.hpp"
+
+#include <regex>
+
+#include "imgui.h"
+
+namespace tlc
+{
+    F32 GetFontSizeFromName(const String& name, F32 defaultSize)
+    {
+        static const std::regex s_SizeRegex(R"(\d+(\.\d+)?)");
+        std::smatch match;
+        if (std::regex_search(name, match, s_SizeRegex)) {
+            return std::stof(match.str(0));
+        }
+        return defaultSize;
+    }
+
+    Bool BakeFontAtlas(const List<FontAtlasSource>& sources, const FontAtlasSettings& settings, List<U8>& baked)
+    {
+        // lines and mouse cursors are not baked, the runtime atlas is created without them
+        auto atlas = ImFontAtlas();
+        atlas.Flags |= ImFontAtlasFlags_NoBakedLines | ImFontAtlasFlags_NoMouseCursors;
+
+        auto names = List<String>();
+        if (settings.includeDefaultFont) {
+            atlas.AddFontDefault();
+            names.emplace_back("default");
+        }
+
+        for (const auto& source : sources) {
+            auto fontData = utils::ReadBinaryFile(source.Path);
+            if (fontData.empty()) {
+                log::Warn("Failed to read font: {}, it will not be part of the atlas", source.Path);
+                continue;
+            }
+
+            // the atlas takes ownership of the data it is given
+            auto data = IM_ALLOC(fontData.size());
+            std::memcpy(data, fontData.data(), fontData.size());
+            if (atlas.AddFontFromMemoryTTF(data, static_cast<I32>(fontData.size()), GetFontSizeFromName(source.Name, settings.defaultSize)) == nullptr) {
+                log::Warn("Failed to add font: {} to the atlas", source.Path);
+                continue;
+            }
+            names.emplace_back(source.Name);
+        }
+
+        if (atlas.Fonts.Size == 0 || !atlas.Build()) {
+            log::Error("Failed to build font atlas");
+            return false;
+        }
+
+        U8* pixels = nullptr;
+        I32 width = 0;
+        I32 height = 0;
+        atlas.GetTexDataAsAlpha8(&pixels, &width, &height);
+
+        auto header = FontAtlasHeader();
+        header.Width = static_cast<U32>(width);
+        header.Height = static_cast<U32>(height);
+        header.FontCount = static_cast<U32>(atlas.Fonts.Size);
+        header.WhitePixelU = atlas.TexUvWhitePixel.x;
+        header.WhitePixelV = atlas.TexUvWhitePixel.y;
+
+        auto fonts = List<FontAtlasFont>();
+        auto glyphs = List<FontAtlasGlyph>();
+        auto stringTable = String();
+        for (I32 i = 0; i < atlas.Fonts.Size; i++) {
+            const auto font = atlas.Fonts[i];
+
+            auto fontRecord = FontAtlasFont();
+            fontRecord.NameOffset = static_cast<U32>(stringTable.size());
+            fontRecord.NameLength = static_cast<U32>(names[i].size());
+            fontRecord.FirstGlyph = static_cast<U32>(glyphs.size());
+            fontRecord.GlyphCount = static_cast<U32>(font->Glyphs.Size);
+            fontRecord.Size = font->FontSize;
+            fontRecord.Ascent = font->Ascent;
+            fontRecord.Descent = font->Descent;
+            fonts.push_back(fontRecord);
+            stringTable.append(names[i]);
+
+            for (const auto& glyph : font->Glyphs) {
+                auto glyphRecord = FontAtlasGlyph();
+                glyphRecord.Codepoint = glyph.Codepoint;
+                glyphRecord.AdvanceX = glyph.AdvanceX;
+                glyphRecord.X0 = glyph.X0;
+                glyphRecord.Y0 = glyph.Y0;
+                glyphRecord.X1 = glyph.X1;
+                glyphRecord.Y1 = glyph.Y1;
+                glyphRecord.U0 = glyph.U0;
+                glyphRecord.V0 = glyph.V0;
+                glyphRecord.U1 = glyph.U1;
+                glyphRecord.V1 = glyph.V1;
+                glyphs.push_back(glyphRecord);
+            }
+        }
+
+        header.GlyphCount = static_cast<U32>(glyphs.size());
+        header.StringTableSize = static_cast<U32>(stringTable.size());
+        header.PixelsOffset = AlignAssetOffset(sizeof(FontAtlasHeader) + fonts.size() * sizeof(FontAtlasFont) + glyphs.size() * sizeof(FontAtlasGlyph) + stringTable.size(), k_DefaultAssetAlignment);
+
+        auto pixelsSize = static_cast<Size>(width) * static_cast<Size>(height);
+        baked.assign(header.PixelsOffset + pixelsSize, 0);
+        auto output = baked.data();
+        std::memcpy(output, &header, sizeof(FontAtlasHeader));
+        output += sizeof(FontAtlasHeader);
+        std::memcpy(output, fonts.data(), fonts.size() * sizeof(FontAtlasFont));
+        output += fonts.size() * sizeof(FontAtlasFont);
+        std::memcpy(output, glyphs.data(), glyphs.size() * sizeof(FontAtlasGlyph));
+        output += glyphs.size() * sizeof(FontAtlasGlyph);
+        std::memcpy(output, stringTable.data(), stringTable.size());
+        std::memcpy(baked.data() + header.PixelsOffset, pixels, pixelsSize);
+
+        log::Info("Baked font atlas: {} fonts | {} glyphs | {}x{}", fonts.size(), glyphs.size(), width, height);
+        return true;
+    }
+}
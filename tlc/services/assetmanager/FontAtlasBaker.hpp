@@ -0,0 +1,34 @@
+#pragma once
+
+#include "core/Core.hpp"
+#include "services/assetmanager/AssetBundleFormat.hpp"
+
+namespace tlc
+{
+    struct FontAtlasSettings {
+        F32 defaultSize = 16.0f; // used unless the font address contains a size (eg. "Roboto-18.5.ttf")
+        Bool includeDefaultFont = true; // the builtin ImGui font, baked under the name "default"
+
+        inline FontAtlasSettings& SetDefaultSize(F32 size) { defaultSize = size; return *this; }
+        inline FontAtlasSettings& SetIncludeDefaultFont(Bool include) { includeDefaultFont = include; return *this; }
+
+        // Changes whenever the baked output would change, recorded in the bundle manifest
+        inline U32 GetFingerprint() const {
+            auto sizeBits = U32(0);
+            std::memcpy(&sizeBits, &defaultSize, sizeof(U32));
+            return sizeBits ^ (includeDefaultFont ? 0x80000000 : 0x0) ^ (k_FontAtlasVersion << 16);
+        }
+    };
+
+    struct FontAtlasSource {
+        String Name = ""; // address of the font asset
+        String Path = "";
+    };
+
+    // Rasterizes the fonts into a single atlas through ImGui's font builder and
+    // writes it out as a baked font atlas payload
+    Bool BakeFontAtlas(const List<FontAtlasSource>& sources, const FontAtlasSettings& settings, List<U8>& baked);
+
+    // Parses the size out of a font name, the first number (in the format xx.x) in it
+    F32 GetFontSizeFromName(const String& name, F32 defaultSize);
+}
@@ -0,0 +1,105 @@
+#include "services/assetmanager/ShaderPrecompiler.hpp"
+#include "core/Hash.hpp"
+
+namespace tlc
+{
+    String GetShaderVariantKey(const String& address, const List<String>& keywords)
+    {
+        auto sorted = keywords;
+        std::sort(sorted.begin(), sorted.end());
+        sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+        // shaders/lit.glsl|FOG|SKINNED
+        auto key = address;
+        for (const auto& keyword : sorted) {
+            key += "|" + keyword;
+        }
+        return key;
+    }
+
+    List<List<String>> GetShaderKeywordVariants(const List<List<String>>& keywordSets)
+    {
+        auto variants = List<List<String>>{ {} };
+        for (const auto& set : keywordSets) {
+            auto count = variants.size();
+            for (const auto& keyword : set) {
+                for (Size i = 0; i < count; i++) {
+                    auto variant = variants[i];
+                    variant.push_back(keyword);
+                    variants.push_back(std::move(variant));
+                }
+            }
+        }
+        return variants;
+    }
+
+    List<Pair<String, String>> GetShaderKeywordMacros(const List<String>& keywords)
+    {
+        auto macros = List<Pair<String, String>>();
+        for (const auto& keyword : keywords) {
+            macros.push_back({ keyword, "1" });
+        }
+        return macros;
+    }
+
+    U64 GetShaderModuleSourceHash(const String& address, const List<String>& includes, const std::function<U64(const String&)>& getPayloadHash)
+    {
+        auto hasher = Hasher();
+        hasher.UpdateValue(getPayloadHash(address));
+        hasher.UpdateValue(includes.size());
+        for (const auto& include : includes) {
+            hasher.UpdateValue(HashAssetAddress(include));
+            hasher.UpdateValue(getPayloadHash(include));
+        }
+        return hasher.Digest();
+    }
+
+    Bool BuildShaderModule(std::span<const U32> spirv, const ShaderModuleSources& sources, List<U8>& module)
+    {
+        auto reflection = ShaderReflection();
+        if (!ShaderReflection::Reflect(spirv, reflection)) {
+            return false;
+        }
+        auto reflectionData = reflection.Serialize();
+
+        auto stringTable = sources.Address + '\0';
+        for (const auto& include : sources.Includes) {
+            stringTable += include + '\0';
+        }
+
+        auto header = ShaderModuleHeader();
+        header.Stage = static_cast<U32>(reflection.Stage);
+        header.IncludeCount = static_cast<U32>(sources.Includes.size());
+        header.SourceHash = sources.SourceHash;
+        header.CompilerVersion = sources.CompilerVersion;
+        header.OptionsHash = sources.OptionsHash;
+        header.SpirvOffset = sizeof(ShaderModuleHeader);
+        header.SpirvSize = spirv.size_bytes();
+        header.ReflectionOffset = header.SpirvOffset + header.SpirvSize;
+        header.ReflectionSize = reflectionData.size();
+        header.StringTableOffset = header.ReflectionOffset + header.ReflectionSize;
+        header.StringTableSize = stringTable.size();
+
+        module.resize(header.StringTableOffset + header.StringTableSize);
+        std::memcpy(module.data(), &header, sizeof(ShaderModuleHeader));
+        std::memcpy(module.data() + header.SpirvOffset, spirv.data(), header.SpirvSize);
+        std::memcpy(module.data() + header.ReflectionOffset, reflectionData.data(), header.ReflectionSize);
+        std::memcpy(module.data() + header.StringTableOffset, stringTable.data(), header.StringTableSize);
+        return true;
+    }
+
+    ShaderModuleSources GetShaderModuleSources(const ShaderModuleHeader& header, Raw<const char> stringTable)
+    {
+        auto sources = ShaderModuleSources();
+        sources.SourceHash = header.SourceHash;
+        sources.CompilerVersion = header.CompilerVersion;
+        sources.OptionsHash = header.OptionsHash;
+
+        auto end = stringTable + header.StringTableSize;
+        sources.Address = String(stringTable);
+        for (auto string = stringTable + sources.Address.size() + 1; string < end; string += std::strlen(string) + 1) {
+            sources.Includes.emplace_back(string);
+        }
+        return sources;
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "core/Core.hpp"
+#include "core/ShaderReflection.hpp"
+#include "services/assetmanager/AssetBundleFormat.hpp"
+
+namespace tlc
+{
+    // What went into a compiled shader, recorded in its module
+    struct ShaderModuleSources {
+        String Address = ""; // of the shader
+        List<String> Includes; // by address, sorted
+        U64 SourceHash = 0; // see GetShaderModuleSourceHash
+        U64 CompilerVersion = 0;
+        U64 OptionsHash = 0;
+    };
+
+    // The cache key of a variant, the keywords in any order. Without keywords it is the address.
+    String GetShaderVariantKey(const String& address, const List<String>& keywords);
+
+    // Every combination of at most one keyword per set, the first one is the shader without keywords
+    List<List<String>> GetShaderKeywordVariants(const List<List<String>>& keywordSets);
+
+    // A variant is compiled with its keywords defined
+    List<Pair<String, String>> GetShaderKeywordMacros(const List<String>& keywords);
+
+    inline String GetShaderModuleAddress(const String& variantKey) {
+        return variantKey + k_ShaderModuleAddressSuffix;
+    }
+
+    // Hash of the shader and every file it includes, each by the hash of its payload
+    // (0 for addresses that do not exist). The bundler and the runtime pass their own lookup.
+    U64 GetShaderModuleSourceHash(const String& address, const List<String>& includes, const std::function<U64(const String&)>& getPayloadHash);
+
+    // Writes the SPIR-V out as a shader module payload along with its reflection,
+    // returns false if the SPIR-V could not be reflected
+    Bool BuildShaderModule(std::span<const U32> spirv, const ShaderModuleSources& sources, List<U8>& module);
+
+    // The source address and includes listed in a module validated by ReadShaderModule
+    ShaderModuleSources GetShaderModuleSources(const ShaderModuleHeader& header, Raw<const char> stringTable);
+}
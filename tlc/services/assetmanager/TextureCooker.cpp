@@ -0,0 +1,337 @@
+#include "services/assetmanager/TextureCooker.hpp"
+#include "utils/ImageUtils.hpp"
+
+namespace tlc
+{
+    namespace internal
+    {
+        static constexpr Size k_CookedTextureDataAlignment = 16;
+
+        static F32 SRGBToLinear(F32 value) {
+            return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+        }
+
+        static F32 LinearToSRGB(F32 value) {
+            return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+        }
+
+        static U8 QuantizeUnorm8(F32 value) {
+            return static_cast<U8>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+
+        // Halves one axis of a premultiplied RGBA32F image. Odd sizes use a three tap
+        // polyphase filter so every source texel contributes with the correct weight.
+        static void ReduceAxis(const List<F32>& source, U32 width, U32 height, Bool horizontal, List<F32>& destination) {
+            auto sourceLength = horizontal ? width : height;
+            auto length = std::max<U32>(sourceLength / 2, 1);
+            auto destinationWidth = horizontal ? length : width;
+            auto destinationHeight = horizontal ? height : length;
+            destination.assign(static_cast<Size>(destinationWidth) * destinationHeight * 4, 0.0f);
+
+            auto texel = [&](U32 line, U32 index) -> const F32* {
+                auto x = horizontal ? index : line;
+                auto y = horizontal ? line : index;
+                return source.data() + (static_cast<Size>(y) * width + x) * 4;
+            };
+
+            auto numLines = horizontal ? height : width;
+            for (U32 line = 0; line < numLines; line++) {
+                for (U32 i = 0; i < length; i++) {
+                    auto x = horizontal ? i : line;
+                    auto y = horizontal ? line : i;
+                    auto output = destination.data() + (static_cast<Size>(y) * destinationWidth + x) * 4;
+
+                    if (sourceLength == 1) {
+                        std::memcpy(output, texel(line, 0), sizeof(F32) * 4);
+                    }
+                    else if (sourceLength % 2 == 0) {
+                        auto a = texel(line, 2 * i);
+                        auto b = texel(line, 2 * i + 1);
+                        for (U32 c = 0; c < 4; c++) {
+                            output[c] = 0.5f * (a[c] + b[c]);
+                        }
+                    }
+                    else {
+                        auto scale = 1.0f / static_cast<F32>(2 * length + 1);
+                        auto weightA = static_cast<F32>(length - i) * scale;
+                        auto weightB = static_cast<F32>(length) * scale;
+                        auto weightC = static_cast<F32>(i + 1) * scale;
+                        auto a = texel(line, 2 * i);
+                        auto b = texel(line, 2 * i + 1);
+                        auto c = texel(line, 2 * i + 2);
+                        for (U32 channel = 0; channel < 4; channel++) {
+                            output[channel] = weightA * a[channel] + weightB * b[channel] + weightC * c[channel];
+                        }
+                    }
+                }
+            }
+        }
+
+        static void EncodeRGBA8(const List<F32>& texels, Bool srgb, List<U8>& output) {
+            output.resize(texels.size());
+            for (Size i = 0; i < texels.size(); i += 4) {
+                auto alpha = texels[i + 3];
+                auto inverseAlpha = alpha > 0.0f ? 1.0f / alpha : 0.0f;
+                for (U32 c = 0; c < 3; c++) {
+                    auto value = texels[i + c] * inverseAlpha;
+                    output[i + c] = QuantizeUnorm8(srgb ? LinearToSRGB(std::clamp(value, 0.0f, 1.0f)) : value);
+                }
+                output[i + 3] = QuantizeUnorm8(alpha);
+            }
+        }
+
+        static inline U16 PackRGB565(const F32* color) {
+            auto r = static_cast<U16>(std::clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+            auto g = static_cast<U16>(std::clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f + 0.5f);
+            auto b = static_cast<U16>(std::clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+            return static_cast<U16>((r << 11) | (g << 5) | b);
+        }
+
+        static inline void UnpackRGB565(U16 packed, I32* color) {
+            auto r = (packed >> 11) & 0x1f;
+            auto g = (packed >> 5) & 0x3f;
+            auto b = packed & 0x1f;
+            color[0] = (r << 3) | (r >> 2);
+            color[1] = (g << 2) | (g >> 4);
+            color[2] = (b << 3) | (b >> 2);
+        }
+
+        // Encodes a single 4x4 block, endpoints are picked along the principal axis of the
+        // block colors and inset slightly to reduce the error of the interpolated entries
+        static void EncodeBC1Block(const U8 (&pixels)[16][4], U8* output) {
+            static constexpr U8 k_AlphaThreshold = 128;
+
+            Bool hasTransparency = false;
+            U32 numOpaque = 0;
+            F32 mean[3] = {};
+            for (const auto& pixel : pixels) {
+                if (pixel[3] < k_AlphaThreshold) {
+                    hasTransparency = true;
+                    continue;
+                }
+                numOpaque++;
+                for (U32 c = 0; c < 3; c++) {
+                    mean[c] += pixel[c];
+                }
+            }
+
+            if (numOpaque == 0) {
+                // color0 <= color1 selects the three color mode, index 3 is transparent black
+                std::memset(output, 0, 4);
+                std::memset(output + 4, 0xff, 4);
+                return;
+            }
+
+            for (auto& value : mean) {
+                value /= static_cast<F32>(numOpaque);
+            }
+
+            F32 covariance[6] = {};
+            for (const auto& pixel : pixels) {
+                if (pixel[3] < k_AlphaThreshold) {
+                    continue;
+                }
+                auto r = pixel[0] - mean[0];
+                auto g = pixel[1] - mean[1];
+                auto b = pixel[2] - mean[2];
+                covariance[0] += r * r;
+                covariance[1] += r * g;
+                covariance[2] += r * b;
+                covariance[3] += g * g;
+                covariance[4] += g * b;
+                covariance[5] += b * b;
+            }
+
+            F32 axis[3] = { 1.0f, 1.0f, 1.0f };
+            for (U32 iteration = 0; iteration < 8; iteration++) {
+                F32 next[3] = {
+                    covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+                    covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+                    covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2],
+                };
+                auto length = std::max({ std::abs(next[0]), std::abs(next[1]), std::abs(next[2]) });
+                if (length < 1e-6f) {
+                    break;
+                }
+                for (U32 c = 0; c < 3; c++) {
+                    axis[c] = next[c] / length;
+                }
+            }
+
+            auto minProjection = std::numeric_limits<F32>::max();
+            auto maxProjection = std::numeric_limits<F32>::lowest();
+            for (const auto& pixel : pixels) {
+                if (pixel[3] < k_AlphaThreshold) {
+                    continue;
+                }
+                auto projection = (pixel[0] - mean[0]) * axis[0] + (pixel[1] - mean[1]) * axis[1] + (pixel[2] - mean[2]) * axis[2];
+                minProjection = std::min(minProjection, projection);
+                maxProjection = std::max(maxProjection, projection);
+            }
+
+            auto axisLengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+            auto inset = (maxProjection - minProjection) / 16.0f;
+            F32 endpointA[3];
+            F32 endpointB[3];
+            for (U32 c = 0; c < 3; c++) {
+                endpointA[c] = mean[c] + axis[c] * (maxProjection - inset) / axisLengthSquared;
+                endpointB[c] = mean[c] + axis[c] * (minProjection + inset) / axisLengthSquared;
+            }
+
+            auto color0 = PackRGB565(endpointA);
+            auto color1 = PackRGB565(endpointB);
+            if (hasTransparency ? color0 > color1 : color0 < color1) {
+                std::swap(color0, color1);
+            }
+
+            I32 palette[4][3] = {};
+            UnpackRGB565(color0, palette[0]);
+            UnpackRGB565(color1, palette[1]);
+            auto numColors = 4u;
+            if (hasTransparency) {
+                numColors = 3;
+                for (U32 c = 0; c < 3; c++) {
+                    palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                }
+            }
+            else {
+                for (U32 c = 0; c < 3; c++) {
+                    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+                }
+            }
+
+            U32 indices = 0;
+            if (color0 != color1 || hasTransparency) {
+                for (U32 i = 0; i < 16; i++) {
+                    auto best = 3u;
+                    if (!hasTransparency || pixels[i][3] >= k_AlphaThreshold) {
+                        auto bestError = std::numeric_limits<I32>::max();
+                        for (U32 entry = 0; entry < numColors; entry++) {
+                            auto dr = pixels[i][0] - palette[entry][0];
+                            auto dg = pixels[i][1] - palette[entry][1];
+                            auto db = pixels[i][2] - palette[entry][2];
+                            auto error = dr * dr + dg * dg + db * db;
+                            if (error < bestError) {
+                                bestError = error;
+                                best = entry;
+                            }
+                        }
+                    }
+                    indices |= best << (2 * i);
+                }
+            }
+
+            output[0] = static_cast<U8>(color0 & 0xff);
+            output[1] = static_cast<U8>(color0 >> 8);
+            output[2] = static_cast<U8>(color1 & 0xff);
+            output[3] = static_cast<U8>(color1 >> 8);
+            for (U32 i = 0; i < 4; i++) {
+                output[4 + i] = static_cast<U8>((indices >> (8 * i)) & 0xff);
+            }
+        }
+
+        static void EncodeBC1(const List<U8>& rgba, U32 width, U32 height, List<U8>& output) {
+            auto blocksX = (width + 3) / 4;
+            auto blocksY = (height + 3) / 4;
+            output.resize(static_cast<Size>(blocksX) * blocksY * 8);
+
+            U8 pixels[16][4];
+            for (U32 blockY = 0; blockY < blocksY; blockY++) {
+                for (U32 blockX = 0; blockX < blocksX; blockX++) {
+                    // blocks overhanging the edge repeat the last row and column
+                    for (U32 i = 0; i < 16; i++) {
+                        auto x = std::min(blockX * 4 + i % 4, width - 1);
+                        auto y = std::min(blockY * 4 + i / 4, height - 1);
+                        std::memcpy(pixels[i], rgba.data() + (static_cast<Size>(y) * width + x) * 4, 4);
+                    }
+                    EncodeBC1Block(pixels, output.data() + (static_cast<Size>(blockY) * blocksX + blockX) * 8);
+                }
+            }
+        }
+    }
+
+    Bool CookTexture(const U8* data, Size size, const TextureCookSettings& settings, List<U8>& cooked)
+    {
+        auto rgba = List<U8>();
+        U32 width = 0;
+        U32 height = 0;
+        if (!utils::DecodePng(data, size, rgba, width, height)) {
+            return false;
+        }
+
+        auto numMips = 1u;
+        if (settings.generateMips) {
+            while (numMips < k_MaxCookedTextureMips && ((width >> numMips) > 0 || (height >> numMips) > 0)) {
+                numMips++;
+            }
+        }
+
+        auto header = CookedTextureHeader();
+        header.Format = settings.format;
+        header.Flags = settings.srgb ? k_CookedTextureFlagSRGB : 0;
+        header.Width = width;
+        header.Height = height;
+        header.MipCount = numMips;
+
+        auto mips = List<CookedTextureMip>(numMips);
+        auto mipData = List<List<U8>>(numMips);
+
+        // mips are filtered from the full precision previous level in linear, premultiplied space
+        static const auto s_SRGBToLinear = [] {
+            auto table = Array<F32, 256>();
+            for (U32 i = 0; i < 256; i++) {
+                table[i] = internal::SRGBToLinear(static_cast<F32>(i) / 255.0f);
+            }
+            return table;
+        }();
+
+        auto texels = List<F32>(rgba.size());
+        for (Size i = 0; i < rgba.size(); i += 4) {
+            auto alpha = static_cast<F32>(rgba[i + 3]) / 255.0f;
+            for (U32 c = 0; c < 3; c++) {
+                auto value = settings.srgb ? s_SRGBToLinear[rgba[i + c]] : static_cast<F32>(rgba[i + c]) / 255.0f;
+                texels[i + c] = value * alpha;
+            }
+            texels[i + 3] = alpha;
+        }
+
+        auto mipWidth = width;
+        auto mipHeight = height;
+        auto scratch = List<F32>();
+        for (U32 level = 0; level < numMips; level++) {
+            if (level > 0) {
+                internal::ReduceAxis(texels, mipWidth, mipHeight, true, scratch);
+                mipWidth = std::max<U32>(mipWidth / 2, 1);
+                internal::ReduceAxis(scratch, mipWidth, mipHeight, false, texels);
+                mipHeight = std::max<U32>(mipHeight / 2, 1);
+                internal::EncodeRGBA8(texels, settings.srgb, rgba);
+            }
+
+            mips[level].Width = mipWidth;
+            mips[level].Height = mipHeight;
+            if (settings.format == CookedTextureFormat::BC1) {
+                internal::EncodeBC1(rgba, mipWidth, mipHeight, mipData[level]);
+            }
+            else {
+                mipData[level] = rgba;
+            }
+        }
+
+        auto offset = AlignAssetOffset(sizeof(CookedTextureHeader) + numMips * sizeof(CookedTextureMip), internal::k_CookedTextureDataAlignment);
+        for (U32 level = 0; level < numMips; level++) {
+            mips[level].Offset = offset;
+            mips[level].Size = mipData[level].size();
+            offset = AlignAssetOffset(offset + mips[level].Size, internal::k_CookedTextureDataAlignment);
+        }
+
+        cooked.assign(offset, 0);
+        std::memcpy(cooked.data(), &header, sizeof(CookedTextureHeader));
+        std::memcpy(cooked.data() + sizeof(CookedTextureHeader), mips.data(), numMips * sizeof(CookedTextureMip));
+        for (U32 level = 0; level < numMips; level++) {
+            std::memcpy(cooked.data() + mips[level].Offset, mipData[level].data(), mipData[level].size());
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "core/Core.hpp"
+#include "services/assetmanager/AssetBundleFormat.hpp"
+
+namespace tlc
+{
+    struct TextureCookSettings {
+        Bool enabled = true;
+        Bool generateMips = true;
+        Bool srgb = true; // color data, mips are filtered in linear space
+        CookedTextureFormat format = CookedTextureFormat::RGBA8;
+
+        inline TextureCookSettings& SetEnabled(Bool e) { enabled = e; return *this; }
+        inline TextureCookSettings& SetGenerateMips(Bool g) { generateMips = g; return *this; }
+        inline TextureCookSettings& SetSRGB(Bool s) { srgb = s; return *this; }
+        inline TextureCookSettings& SetFormat(CookedTextureFormat f) { format = f; return *this; }
+
+        // Changes whenever the cooked output would change, recorded in the bundle manifest
+        inline U32 GetFingerprint() const {
+            if (!enabled) {
+                return 0;
+            }
+            return 0x1
+                | (generateMips ? 0x2 : 0x0)
+                | (srgb ? 0x4 : 0x0)
+                | (static_cast<U32>(format) << 8)
+                | (k_CookedTextureVersion << 16);
+        }
+    };
+
+    // Decodes an image and writes it out as a cooked texture payload,
+    // returns false if the source format is not supported.
+    Bool CookTexture(const U8* data, Size size, const TextureCookSettings& settings, List<U8>& cooked);
+}
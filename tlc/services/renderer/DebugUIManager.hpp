@@ -53,6 +53,8 @@ namespace tlc {
         void RenderFrame(vk::CommandBuffer& commandBuffer, F32 deltaTime, U32 displayWidth, U32 displayHeight);
 
         void PrepareFontTexture();
+        Bool LoadFontAtlas(const String& address);
+        void BuildFontAtlas();
         void CreateFontTextureDescriptors();
         void CreateGraphicsPipeline();
         void CreateBuffers();
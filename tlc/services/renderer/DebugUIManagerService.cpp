@@ -2,11 +2,10 @@
 #include "services/renderer/PresentationRenderer.hpp"
 #include "services/renderer/VulkanManager.hpp"
 #include "services/assetmanager/AssetManager.hpp"
+#include "services/assetmanager/FontAtlasBaker.hpp"
 #include "services/CacheManager.hpp"
 #include "core/Window.hpp"
 
-#include <regex>
-
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 
@@ -69,38 +68,91 @@ namespace tlc {
         CreateBuffers();
     }
 
-    void DebugUIManager::PrepareFontTexture() {
+    Bool DebugUIManager::LoadFontAtlas(const String& address) {
+        auto assetManager = Services::Get<AssetManager>();
+        auto& io = ImGui::GetIO(); (void)io;
+
+        Size atlasDataSize = 0;
+        auto atlasData = assetManager->GetAssetDataRaw(address, atlasDataSize);
+
+        Raw<const FontAtlasHeader> header = nullptr;
+        Raw<const FontAtlasFont> fonts = nullptr;
+        Raw<const FontAtlasGlyph> glyphs = nullptr;
+        Raw<const char> stringTable = nullptr;
+        if (!ReadFontAtlas(atlasData, atlasDataSize, header, fonts, glyphs, stringTable) || header->FontCount == 0) {
+            log::Warn("Font atlas: {} is invalid", address);
+            return false;
+        }
+
+        // rebuild the fonts from the baked glyph tables, nothing is rasterized here
+        io.Fonts->Clear();
+        io.Fonts->Flags |= ImFontAtlasFlags_NoBakedLines | ImFontAtlasFlags_NoMouseCursors;
+        for (U32 i = 0; i < header->FontCount; i++) {
+            const auto& fontRecord = fonts[i];
+            auto font = IM_NEW(ImFont)();
+            font->FontSize = fontRecord.Size;
+            font->Ascent = fontRecord.Ascent;
+            font->Descent = fontRecord.Descent;
+            font->ContainerAtlas = io.Fonts;
+            for (U32 j = 0; j < fontRecord.GlyphCount; j++) {
+                const auto& glyph = glyphs[fontRecord.FirstGlyph + j];
+                font->AddGlyph(nullptr, static_cast<ImWchar>(glyph.Codepoint), glyph.X0, glyph.Y0, glyph.X1, glyph.Y1, glyph.U0, glyph.V0, glyph.U1, glyph.V1, glyph.AdvanceX);
+            }
+            font->BuildLookupTable();
+            io.Fonts->Fonts.push_back(font);
+            m_Fonts.insert_or_assign(String(stringTable + fontRecord.NameOffset, fontRecord.NameLength), font);
+        }
+
+        // the atlas frees its pixels itself, so they are copied out of the mapped bundle
+        auto pixelsSize = static_cast<Size>(header->Width) * header->Height;
+        io.Fonts->TexPixelsAlpha8 = static_cast<U8*>(IM_ALLOC(pixelsSize));
+        std::memcpy(io.Fonts->TexPixelsAlpha8, atlasData + header->PixelsOffset, pixelsSize);
+        io.Fonts->TexWidth = static_cast<I32>(header->Width);
+        io.Fonts->TexHeight = static_cast<I32>(header->Height);
+        io.Fonts->TexUvScale = ImVec2(1.0f / static_cast<F32>(header->Width), 1.0f / static_cast<F32>(header->Height));
+        io.Fonts->TexUvWhitePixel = ImVec2(header->WhitePixelU, header->WhitePixelV);
+        io.Fonts->TexReady = true;
+
+        log::Info("Loaded font atlas: {} | {} fonts | {} glyphs", address, header->FontCount, header->GlyphCount);
+        return true;
+    }
+
+    void DebugUIManager::BuildFontAtlas() {
         auto assetManager = Services::Get<AssetManager>();
-        auto vulkan = Services::Get<VulkanManager>();
-        auto device = vulkan->GetDevice();
-        
         auto& io = ImGui::GetIO(); (void)io;
 
-            
         auto fonts = assetManager->GetAssetsWithTagsInBundle(AssetTags::Font, "debug");
         m_Fonts.insert_or_assign("default", io.Fonts->AddFontDefault());
         for (const auto& font : fonts) {
             Size fontDataSize = 0;
             auto fontAsset = assetManager->GetAssetDataRaw(font, fontDataSize);
             if (fontAsset != nullptr) {
-                // check if there is a number(in the format xx.x) in the font name if so use it as the font size
-                // using regex to find the number
-                std::regex regex(R"(\d+(\.\d+)?)");
-                std::smatch match;
-                auto fontSize = 16.0f;
-                if (std::regex_search(font, match, regex)) {
-                    fontSize = std::stof(match.str(0));
-                }
-                auto dataCloned = (U8*)IM_ALLOC(fontDataSize);
-                memcpy(dataCloned, fontAsset, fontDataSize);
-                // Transfers the ownership of the font data
-                auto fontPtr = io.Fonts->AddFontFromMemoryTTF(dataCloned, static_cast<I32>(fontDataSize), fontSize);
+                // The font is read straight from the mapped bundle, the atlas
+                // only reads from it and must not take ownership of it
+                auto fontConfig = ImFontConfig();
+                fontConfig.FontDataOwnedByAtlas = false;
+                auto fontPtr = io.Fonts->AddFontFromMemoryTTF(const_cast<U8*>(fontAsset), static_cast<I32>(fontDataSize), GetFontSizeFromName(font, 16.0f), &fontConfig);
                 m_Fonts.insert_or_assign(font, fontPtr);
             }
         }
         if(!io.Fonts->Build()) {
             log::Error("Failed to build font atlas");
         }
+    }
+
+    void DebugUIManager::PrepareFontTexture() {
+        auto assetManager = Services::Get<AssetManager>();
+        auto vulkan = Services::Get<VulkanManager>();
+        auto device = vulkan->GetDevice();
+        
+        auto& io = ImGui::GetIO(); (void)io;
+
+        // fonts are baked into an atlas by the AssetBundler, rasterizing them here is only a fallback
+        auto atlases = assetManager->GetAssetsWithTagsInBundle(AssetTags::FontAtlas, "debug");
+        if (atlases.empty() || !LoadFontAtlas(atlases.front())) {
+            log::Warn("No baked font atlas found, rasterizing fonts at startup");
+            BuildFontAtlas();
+        }
 
 
         U8* fontAtlasData = nullptr;
@@ -182,24 +234,42 @@ namespace tlc {
         auto device = vulkan->GetDevice();
 
         auto vertShaderModule = device->CreateShaderModule(
-            cacheManager->GetCacheDataTyped<U32>("shaders/imgui/ui.vert.glsl")
+            cacheManager->PinShaderCode("shaders/imgui/ui.vert.glsl").As<U32>()
         );
 
         auto fragShaderModule = device->CreateShaderModule(
-            cacheManager->GetCacheDataTyped<U32>("shaders/imgui/ui.frag.glsl")
+            cacheManager->PinShaderCode("shaders/imgui/ui.frag.glsl").As<U32>()
         );
 
+        // push constants and the font sampler come from the shaders, the reflected layout of the
+        // sampler is the one of the font descriptor set as equal layouts are shared by the device.
+        // The vertex layout is ImGui's own (the color is packed), so it stays explicit.
+        auto vertReflection = ShaderReflection();
+        auto fragReflection = ShaderReflection();
+        auto reflected = cacheManager->GetShaderReflection("shaders/imgui/ui.vert.glsl", vertReflection)
+            && cacheManager->GetShaderReflection("shaders/imgui/ui.frag.glsl", fragReflection);
+
         auto pipelineSettings = VulkanGraphicsPipelineSettings()
             .SetRenderPass(presentationRenderer->GetRenderPass())
             .SetExtent(vk::Extent2D()
                 .setHeight(100)
                 .setWidth(100))
             .SetVertexInputAttributeDescriptions<ImGuiVertex>()
-            .AddPushConstantRange(vk::ShaderStageFlagBits::eVertex, 0, sizeof(ImGuiPushConstants))
-            .AddDescriptorSetLayout(m_FontDescriptorSetLayout)
             .SetVertexShaderModule(vertShaderModule)
             .SetFragmentShaderModule(fragShaderModule);
 
+        if (reflected) {
+            pipelineSettings
+                .AddShaderReflection(vertReflection)
+                .AddShaderReflection(fragReflection);
+        }
+        else {
+            log::Error("Failed to reflect the debug UI shaders, using the fixed pipeline layout");
+            pipelineSettings
+                .AddPushConstantRange(vk::ShaderStageFlagBits::eVertex, 0, sizeof(ImGuiPushConstants))
+                .AddDescriptorSetLayout(m_FontDescriptorSetLayout);
+        }
+
         m_Pipeline = CreateRef<VulkanGraphicsPipeline>(device, pipelineSettings);
     }
 
@@ -343,18 +343,33 @@ namespace tlc {
         auto device = vulkan->GetDevice();
 
         auto vertShaderModule = device->CreateShaderModule(
-            cacheManager->GetCacheDataTyped<U32>("shaders/presentation/vert.glsl")
+            cacheManager->PinShaderCode("shaders/presentation/vert.glsl").As<U32>()
         );
         auto fragShaderModule = device->CreateShaderModule(
-            cacheManager->GetCacheDataTyped<U32>("shaders/presentation/frag.glsl")
+            cacheManager->PinShaderCode("shaders/presentation/frag.glsl").As<U32>()
         );
 
+        // the push constant range comes from the shaders
+        auto vertReflection = ShaderReflection();
+        auto fragReflection = ShaderReflection();
+        auto reflected = cacheManager->GetShaderReflection("shaders/presentation/vert.glsl", vertReflection)
+            && cacheManager->GetShaderReflection("shaders/presentation/frag.glsl", fragReflection);
+
         auto pipelineSettings = VulkanGraphicsPipelineSettings()
             .SetRenderPass(m_RenderPass)
             .SetVertexShaderModule(vertShaderModule)
             .SetFragmentShaderModule(fragShaderModule)
-            .SetExtent(vulkan->GetSwapchain()->GetExtent())
-            .AddPushConstantRange(vk::ShaderStageFlagBits::eVertex, 0, sizeof(PresentationPipelineConfig));
+            .SetExtent(vulkan->GetSwapchain()->GetExtent());
+
+        if (reflected) {
+            pipelineSettings
+                .AddShaderReflection(vertReflection)
+                .AddShaderReflection(fragReflection);
+        }
+        else {
+            log::Error("Failed to reflect the presentation shaders, using the fixed pipeline layout");
+            pipelineSettings.AddPushConstantRange(vk::ShaderStageFlagBits::eVertex, 0, sizeof(PresentationPipelineConfig));
+        }
 
         m_Pipeline = CreateScope<VulkanGraphicsPipeline>(
             device, 
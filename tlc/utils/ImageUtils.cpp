@@ -0,0 +1,503 @@
+#include "utils/ImageUtils.hpp"
+
+namespace tlc
+{
+    namespace utils
+    {
+        namespace internal
+        {
+            struct InflateBitReader {
+                const U8* data = nullptr;
+                Size size = 0;
+                Size position = 0;
+                U32 bitBuffer = 0;
+                U32 bitCount = 0;
+                Bool overflow = false;
+
+                inline U32 Bits(U32 count) {
+                    while (bitCount < count) {
+                        if (position >= size) {
+                            overflow = true;
+                            return 0;
+                        }
+                        bitBuffer |= static_cast<U32>(data[position++]) << bitCount;
+                        bitCount += 8;
+                    }
+                    auto value = bitBuffer & ((1u << count) - 1);
+                    bitBuffer >>= count;
+                    bitCount -= count;
+                    return value;
+                }
+            };
+
+            static constexpr U32 k_MaxCodeBits = 15;
+
+            // Canonical huffman table, symbols are sorted by code length
+            struct InflateHuffman {
+                U16 counts[k_MaxCodeBits + 1] = {};
+                U16 symbols[288] = {};
+            };
+
+            static Bool BuildHuffman(InflateHuffman& huffman, const U8* lengths, U32 numSymbols) {
+                std::memset(huffman.counts, 0, sizeof(huffman.counts));
+                for (U32 symbol = 0; symbol < numSymbols; symbol++) {
+                    huffman.counts[lengths[symbol]]++;
+                }
+
+                // reject over-subscribed codes, incomplete codes are allowed
+                I32 left = 1;
+                for (U32 length = 1; length <= k_MaxCodeBits; length++) {
+                    left <<= 1;
+                    left -= huffman.counts[length];
+                    if (left < 0) {
+                        return false;
+                    }
+                }
+
+                U16 offsets[k_MaxCodeBits + 1] = {};
+                for (U32 length = 1; length < k_MaxCodeBits; length++) {
+                    offsets[length + 1] = offsets[length] + huffman.counts[length];
+                }
+
+                for (U32 symbol = 0; symbol < numSymbols; symbol++) {
+                    if (lengths[symbol] != 0) {
+                        huffman.symbols[offsets[lengths[symbol]]++] = static_cast<U16>(symbol);
+                    }
+                }
+                return true;
+            }
+
+            static I32 DecodeSymbol(InflateBitReader& reader, const InflateHuffman& huffman) {
+                I32 code = 0;
+                I32 first = 0;
+                I32 index = 0;
+                for (U32 length = 1; length <= k_MaxCodeBits; length++) {
+                    code |= static_cast<I32>(reader.Bits(1));
+                    I32 count = huffman.counts[length];
+                    if (code - count < first) {
+                        return huffman.symbols[index + (code - first)];
+                    }
+                    index += count;
+                    first += count;
+                    first <<= 1;
+                    code <<= 1;
+                }
+                return -1;
+            }
+
+            static constexpr U16 k_LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+            static constexpr U8 k_LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+            static constexpr U16 k_DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+            static constexpr U8 k_DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+            static Bool InflateCodes(InflateBitReader& reader, const InflateHuffman& lengthCodes, const InflateHuffman& distanceCodes, List<U8>& output) {
+                while (true) {
+                    auto symbol = DecodeSymbol(reader, lengthCodes);
+                    if (symbol < 0 || reader.overflow) {
+                        return false;
+                    }
+
+                    if (symbol < 256) {
+                        output.push_back(static_cast<U8>(symbol));
+                        continue;
+                    }
+
+                    if (symbol == 256) {
+                        return true;
+                    }
+
+                    symbol -= 257;
+                    if (symbol >= 29) {
+                        return false;
+                    }
+                    auto length = k_LengthBase[symbol] + reader.Bits(k_LengthExtra[symbol]);
+
+                    auto distanceSymbol = DecodeSymbol(reader, distanceCodes);
+                    if (distanceSymbol < 0 || distanceSymbol >= 30) {
+                        return false;
+                    }
+                    auto distance = k_DistanceBase[distanceSymbol] + reader.Bits(k_DistanceExtra[distanceSymbol]);
+                    if (reader.overflow || distance > output.size()) {
+                        return false;
+                    }
+
+                    // byte by byte since the source and destination ranges may overlap
+                    auto source = output.size() - distance;
+                    for (U32 i = 0; i < length; i++) {
+                        output.push_back(output[source + i]);
+                    }
+                }
+            }
+
+            static Bool InflateStored(InflateBitReader& reader, List<U8>& output) {
+                // stored blocks start at a byte boundary
+                reader.bitBuffer = 0;
+                reader.bitCount = 0;
+
+                if (reader.position + 4 > reader.size) {
+                    return false;
+                }
+                auto length = static_cast<U32>(reader.data[reader.position]) | (static_cast<U32>(reader.data[reader.position + 1]) << 8);
+                auto inverse = static_cast<U32>(reader.data[reader.position + 2]) | (static_cast<U32>(reader.data[reader.position + 3]) << 8);
+                reader.position += 4;
+
+                if (length != (~inverse & 0xffff) || reader.position + length > reader.size) {
+                    return false;
+                }
+
+                output.insert(output.end(), reader.data + reader.position, reader.data + reader.position + length);
+                reader.position += length;
+                return true;
+            }
+
+            static Bool InflateFixed(InflateBitReader& reader, List<U8>& output) {
+                static InflateHuffman s_LengthCodes;
+                static InflateHuffman s_DistanceCodes;
+                static Bool s_Built = [] {
+                    U8 lengths[288] = {};
+                    for (U32 symbol = 0; symbol < 144; symbol++) lengths[symbol] = 8;
+                    for (U32 symbol = 144; symbol < 256; symbol++) lengths[symbol] = 9;
+                    for (U32 symbol = 256; symbol < 280; symbol++) lengths[symbol] = 7;
+                    for (U32 symbol = 280; symbol < 288; symbol++) lengths[symbol] = 8;
+                    BuildHuffman(s_LengthCodes, lengths, 288);
+
+                    for (U32 symbol = 0; symbol < 30; symbol++) lengths[symbol] = 5;
+                    BuildHuffman(s_DistanceCodes, lengths, 30);
+                    return true;
+                }();
+                (void)s_Built;
+
+                return InflateCodes(reader, s_LengthCodes, s_DistanceCodes, output);
+            }
+
+            static Bool InflateDynamic(InflateBitReader& reader, List<U8>& output) {
+                static constexpr U8 k_CodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+                auto numLengthCodes = reader.Bits(5) + 257;
+                auto numDistanceCodes = reader.Bits(5) + 1;
+                auto numCodeLengthCodes = reader.Bits(4) + 4;
+                if (numLengthCodes > 286 || numDistanceCodes > 30) {
+                    return false;
+                }
+
+                U8 lengths[320] = {};
+                for (U32 i = 0; i < numCodeLengthCodes; i++) {
+                    lengths[k_CodeLengthOrder[i]] = static_cast<U8>(reader.Bits(3));
+                }
+
+                auto codeLengthCodes = InflateHuffman();
+                if (!BuildHuffman(codeLengthCodes, lengths, 19)) {
+                    return false;
+                }
+
+                U32 index = 0;
+                while (index < numLengthCodes + numDistanceCodes) {
+                    auto symbol = DecodeSymbol(reader, codeLengthCodes);
+                    if (symbol < 0 || reader.overflow) {
+                        return false;
+                    }
+
+                    if (symbol < 16) {
+                        lengths[index++] = static_cast<U8>(symbol);
+                        continue;
+                    }
+
+                    U8 length = 0;
+                    U32 repeat = 0;
+                    if (symbol == 16) {
+                        if (index == 0) {
+                            return false;
+                        }
+                        length = lengths[index - 1];
+                        repeat = 3 + reader.Bits(2);
+                    }
+                    else if (symbol == 17) {
+                        repeat = 3 + reader.Bits(3);
+                    }
+                    else {
+                        repeat = 11 + reader.Bits(7);
+                    }
+
+                    if (index + repeat > numLengthCodes + numDistanceCodes) {
+                        return false;
+                    }
+                    while (repeat-- > 0) {
+                        lengths[index++] = length;
+                    }
+                }
+
+                // the end of block code must be present
+                if (lengths[256] == 0) {
+                    return false;
+                }
+
+                auto lengthCodes = InflateHuffman();
+                auto distanceCodes = InflateHuffman();
+                if (!BuildHuffman(lengthCodes, lengths, numLengthCodes) || !BuildHuffman(distanceCodes, lengths + numLengthCodes, numDistanceCodes)) {
+                    return false;
+                }
+
+                return InflateCodes(reader, lengthCodes, distanceCodes, output);
+            }
+
+            static U32 Adler32(const U8* data, Size size) {
+                U32 a = 1;
+                U32 b = 0;
+                while (size > 0) {
+                    // largest block that cannot overflow before the modulo
+                    auto blockSize = std::min<Size>(size, 5552);
+                    size -= blockSize;
+                    while (blockSize-- > 0) {
+                        a += *data++;
+                        b += a;
+                    }
+                    a %= 65521;
+                    b %= 65521;
+                }
+                return (b << 16) | a;
+            }
+
+            static inline U32 ReadBigEndianU32(const U8* data) {
+                return (static_cast<U32>(data[0]) << 24) | (static_cast<U32>(data[1]) << 16) | (static_cast<U32>(data[2]) << 8) | static_cast<U32>(data[3]);
+            }
+
+            static inline U8 PaethPredictor(I32 a, I32 b, I32 c) {
+                auto p = a + b - c;
+                auto pa = std::abs(p - a);
+                auto pb = std::abs(p - b);
+                auto pc = std::abs(p - c);
+                if (pa <= pb && pa <= pc) return static_cast<U8>(a);
+                if (pb <= pc) return static_cast<U8>(b);
+                return static_cast<U8>(c);
+            }
+        }
+
+        Bool ZlibDecompress(const U8* data, Size size, List<U8>& output, Size sizeHint)
+        {
+            if (size < 6) {
+                return false;
+            }
+
+            auto compressionMethod = data[0] & 0x0f;
+            auto presetDictionary = (data[1] & 0x20) != 0;
+            if (compressionMethod != 8 || ((static_cast<U32>(data[0]) << 8) | data[1]) % 31 != 0 || presetDictionary) {
+                return false;
+            }
+
+            output.clear();
+            output.reserve(sizeHint);
+
+            auto reader = internal::InflateBitReader{ .data = data, .size = size, .position = 2 };
+            Bool lastBlock = false;
+            while (!lastBlock) {
+                lastBlock = reader.Bits(1) != 0;
+                auto blockType = reader.Bits(2);
+                if (reader.overflow) {
+                    return false;
+                }
+
+                Bool success = false;
+                switch (blockType) {
+                    case 0: success = internal::InflateStored(reader, output); break;
+                    case 1: success = internal::InflateFixed(reader, output); break;
+                    case 2: success = internal::InflateDynamic(reader, output); break;
+                    default: success = false; break;
+                }
+
+                if (!success) {
+                    return false;
+                }
+            }
+
+            // the adler32 checksum follows at the next byte boundary
+            if (reader.position + 4 > size) {
+                return false;
+            }
+            return internal::ReadBigEndianU32(data + reader.position) == internal::Adler32(output.data(), output.size());
+        }
+
+        Bool DecodePng(const U8* data, Size size, List<U8>& rgba, U32& width, U32& height)
+        {
+            static constexpr U8 k_PngSignature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+            if (size < 8 || std::memcmp(data, k_PngSignature, 8) != 0) {
+                return false;
+            }
+
+            U8 bitDepth = 0;
+            U8 colorType = 0;
+            U8 interlace = 0;
+            List<U8> palette;
+            List<U8> transparency;
+            List<U8> compressed;
+            width = 0;
+            height = 0;
+
+            Size position = 8;
+            while (position + 12 <= size) {
+                auto length = internal::ReadBigEndianU32(data + position);
+                auto type = data + position + 4;
+                auto chunk = data + position + 8;
+                if (length > size - position - 12) {
+                    return false;
+                }
+                position += 12 + length;
+
+                if (std::memcmp(type, "IHDR", 4) == 0) {
+                    if (length < 13) {
+                        return false;
+                    }
+                    width = internal::ReadBigEndianU32(chunk);
+                    height = internal::ReadBigEndianU32(chunk + 4);
+                    bitDepth = chunk[8];
+                    colorType = chunk[9];
+                    interlace = chunk[12];
+                }
+                else if (std::memcmp(type, "PLTE", 4) == 0) {
+                    palette.assign(chunk, chunk + length);
+                }
+                else if (std::memcmp(type, "tRNS", 4) == 0) {
+                    transparency.assign(chunk, chunk + length);
+                }
+                else if (std::memcmp(type, "IDAT", 4) == 0) {
+                    compressed.insert(compressed.end(), chunk, chunk + length);
+                }
+                else if (std::memcmp(type, "IEND", 4) == 0) {
+                    break;
+                }
+            }
+
+            static constexpr U64 k_MaxPixels = 1ull << 28;
+            if (width == 0 || height == 0 || static_cast<U64>(width) * height > k_MaxPixels) {
+                return false;
+            }
+
+            if (interlace != 0) {
+                log::Warn("DecodePng: interlaced PNGs are not supported");
+                return false;
+            }
+
+            U32 channels = 0;
+            switch (colorType) {
+                case 0: channels = 1; break; // gray
+                case 2: channels = 3; break; // rgb
+                case 3: channels = 1; break; // palette
+                case 4: channels = 2; break; // gray + alpha
+                case 6: channels = 4; break; // rgba
+                default: return false;
+            }
+
+            auto validDepth = bitDepth == 8 || (bitDepth == 16 && colorType != 3) || ((bitDepth == 1 || bitDepth == 2 || bitDepth == 4) && (colorType == 0 || colorType == 3));
+            if (!validDepth || (colorType == 3 && palette.empty())) {
+                return false;
+            }
+
+            auto bitsPerPixel = channels * bitDepth;
+            auto filterStride = std::max<U32>(bitsPerPixel / 8, 1);
+            auto stride = (static_cast<Size>(width) * bitsPerPixel + 7) / 8;
+
+            auto filtered = List<U8>();
+            if (!ZlibDecompress(compressed.data(), compressed.size(), filtered, height * (stride + 1))) {
+                return false;
+            }
+            if (filtered.size() < height * (stride + 1)) {
+                return false;
+            }
+
+            // undo the per scanline filters in place
+            auto pixels = List<U8>(height * stride);
+            for (U32 y = 0; y < height; y++) {
+                auto filterType = filtered[y * (stride + 1)];
+                auto source = filtered.data() + y * (stride + 1) + 1;
+                auto row = pixels.data() + y * stride;
+                auto previous = y > 0 ? pixels.data() + (y - 1) * stride : nullptr;
+
+                for (Size x = 0; x < stride; x++) {
+                    I32 left = x >= filterStride ? row[x - filterStride] : 0;
+                    I32 up = previous ? previous[x] : 0;
+                    I32 upLeft = (previous && x >= filterStride) ? previous[x - filterStride] : 0;
+
+                    switch (filterType) {
+                        case 0: row[x] = source[x]; break;
+                        case 1: row[x] = static_cast<U8>(source[x] + left); break;
+                        case 2: row[x] = static_cast<U8>(source[x] + up); break;
+                        case 3: row[x] = static_cast<U8>(source[x] + ((left + up) >> 1)); break;
+                        case 4: row[x] = static_cast<U8>(source[x] + internal::PaethPredictor(left, up, upLeft)); break;
+                        default: return false;
+                    }
+                }
+            }
+
+            // expand every sample to rgba8
+            auto sampleMask = static_cast<U32>((1u << bitDepth) - 1);
+            auto readSample = [&](const U8* row, Size x, U32 channel) -> U32 {
+                auto index = x * channels + channel;
+                if (bitDepth == 16) {
+                    return (static_cast<U32>(row[index * 2]) << 8) | row[index * 2 + 1];
+                }
+                if (bitDepth == 8) {
+                    return row[index];
+                }
+                auto bitPosition = index * bitDepth;
+                auto shift = 8 - bitDepth - (bitPosition % 8);
+                return (row[bitPosition / 8] >> shift) & sampleMask;
+            };
+            auto toU8 = [&](U32 sample) -> U8 {
+                return static_cast<U8>(bitDepth == 16 ? sample >> 8 : (sample * 255) / sampleMask);
+            };
+            auto transparentSample = [&](U32 channel) -> U32 {
+                return (static_cast<U32>(transparency[channel * 2]) << 8) | transparency[channel * 2 + 1];
+            };
+
+            rgba.resize(static_cast<Size>(width) * height * 4);
+            for (U32 y = 0; y < height; y++) {
+                auto row = pixels.data() + y * stride;
+                auto destination = rgba.data() + static_cast<Size>(y) * width * 4;
+                for (U32 x = 0; x < width; x++, destination += 4) {
+                    switch (colorType) {
+                        case 0: {
+                            auto gray = readSample(row, x, 0);
+                            destination[0] = destination[1] = destination[2] = toU8(gray);
+                            destination[3] = (transparency.size() >= 2 && gray == transparentSample(0)) ? 0 : 255;
+                            break;
+                        }
+                        case 2: {
+                            auto r = readSample(row, x, 0);
+                            auto g = readSample(row, x, 1);
+                            auto b = readSample(row, x, 2);
+                            destination[0] = toU8(r);
+                            destination[1] = toU8(g);
+                            destination[2] = toU8(b);
+                            destination[3] = (transparency.size() >= 6 && r == transparentSample(0) && g == transparentSample(1) && b == transparentSample(2)) ? 0 : 255;
+                            break;
+                        }
+                        case 3: {
+                            auto index = readSample(row, x, 0);
+                            if (index * 3 + 2 >= palette.size()) {
+                                return false;
+                            }
+                            destination[0] = palette[index * 3];
+                            destination[1] = palette[index * 3 + 1];
+                            destination[2] = palette[index * 3 + 2];
+                            destination[3] = index < transparency.size() ? transparency[index] : 255;
+                            break;
+                        }
+                        case 4: {
+                            destination[0] = destination[1] = destination[2] = toU8(readSample(row, x, 0));
+                            destination[3] = toU8(readSample(row, x, 1));
+                            break;
+                        }
+                        case 6: {
+                            destination[0] = toU8(readSample(row, x, 0));
+                            destination[1] = toU8(readSample(row, x, 1));
+                            destination[2] = toU8(readSample(row, x, 2));
+                            destination[3] = toU8(readSample(row, x, 3));
+                            break;
+                        }
+                    }
+                }
+            }
+
+            return true;
+        }
+    }
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "core/Core.hpp"
+
+namespace tlc {
+    namespace utils {
+        // Decodes a non-interlaced PNG of any color type and bit depth into tightly packed RGBA8
+        Bool DecodePng(const U8* data, Size size, List<U8>& rgba, U32& width, U32& height);
+
+        // Decompresses a zlib (RFC 1950) stream
+        Bool ZlibDecompress(const U8* data, Size size, List<U8>& output, Size sizeHint = 0);
+    }
+}
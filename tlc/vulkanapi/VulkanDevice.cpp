@@ -3,6 +3,7 @@
 #include "vulkanapi/VulkanShader.hpp"
 #include "vulkanapi/VulkanSwapchain.hpp"
 #include "vulkanapi/VulkanBuffer.hpp"
+#include "core/Hash.hpp"
 
 namespace tlc
 {
@@ -72,7 +73,7 @@ namespace tlc
 		m_Device.destroy();
 	}
 
-	Ref<VulkanShaderModule> VulkanDevice::CreateShaderModule(const List<U32>& shaderCode)
+	Ref<VulkanShaderModule> VulkanDevice::CreateShaderModule(std::span<const U32> shaderCode)
 	{
 		if (!m_IsReady)
 		{
@@ -511,20 +512,47 @@ namespace tlc
 		allPools.clear();
 	}
 
-	// NOTE: assumption bindings are sorted
-	Size VulkanDevice::CalculateDescriptorLayoutCreateInfoHash(const vk::DescriptorSetLayoutCreateInfo& createInfo) {
-		auto result = std::hash<Size>()(createInfo.bindingCount);
-		for (Size i = 0; i < createInfo.bindingCount; i++) {
-			auto b = createInfo.pBindings[i];
-			Size bindingHash = (Size)b.binding | (Size)b.descriptorType << 8 | (Size)b.descriptorCount << 16 | (U32)b.stageFlags << 24;
-			result ^= std::hash<Size>()(bindingHash);
+	Size VulkanDevice::DescriptorSetLayoutKeyHash::operator()(const DescriptorSetLayoutKey& key) const {
+		auto hasher = Hasher();
+		hasher.UpdateValue(key.flags);
+		hasher.Update(key.bindings.data(), key.bindings.size() * sizeof(key.bindings[0]));
+		hasher.Update(key.immutableSamplers.data(), key.immutableSamplers.size() * sizeof(U64));
+		return static_cast<Size>(hasher.Digest());
+	}
+
+	VulkanDevice::DescriptorSetLayoutKey VulkanDevice::GetDescriptorSetLayoutKey(const vk::DescriptorSetLayoutCreateInfo& createInfo) {
+		// the binding flags line up with the bindings, they are sorted together
+		auto bindingFlags = Raw<const vk::DescriptorBindingFlags>(nullptr);
+		for (auto next = static_cast<const vk::BaseInStructure*>(createInfo.pNext); next != nullptr; next = next->pNext) {
+			TLC_ASSERT(next->sType == vk::StructureType::eDescriptorSetLayoutBindingFlagsCreateInfo, "Unsupported structure chained to a descriptor set layout");
+			const auto& flagsInfo = *reinterpret_cast<const vk::DescriptorSetLayoutBindingFlagsCreateInfo*>(next);
+			if (flagsInfo.bindingCount == createInfo.bindingCount) {
+				bindingFlags = flagsInfo.pBindingFlags;
+			}
+		}
+
+		auto bindings = List<Pair<vk::DescriptorSetLayoutBinding, vk::DescriptorBindingFlags>>();
+		for (U32 i = 0; i < createInfo.bindingCount; i++) {
+			bindings.emplace_back(createInfo.pBindings[i], bindingFlags != nullptr ? bindingFlags[i] : vk::DescriptorBindingFlags());
+		}
+		std::sort(bindings.begin(), bindings.end(), [](const auto& a, const auto& b) { return a.first.binding < b.first.binding; });
+
+		auto key = DescriptorSetLayoutKey();
+		key.flags = static_cast<U32>(createInfo.flags);
+		for (const auto& [b, flags] : bindings) {
+			key.bindings.push_back({ b.binding, static_cast<U32>(b.descriptorType), b.descriptorCount, static_cast<U32>(b.stageFlags), static_cast<U32>(flags) });
+			if (b.pImmutableSamplers != nullptr) {
+				for (U32 j = 0; j < b.descriptorCount; j++) {
+					key.immutableSamplers.push_back(reinterpret_cast<U64>(static_cast<VkSampler>(b.pImmutableSamplers[j])));
+				}
+			}
 		}
-		return result;
+		return key;
 	}
 
 	vk::DescriptorSetLayout VulkanDevice::CreateDescriptorSetLayout(const vk::DescriptorSetLayoutCreateInfo& createInfo) {
-		auto hash = CalculateDescriptorLayoutCreateInfoHash(createInfo);
-		auto cacheEntry = m_DescriptorSetLayoutCache.find(hash);
+		auto key = GetDescriptorSetLayoutKey(createInfo);
+		auto cacheEntry = m_DescriptorSetLayoutCache.find(key);
 		if (cacheEntry != m_DescriptorSetLayoutCache.end()) {
 			return cacheEntry->second;
 		}
@@ -532,7 +560,7 @@ namespace tlc
 		auto [result, layout] = m_Device.createDescriptorSetLayout(createInfo);
 		VkCall(result);
 
-		m_DescriptorSetLayoutCache.insert_or_assign(hash, layout);
+		m_DescriptorSetLayoutCache.insert_or_assign(std::move(key), layout);
 
 		return layout;
 	}
@@ -55,7 +55,7 @@ namespace tlc
 		VulkanDevice(VulkanContext* parentContext, vk::PhysicalDevice physicalDevice, const VulkanDeviceSettings& settings, vk::SurfaceKHR);
 		~VulkanDevice();
 
-		Ref<VulkanShaderModule> CreateShaderModule(const List<U32>& shaderCode);
+		Ref<VulkanShaderModule> CreateShaderModule(std::span<const U32> shaderCode);
 
 		vk::Semaphore CreateVkSemaphore(vk::SemaphoreCreateFlags flags = vk::SemaphoreCreateFlags()) const;
 		void DestroyVkSemaphore(vk::Semaphore semaphore) const;
@@ -63,6 +63,7 @@ namespace tlc
 		vk::Fence CreateVkFence(vk::FenceCreateFlags flags = vk::FenceCreateFlags()) const;
 		void DestroyVkFence(vk::Fence fence) const;
 
+		// Layouts are shared, equal bindings (in any order) give the same layout
 		vk::DescriptorSetLayout CreateDescriptorSetLayout(const vk::DescriptorSetLayoutCreateInfo& createInfo);
 		List<vk::DescriptorSet> AllocateDescriptorSets(const String& group, vk::DescriptorType type, const List<vk::DescriptorSetLayout>& descriptorSetLayout);
 		void FreeDescriptorGroup(const String& group);
@@ -104,7 +105,23 @@ namespace tlc
 		static I32 FindQueueFamily(const vk::PhysicalDevice& physicalDevice, const vk::QueueFlags& flags, const vk::SurfaceKHR& surface = VK_NULL_HANDLE);
 		static vk::DeviceQueueCreateInfo CreateQueueCreateInfo(I32 queueFamilyIndex, F32* queuePriority);
 
-		static Size CalculateDescriptorLayoutCreateInfoHash(const vk::DescriptorSetLayoutCreateInfo& createInfo);
+		// Everything that makes two descriptor set layouts different. The only structure the
+		// create info may chain is VkDescriptorSetLayoutBindingFlagsCreateInfo.
+		struct DescriptorSetLayoutKey
+		{
+			U32 flags = 0;
+			List<Array<U32, 5>> bindings; // binding, type, count, stages, binding flags sorted by binding
+			List<U64> immutableSamplers;
+
+			Bool operator==(const DescriptorSetLayoutKey&) const = default;
+		};
+
+		struct DescriptorSetLayoutKeyHash
+		{
+			Size operator()(const DescriptorSetLayoutKey& key) const;
+		};
+
+		static DescriptorSetLayoutKey GetDescriptorSetLayoutKey(const vk::DescriptorSetLayoutCreateInfo& createInfo);
 
 	private:
 		Raw<VulkanContext> m_ParentContext;
@@ -127,7 +144,7 @@ namespace tlc
 
 		UnorderedMap<vk::DescriptorType, List<vk::DescriptorPool>> m_AvailableDescriptorPools;
 		UnorderedMap<String, UnorderedMap<vk::DescriptorType, List<vk::DescriptorPool>>> m_DescriptorPools;
-		UnorderedMap<Size, vk::DescriptorSetLayout> m_DescriptorSetLayoutCache;
+		UnorderedMap<DescriptorSetLayoutKey, vk::DescriptorSetLayout, DescriptorSetLayoutKeyHash> m_DescriptorSetLayoutCache;
 
 		List<vk::QueryPool> m_QueryPools;
 	};
@@ -4,6 +4,33 @@
 
 namespace tlc
 {
+	static vk::Format GetVertexInputFormat(const ShaderVertexInput& input)
+	{
+		static const vk::Format k_Formats[3][3][4] = {
+			// 16 bit
+			{
+				{ vk::Format::eR16Sfloat, vk::Format::eR16G16Sfloat, vk::Format::eR16G16B16Sfloat, vk::Format::eR16G16B16A16Sfloat },
+				{ vk::Format::eR16Sint, vk::Format::eR16G16Sint, vk::Format::eR16G16B16Sint, vk::Format::eR16G16B16A16Sint },
+				{ vk::Format::eR16Uint, vk::Format::eR16G16Uint, vk::Format::eR16G16B16Uint, vk::Format::eR16G16B16A16Uint },
+			},
+			// 32 bit
+			{
+				{ vk::Format::eR32Sfloat, vk::Format::eR32G32Sfloat, vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32A32Sfloat },
+				{ vk::Format::eR32Sint, vk::Format::eR32G32Sint, vk::Format::eR32G32B32Sint, vk::Format::eR32G32B32A32Sint },
+				{ vk::Format::eR32Uint, vk::Format::eR32G32Uint, vk::Format::eR32G32B32Uint, vk::Format::eR32G32B32A32Uint },
+			},
+			// 64 bit
+			{
+				{ vk::Format::eR64Sfloat, vk::Format::eR64G64Sfloat, vk::Format::eR64G64B64Sfloat, vk::Format::eR64G64B64A64Sfloat },
+				{ vk::Format::eR64Sint, vk::Format::eR64G64Sint, vk::Format::eR64G64B64Sint, vk::Format::eR64G64B64A64Sint },
+				{ vk::Format::eR64Uint, vk::Format::eR64G64Uint, vk::Format::eR64G64B64Uint, vk::Format::eR64G64B64A64Uint },
+			},
+		};
+
+		auto size = input.ScalarSize == 2 ? 0 : (input.ScalarSize == 8 ? 2 : 1);
+		auto components = std::clamp(input.ComponentCount, 1u, 4u) - 1;
+		return k_Formats[size][static_cast<U32>(input.ScalarType)][components];
+	}
 
 	VulkanGraphicsPipeline::VulkanGraphicsPipeline(VulkanDevice* device, const VulkanGraphicsPipelineSettings& settings)
 	{
@@ -23,6 +50,7 @@ namespace tlc
 	{
 		Cleanup();
 
+		ResolveShaderInterface();
 		m_Properties.dynamicStateCreateInfo = GetDynamicStateCreateInfo();
 		m_Properties.vertexInputStateCreateInfo = GetVertexInputStateCreateInfo();
 		m_Properties.inputAssemblyStateCreateInfo = GetInputAssemblyStateCreateInfo();
@@ -116,6 +144,29 @@ namespace tlc
 				.setPVertexBindingDescriptions(&m_Properties.vertexInputBindingDescription)
 				.setVertexAttributeDescriptionCount(static_cast<uint32_t>(m_Properties.vertexInputAttributeDescriptions.size()))
 				.setPVertexAttributeDescriptions(m_Properties.vertexInputAttributeDescriptions.data());
+		} else if (auto vertexStage = std::find_if(m_Settings.shaderReflections.begin(), m_Settings.shaderReflections.end(), [](const auto& r) { return r.Stage == ShaderStage::Vertex; });
+			vertexStage != m_Settings.shaderReflections.end() && !vertexStage->VertexInputs.empty()) {
+			// tightly packed in location order
+			auto stride = U32(0);
+			m_Properties.vertexInputAttributeDescriptions.clear();
+			for (const auto& input : vertexStage->VertexInputs)
+			{
+				m_Properties.vertexInputAttributeDescriptions.push_back(vk::VertexInputAttributeDescription()
+					.setBinding(0)
+					.setLocation(input.Location)
+					.setFormat(GetVertexInputFormat(input))
+					.setOffset(stride));
+				stride += input.ScalarSize * input.ComponentCount;
+			}
+			m_Properties.vertexInputBindingDescription = vk::VertexInputBindingDescription()
+				.setBinding(0)
+				.setStride(stride)
+				.setInputRate(vk::VertexInputRate::eVertex);
+			vertexInputStateCreateInfo = vk::PipelineVertexInputStateCreateInfo()
+				.setVertexBindingDescriptionCount(1)
+				.setPVertexBindingDescriptions(&m_Properties.vertexInputBindingDescription)
+				.setVertexAttributeDescriptionCount(static_cast<uint32_t>(m_Properties.vertexInputAttributeDescriptions.size()))
+				.setPVertexAttributeDescriptions(m_Properties.vertexInputAttributeDescriptions.data());
 		} else {
 			vertexInputStateCreateInfo = vk::PipelineVertexInputStateCreateInfo()
 				.setVertexBindingDescriptionCount(0)
@@ -223,16 +274,88 @@ namespace tlc
 	vk::PipelineLayout VulkanGraphicsPipeline::CreatePipelineLayout() const
 	{
 		auto pipelineLayoutCreateInfo = vk::PipelineLayoutCreateInfo()
-			.setSetLayoutCount(static_cast<U32>(m_Settings.descriptorSetLayouts.size()))
-			.setPSetLayouts(m_Settings.descriptorSetLayouts.data())
-			.setPushConstantRangeCount(static_cast<U32>(m_Settings.pushConstantRanges.size()))
-			.setPPushConstantRanges(m_Settings.pushConstantRanges.data());
+			.setSetLayoutCount(static_cast<U32>(m_Properties.descriptorSetLayouts.size()))
+			.setPSetLayouts(m_Properties.descriptorSetLayouts.data())
+			.setPushConstantRangeCount(static_cast<U32>(m_Properties.pushConstantRanges.size()))
+			.setPPushConstantRanges(m_Properties.pushConstantRanges.data());
 
 		auto [result, pipelineLayout] = m_Device->GetDevice().createPipelineLayout(pipelineLayoutCreateInfo);
 		VkCall(result);
 		return pipelineLayout;
 	}
 
+	void VulkanGraphicsPipeline::ResolveShaderInterface()
+	{
+		m_Properties.pushConstantRanges = m_Settings.pushConstantRanges;
+		if (m_Properties.pushConstantRanges.empty())
+		{
+			// a block used by several stages becomes a single range visible to all of them
+			for (const auto& reflection : m_Settings.shaderReflections)
+			{
+				for (const auto& block : reflection.PushConstants)
+				{
+					auto range = std::find_if(m_Properties.pushConstantRanges.begin(), m_Properties.pushConstantRanges.end(), [&block](const auto& r) {
+						return r.offset == block.Offset && r.size == block.Size;
+					});
+					if (range == m_Properties.pushConstantRanges.end())
+					{
+						m_Properties.pushConstantRanges.push_back(vk::PushConstantRange().setOffset(block.Offset).setSize(block.Size));
+						range = m_Properties.pushConstantRanges.end() - 1;
+					}
+					range->stageFlags |= static_cast<vk::ShaderStageFlagBits>(reflection.Stage);
+				}
+			}
+		}
+
+		m_Properties.descriptorSetLayouts = m_Settings.descriptorSetLayouts;
+		if (!m_Properties.descriptorSetLayouts.empty())
+		{
+			return;
+		}
+
+		// set -> bindings, a binding used by several stages is visible to all of them
+		auto sets = List<List<vk::DescriptorSetLayoutBinding>>();
+		for (const auto& reflection : m_Settings.shaderReflections)
+		{
+			for (const auto& binding : reflection.Bindings)
+			{
+				if (binding.Set >= sets.size())
+				{
+					sets.resize(binding.Set + 1);
+				}
+
+				auto& bindings = sets[binding.Set];
+				auto existing = std::find_if(bindings.begin(), bindings.end(), [&binding](const auto& b) { return b.binding == binding.Binding; });
+				if (existing == bindings.end())
+				{
+					if (binding.Count == 0)
+					{
+						log::Warn("VulkanGraphicsPipeline: runtime sized descriptor array at set {} binding {}, using a single descriptor", binding.Set, binding.Binding);
+					}
+					bindings.push_back(vk::DescriptorSetLayoutBinding()
+						.setBinding(binding.Binding)
+						.setDescriptorType(static_cast<vk::DescriptorType>(binding.Type))
+						.setDescriptorCount(std::max(binding.Count, 1u)));
+					existing = bindings.end() - 1;
+				}
+				else if (existing->descriptorType != static_cast<vk::DescriptorType>(binding.Type))
+				{
+					log::Error("VulkanGraphicsPipeline: stages disagree on the descriptor type of set {} binding {}", binding.Set, binding.Binding);
+				}
+				existing->stageFlags |= static_cast<vk::ShaderStageFlagBits>(reflection.Stage);
+			}
+		}
+
+		// the device hands out the same layout for the same bindings
+		for (auto& bindings : sets)
+		{
+			auto createInfo = vk::DescriptorSetLayoutCreateInfo()
+				.setBindingCount(static_cast<U32>(bindings.size()))
+				.setPBindings(bindings.data());
+			m_Properties.descriptorSetLayouts.push_back(m_Device->CreateDescriptorSetLayout(createInfo));
+		}
+	}
+
 	void VulkanGraphicsPipeline::Cleanup()
 	{
 		m_Device->WaitIdle();
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "vulkanapi/VulkanBase.hpp"
+#include "core/ShaderReflection.hpp"
 
 namespace tlc
 {
@@ -75,6 +76,9 @@ namespace tlc
 		List<vk::PushConstantRange> pushConstantRanges;
 		List<vk::DescriptorSetLayout> descriptorSetLayouts;
 		std::optional<vk::PipelineColorBlendAttachmentState> blendAttachmentState;
+		// Fill in whatever was not set explicitly: push constant ranges, descriptor set layouts
+		// and vertex inputs (tightly packed in location order in a single binding)
+		List<ShaderReflection> shaderReflections;
 
 
 		VulkanGraphicsPipelineSettings() = default;
@@ -97,6 +101,9 @@ namespace tlc
 		
 		inline VulkanGraphicsPipelineSettings& SetPipelineColorBlendAttachmentState(vk::PipelineColorBlendAttachmentState b) { this->blendAttachmentState = b; return *this; }
 
+		inline VulkanGraphicsPipelineSettings& AddShaderReflection(const ShaderReflection& r) { this->shaderReflections.push_back(r); return *this; }
+		inline VulkanGraphicsPipelineSettings& ClearShaderReflections() { this->shaderReflections.clear(); return *this; }
+
 
 
 	};
@@ -117,6 +124,9 @@ namespace tlc
 		List<vk::PipelineShaderStageCreateInfo> shaderStages;
 		vk::VertexInputBindingDescription vertexInputBindingDescription;
 		List<vk::VertexInputAttributeDescription> vertexInputAttributeDescriptions;
+		// the ones of the settings or the reflected ones
+		List<vk::PushConstantRange> pushConstantRanges;
+		List<vk::DescriptorSetLayout> descriptorSetLayouts;
 	};
 
 	class VulkanGraphicsPipeline
@@ -133,6 +143,9 @@ namespace tlc
 		inline Bool IsReady() const { return m_IsReady; }
 		inline vk::Pipeline GetPipeline() const { return m_Pipeline; }
 		inline vk::PipelineLayout GetPipelineLayout() const { return m_PipelineLayout; }
+		// By set number, use these to allocate descriptor sets for the pipeline
+		inline const List<vk::DescriptorSetLayout>& GetDescriptorSetLayouts() const { return m_Properties.descriptorSetLayouts; }
+		inline const List<vk::PushConstantRange>& GetPushConstantRanges() const { return m_Properties.pushConstantRanges; }
 
 		friend class VulkanFramebuffer;
 
@@ -147,6 +160,7 @@ namespace tlc
 		vk::PipelineColorBlendAttachmentState GetColorBlendAttachmentState() const;
 		vk::PipelineDepthStencilStateCreateInfo GetDepthStencilStateCreateInfo() const;
 		vk::PipelineLayout CreatePipelineLayout() const;
+		void ResolveShaderInterface();
 
 		void Cleanup();
 
@@ -237,8 +237,8 @@ namespace tlc {
 
         auto bufferCopyRegion = vk::BufferImageCopy()
             .setBufferOffset(0)
-            .setBufferRowLength(uploadSettings.size.first)
-            .setBufferImageHeight(uploadSettings.size.second)
+            .setBufferRowLength(0) // tightly packed, also valid for block compressed formats
+            .setBufferImageHeight(0)
             .setImageSubresource(vk::ImageSubresourceLayers()
                 .setAspectMask(uploadSettings.aspectMask)
                 .setMipLevel(uploadSettings.mipLevel)
@@ -82,6 +82,7 @@ namespace tlc
         const void* data = nullptr;
         Pair<U32, U32> size = { 0, 0 };
         U32 bytesPerPixel = 0;
+        Size dataSize = 0; // overrides the size derived from bytesPerPixel, needed for block compressed formats
         Pair<U32, U32> offset = { 0, 0 };
         U32 mipLevel = 0;
         U32 baseArrayLayer = 0;
@@ -96,7 +97,7 @@ namespace tlc
         // its own staging buffer
         Ref<VulkanBuffer> stagingBuffer = nullptr;
 
-        VulkanImageUploadSettings(void* data, U32 width, U32 height, U32 bytesPerPixel)
+        VulkanImageUploadSettings(const void* data, U32 width, U32 height, U32 bytesPerPixel)
             : data(data), size(MakePair(width, height)), bytesPerPixel(bytesPerPixel) {}
         
         inline VulkanImageUploadSettings& SetOffset(U32 x, U32 y) { offset = MakePair(x, y); return *this; }
@@ -107,8 +108,12 @@ namespace tlc
         inline VulkanImageUploadSettings& SetDepthOffset(U32 d) { depthOffset = d; return *this; }
         inline VulkanImageUploadSettings& SetAspectMask(vk::ImageAspectFlags mask) { aspectMask = mask; return *this; }
         inline VulkanImageUploadSettings& SetQueueType(VulkanQueueType type) { queueType = type; return *this; }
+        inline VulkanImageUploadSettings& SetDataSize(Size s) { dataSize = s; return *this; }
 
         inline Size GetRerquireImageSize() const {
+            if (dataSize != 0) {
+                return dataSize;
+            }
             return size.first * size.second * bytesPerPixel * layerCount * depth;
         }
     };
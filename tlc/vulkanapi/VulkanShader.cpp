@@ -4,12 +4,12 @@
 namespace tlc
 {
 
-	VulkanShaderModule::VulkanShaderModule(Raw<VulkanDevice> device, const List<U32>& shaderCode)
+	VulkanShaderModule::VulkanShaderModule(Raw<VulkanDevice> device, std::span<const U32> shaderCode)
 	{
 		m_Device = device;
 
 		vk::ShaderModuleCreateInfo createInfo = vk::ShaderModuleCreateInfo()
-			.setCodeSize(static_cast<U32>(shaderCode.size()) * 4)
+			.setCodeSize(shaderCode.size_bytes())
 			.setPCode(reinterpret_cast<const U32*>(shaderCode.data()));
 
 		if (m_Device->GetDevice().createShaderModule(&createInfo, nullptr, &m_ShaderModule) != vk::Result::eSuccess)
@@ -10,7 +10,7 @@ namespace tlc
 	class VulkanShaderModule
 	{
 	public:
-		VulkanShaderModule(Raw<VulkanDevice> device, const List<U32>& shaderCode);
+		VulkanShaderModule(Raw<VulkanDevice> device, std::span<const U32> shaderCode);
 		~VulkanShaderModule();
 
 		vk::PipelineShaderStageCreateInfo GetShaderStageCreateInfo(vk::ShaderStageFlagBits stage) const;